@@ -0,0 +1,52 @@
+/* globals browser */
+
+// Keeps the native wrapper running, so that it doesn't have to be started for
+// every URI. The wrapper answers the messages in the order they were sent.
+
+let port = null;
+const pending = [];             // Callbacks waiting for an answer.
+
+function onNativeMessage(response)
+{
+    console.log("Received: " + JSON.stringify(response));
+    const callback = pending.shift();
+    if (callback !== undefined)
+    {
+        callback.resolve(response);
+    }
+}
+
+function onDisconnect(p)
+{
+    const error = (p.error) ? p.error.message : "remwharead exited.";
+    console.log(`Disconnected: ${error}`);
+    port = null;
+    while (pending.length > 0)
+    {
+        pending.shift().reject(error);
+    }
+}
+
+function get_port()
+{
+    if (port === null)
+    {
+        port = browser.runtime.connectNative("remwharead");
+        port.onMessage.addListener(onNativeMessage);
+        port.onDisconnect.addListener(onDisconnect);
+    }
+    return port;
+}
+
+function send(message)          // Send message to the wrapper, resolve on answer.
+{
+    return new Promise((resolve, reject) =>
+                       {
+                           pending.push({resolve, reject});
+                           console.log("Sending: " + JSON.stringify(message)
+                                       + " to remwharead");
+                           get_port().postMessage(message);
+                       });
+}
+
+browser.runtime.onMessage.addListener(send);
@@ -14,147 +14,835 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <Poco/Message.h>
-#include <sys/wait.h>
+#include "archive_queue.hpp"
+#include "sqlite.hpp"
+#include "uri.hpp"
 
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
-#include <cstdlib>
+#include <cstdio>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
+using namespace remwharead;
 using std::cin;
 using std::cout;
 using std::string;
-using std::system;
+using std::string_view;
 using std::uint32_t;
+using std::vector;
+
+/*!
+ *  @brief  A decoded message.
+ *
+ *  The extension sends a JSON object:
+ *
+ *      {"action": "add", "uris": ["https://example.com/"],
+ *       "tags": ["tag1", "tag2"], "archive": true}
+ *
+ *  `"uri"` can be used instead of `"uris"` for a single URI. The string views
+ *  point into the Message they were decoded from.
+ */
+struct request
+{
+    enum class action_type
+    {
+        unknown,
+        add
+    };
+
+    action_type action{action_type::add};
+    vector<string_view> uris;
+    vector<string_view> tags;
+    bool archive{true};
+    //! The message was a string in the old format, answer with a string.
+    bool legacy{false};
+};
+
+//! Result of saving one URI.
+struct result
+{
+    bool successful{false};
+    string error;
+};
 
 class Message
 {
 public:
-    //! Read message from stdin and store it in _msg.
-    Message();
+    /*!
+     *  @brief  Read the next message from stdin.
+     *
+     *  Returns nullptr if stdin was closed.
+     */
+    [[nodiscard]] static std::unique_ptr<Message> read();
 
-    //! Decode message and return argument string for launch().
-    [[nodiscard]] string decode();
+    /*!
+     *  @brief  Decode the JSON payload into a request.
+     *
+     *  May throw std::invalid_argument.
+     */
+    [[nodiscard]] request decode();
 
 private:
-    string _msg;
+    string _buffer;
+    //! Decoded strings that contained escape sequences.
+    std::deque<string> _unescaped;
+    size_t _pos{0};
+
+    explicit Message(string buffer);
+
+    //! Returns the next non-whitespace character without consuming it.
+    [[nodiscard]] char peek();
+
+    //! Consume c or throw.
+    void expect(char c);
+
+    //! Returns a view of the string, copies only if it contains escapes.
+    [[nodiscard]] string_view parse_string();
+
+    [[nodiscard]] bool parse_bool();
+
+    [[nodiscard]] vector<string_view> parse_string_array();
 
-    //! Replace "\u001f" with the char in _msg.
-    void unescape();
+    //! Skip a value of any type.
+    void skip_value();
 
-    //! Replace " with \" in field.
-    static void replace_in_field(string &field);
+    //! Decode the old format: Fields separated by UNIT SEPARATOR.
+    void decode_legacy(string_view msg, request &req);
+
+    //! Split comma separated tags, remove surrounding spaces.
+    [[nodiscard]] static vector<string_view> split_tags(string_view tags);
+};
+
+//! Runs tasks on a fixed number of threads.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t n_threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    WorkerPool(WorkerPool &&) = delete;
+    WorkerPool &operator=(WorkerPool &&) = delete;
+
+    //! Queue task, the future holds its result.
+    [[nodiscard]] std::future<result> submit(std::function<result()> task);
+
+private:
+    vector<std::thread> _threads;
+    std::queue<std::packaged_task<result()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop{false};
 };
 
-//! Send a message back.
+//! Append text as a JSON string.
+void append_json_string(string &out, string_view text);
+
+//! Build the answer to a request.
+string make_reply(const request &req, const vector<result> &results);
+
+//! Send a message back. It has to be valid JSON.
 void send_message(const string &message);
 
-//! Launch remwharead with args.
-int launch(const string &args);
+//! Fetch the page and store it in db. Archiving is done by the ArchiveQueue.
+result save(string_view uri, const vector<string_view> &tags, bool archive,
+            Database &db, std::mutex &db_mutex);
 
 int main()
 {
-    Message message;
-    const auto args{message.decode()};
-
-    const int ret = launch(args);
+    // Initialize curl once for all saves. Later calls to curl_global_init()
+    // only increase a counter.
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    {
+        send_message(R"("Could not initialize curl.")");
+        return 2;
+    }
 
-    if (ret == 0)
+    Database db;
+    if (!db)
     {
-        send_message("Command successful.");
+        send_message(R"("Database could not be opened.")");
+        return 2;
     }
-    else
+    std::mutex db_mutex;
+    ArchiveQueue archive_queue(db, db_mutex);
+    archive_queue.start();
+
+    // The replies are sent in the order of the messages.
+    std::queue<std::function<string()>> replies;
+    std::mutex replies_mutex;
+    std::condition_variable replies_cv;
+    bool done{false};
+    std::thread replier(
+        [&]
+        {
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock(replies_mutex);
+                replies_cv.wait(lock, [&] { return done || !replies.empty(); });
+                if (replies.empty())
+                {
+                    return;
+                }
+                const std::function<string()> reply{std::move(replies.front())};
+                replies.pop();
+                lock.unlock();
+
+                send_message(reply());
+            }
+        });
+
+    {
+        WorkerPool pool(std::max(2U, std::thread::hardware_concurrency()));
+        while (std::shared_ptr<Message> message = Message::read())
+        {
+            std::function<string()> reply;
+            try
+            {
+                const request req{message->decode()};
+
+                // Every URI is saved on its own, the reply waits for all.
+                auto futures{std::make_shared<vector<std::future<result>>>()};
+                if (req.action == request::action_type::add)
+                {
+                    for (const string_view uri : req.uris)
+                    {
+                        futures->push_back(pool.submit(
+                            [message, uri, tags = req.tags,
+                             archive = req.archive, &db, &db_mutex]
+                            {
+                                return save(uri, tags, archive, db, db_mutex);
+                            }));
+                    }
+                }
+
+                reply = [message, req, futures, &archive_queue]
+                {
+                    vector<result> results;
+                    for (std::future<result> &future : *futures)
+                    {
+                        results.push_back(future.get());
+                    }
+                    archive_queue.notify();
+                    return make_reply(req, results);
+                };
+            }
+            catch (const std::exception &e)
+            {
+                string error{R"({"successful":false,"error":)"};
+                append_json_string(error, e.what());
+                error += '}';
+                reply = [error] { return error; };
+            }
+
+            std::lock_guard<std::mutex> lock(replies_mutex);
+            replies.push(std::move(reply));
+            replies_cv.notify_one();
+        }
+    }   // Wait for the workers.
+
     {
-        send_message("Command failed with status: " + std::to_string(ret)
-                     + '.');
+        std::lock_guard<std::mutex> lock(replies_mutex);
+        done = true;
+        replies_cv.notify_one();
     }
+    replier.join();
+    archive_queue.stop();
+    curl_global_cleanup();
 
-    return ret;
+    return 0;
 }
 
-Message::Message()
+Message::Message(string buffer)
+    : _buffer{std::move(buffer)}
+{}
+
+std::unique_ptr<Message> Message::read()
 {
     // Read message length.
     uint32_t length{0};
-    char buffer[4];
-    cin.read(buffer, sizeof(length));
+    char buffer[sizeof(length)];
+    if (!cin.read(buffer, sizeof(length)))
+    {
+        return nullptr;
+    }
     std::memcpy(&length, buffer, sizeof(length));
 
-    // Ignore quotes.
-    length -= 2;
-    cin.ignore(1);
+    // Read message in one go.
+    string msg(length, '\0');
+    if (!cin.read(msg.data(), length))
+    {
+        return nullptr;
+    }
+
+    return std::unique_ptr<Message>(new Message(std::move(msg)));
+}
+
+request Message::decode()
+{
+    request req;
+    _pos = 0;
+
+    if (peek() == '"')
+    {
+        req.legacy = true;
+        decode_legacy(parse_string(), req);
+        return req;
+    }
+
+    expect('{');
+    if (peek() == '}')
+    {
+        throw std::invalid_argument("Empty message.");
+    }
+    while (true)
+    {
+        const string_view key{parse_string()};
+        expect(':');
+        if (key == "action")
+        {
+            const string_view action{parse_string()};
+            req.action = (action == "add") ? request::action_type::add
+                                           : request::action_type::unknown;
+        }
+        else if (key == "uri")
+        {
+            req.uris.push_back(parse_string());
+        }
+        else if (key == "uris")
+        {
+            req.uris = parse_string_array();
+        }
+        else if (key == "tags")
+        {
+            req.tags = parse_string_array();
+        }
+        else if (key == "archive")
+        {
+            req.archive = parse_bool();
+        }
+        else
+        {
+            skip_value();
+        }
+
+        if (peek() != ',')
+        {
+            break;
+        }
+        ++_pos;
+    }
+    expect('}');
 
-    // Read message.
-    char c{'\0'};
-    for (; length > 0; --length)
+    if (req.action == request::action_type::unknown)
     {
-        cin.read(&c, 1);
-        _msg += c;
+        throw std::invalid_argument("Unknown action.");
     }
+
+    return req;
 }
 
-string Message::decode()
+char Message::peek()
 {
-    unescape();
+    while (_pos < _buffer.size()
+           && (_buffer[_pos] == ' ' || _buffer[_pos] == '\n'
+               || _buffer[_pos] == '\r' || _buffer[_pos] == '\t'))
+    {
+        ++_pos;
+    }
+    if (_pos == _buffer.size())
+    {
+        throw std::invalid_argument("Unexpected end of message.");
+    }
 
-    constexpr char separator{'\u001f'}; // UNIT SEPARATOR.
-    if (_msg[0] != separator)           // Extension uses old method.
+    return _buffer[_pos];
+}
+
+void Message::expect(const char c)
+{
+    if (peek() != c)
+    {
+        throw std::invalid_argument(string("Expected '") + c + "' at position "
+                                    + std::to_string(_pos) + '.');
+    }
+    ++_pos;
+}
+
+string_view Message::parse_string()
+{
+    expect('"');
+    const size_t start{_pos};
+    const size_t end{_buffer.find_first_of("\"\\", start)};
+    if (end == string::npos)
+    {
+        throw std::invalid_argument("Unterminated string.");
+    }
+    if (_buffer[end] == '"')    // No escape sequences, no copy.
+    {
+        _pos = end + 1;
+        return string_view(_buffer).substr(start, end - start);
+    }
+
+    string &out{_unescaped.emplace_back(_buffer, start, end - start)};
+    _pos = end;
+    while (_pos < _buffer.size() && _buffer[_pos] != '"')
     {
-        return _msg;
+        const char c{_buffer[_pos++]};
+        if (c != '\\')
+        {
+            out += c;
+            continue;
+        }
+        if (_pos == _buffer.size())
+        {
+            break;
+        }
+
+        const char escaped{_buffer[_pos++]};
+        switch (escaped)
+        {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            // Exactly 4 hex digits, std::stoul() would accept less.
+            const auto read_hex = [this]
+            {
+                if (_pos + 4 > _buffer.size())
+                {
+                    throw std::invalid_argument("Invalid \\u escape.");
+                }
+                uint32_t value{0};
+                for (const char digit : string_view(_buffer).substr(_pos, 4))
+                {
+                    value <<= 4U;
+                    if (digit >= '0' && digit <= '9')
+                    {
+                        value |= static_cast<uint32_t>(digit - '0');
+                    }
+                    else if (digit >= 'a' && digit <= 'f')
+                    {
+                        value |= static_cast<uint32_t>(digit - 'a' + 10);
+                    }
+                    else if (digit >= 'A' && digit <= 'F')
+                    {
+                        value |= static_cast<uint32_t>(digit - 'A' + 10);
+                    }
+                    else
+                    {
+                        throw std::invalid_argument("Invalid \\u escape.");
+                    }
+                }
+                _pos += 4;
+                return value;
+            };
+
+            uint32_t codepoint{read_hex()};
+            if (codepoint >= 0xDC00 && codepoint < 0xE000)
+            {
+                throw std::invalid_argument("Lone low surrogate.");
+            }
+            if (codepoint >= 0xD800 && codepoint < 0xDC00)
+            {   // Surrogate pair.
+                if (_buffer.compare(_pos, 2, "\\u") != 0)
+                {
+                    throw std::invalid_argument("Lone high surrogate.");
+                }
+                _pos += 2;
+                const uint32_t low{read_hex()};
+                if (low < 0xDC00 || low >= 0xE000)
+                {
+                    throw std::invalid_argument("Invalid surrogate pair.");
+                }
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10U)
+                    + (low - 0xDC00);
+            }
+
+            // Encode as UTF-8.
+            if (codepoint < 0x80)
+            {
+                out += static_cast<char>(codepoint);
+            }
+            else if (codepoint < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (codepoint >> 6U));
+                out += static_cast<char>(0x80 | (codepoint & 0x3FU));
+            }
+            else if (codepoint < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (codepoint >> 12U));
+                out += static_cast<char>(0x80 | ((codepoint >> 6U) & 0x3FU));
+                out += static_cast<char>(0x80 | (codepoint & 0x3FU));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (codepoint >> 18U));
+                out += static_cast<char>(0x80 | ((codepoint >> 12U) & 0x3FU));
+                out += static_cast<char>(0x80 | ((codepoint >> 6U) & 0x3FU));
+                out += static_cast<char>(0x80 | (codepoint & 0x3FU));
+            }
+            break;
+        }
+        case '"':
+        case '\\':
+        case '/': out += escaped; break;
+        default: throw std::invalid_argument("Invalid escape sequence.");
+        }
     }
+    expect('"');
 
-    size_t pos{1};
-    size_t endpos{0};
-    string newargs;
-    while ((endpos = _msg.find(separator, pos)) != string::npos)
+    return out;
+}
+
+bool Message::parse_bool()
+{
+    static_cast<void>(peek()); // Skip whitespace.
+    if (_buffer.compare(_pos, 4, "true") == 0)
+    {
+        _pos += 4;
+        return true;
+    }
+    if (_buffer.compare(_pos, 5, "false") == 0)
     {
-        string field{_msg.substr(pos, endpos - pos)};
-        replace_in_field(field);
-        newargs += " \"" + field + '"';
-        pos = endpos + 1;
+        _pos += 5;
+        return false;
     }
 
-    return newargs;
+    throw std::invalid_argument("Expected true or false at position "
+                                + std::to_string(_pos) + '.');
 }
 
-void Message::unescape()
+vector<string_view> Message::parse_string_array()
 {
-    size_t pos{0};
-    while ((pos = _msg.find(R"(\u001f)", pos)) != string::npos)
+    vector<string_view> strings;
+    expect('[');
+    if (peek() == ']')
+    {
+        ++_pos;
+        return strings;
+    }
+    while (true)
+    {
+        strings.push_back(parse_string());
+        if (peek() != ',')
+        {
+            break;
+        }
+        ++_pos;
+    }
+    expect(']');
+
+    return strings;
+}
+
+void Message::skip_value()
+{
+    const char c{peek()};
+    if (c == '"')
     {
-        _msg.replace(pos, 6, "\u001f");
+        static_cast<void>(parse_string());
+    }
+    else if (c == '{' || c == '[')
+    {
+        const char close{(c == '{') ? '}' : ']'};
+        ++_pos;
+        if (peek() == close)
+        {
+            ++_pos;
+            return;
+        }
+        while (true)
+        {
+            if (c == '{')
+            {
+                static_cast<void>(parse_string());
+                expect(':');
+            }
+            skip_value();
+            if (peek() != ',')
+            {
+                break;
+            }
+            ++_pos;
+        }
+        expect(close);
+    }
+    else
+    {   // Number, true, false or null.
+        while (_pos < _buffer.size()
+               && string_view(",}] \n\r\t").find(_buffer[_pos])
+                      == string_view::npos)
+        {
+            ++_pos;
+        }
     }
 }
 
-void Message::replace_in_field(string &field)
+void Message::decode_legacy(const string_view msg, request &req)
 {
+    constexpr char separator{'\u001f'}; // UNIT SEPARATOR.
+    vector<string_view> fields;
+    if (!msg.empty() && msg[0] == separator)
+    {
+        size_t pos{1};
+        size_t endpos{0};
+        while ((endpos = msg.find(separator, pos)) != string_view::npos)
+        {
+            fields.push_back(msg.substr(pos, endpos - pos));
+            pos = endpos + 1;
+        }
+    }
+    else                        // Extension uses the oldest method.
+    {
+        size_t pos{0};
+        while (pos != string_view::npos)
+        {
+            const size_t endpos{msg.find(' ', pos)};
+            const string_view field{msg.substr(pos, endpos - pos)};
+            if (!field.empty() && !fields.empty() && fields.back() == "-t")
+            {   // Extend the view to "-t tags".
+                fields.back() = string_view(fields.back().data(),
+                                            field.data() + field.size()
+                                                - fields.back().data());
+            }
+            else if (!field.empty())
+            {
+                fields.push_back(field);
+            }
+            pos = (endpos == string_view::npos) ? endpos : endpos + 1;
+        }
+    }
+
+    for (const string_view field : fields)
+    {
+        if (field.substr(0, 3) == "-t ")
+        {
+            req.tags = split_tags(field.substr(3));
+        }
+        else if (field == "--no-archive")
+        {
+            req.archive = false;
+        }
+        else if (!field.empty())
+        {
+            req.uris = {field};
+        }
+    }
+}
+
+vector<string_view> Message::split_tags(const string_view tags)
+{
+    vector<string_view> result;
     size_t pos{0};
-    while ((pos = field.find('"', pos)) != string::npos)
+    while (pos != string_view::npos)
+    {
+        const size_t endpos{tags.find(',', pos)};
+        string_view tag{tags.substr(pos, endpos - pos)};
+        while (!tag.empty() && tag.front() == ' ') // Remove leading spaces.
+        {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && tag.back() == ' ') // Remove trailing spaces.
+        {
+            tag.remove_suffix(1);
+        }
+        if (!tag.empty())
+        {
+            result.push_back(tag);
+        }
+        pos = (endpos == string_view::npos) ? endpos : endpos + 1;
+    }
+
+    return result;
+}
+
+WorkerPool::WorkerPool(const size_t n_threads)
+{
+    for (size_t i = 0; i < n_threads; ++i)
+    {
+        _threads.emplace_back(
+            [this]
+            {
+                while (true)
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _cv.wait(lock, [this] { return _stop || !_tasks.empty(); });
+                    if (_tasks.empty())
+                    {
+                        return;
+                    }
+                    std::packaged_task<result()> task{std::move(_tasks.front())};
+                    _tasks.pop();
+                    lock.unlock();
+
+                    task();
+                }
+            });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (std::thread &thread : _threads)
+    {
+        thread.join();
+    }
+}
+
+std::future<result> WorkerPool::submit(std::function<result()> task)
+{
+    std::packaged_task<result()> packaged{std::move(task)};
+    std::future<result> future{packaged.get_future()};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push(std::move(packaged));
+    }
+    _cv.notify_one();
+
+    return future;
+}
+
+void append_json_string(string &out, const string_view text)
+{
+    out += '"';
+    for (const char c : text)
     {
-        field.replace(pos, 1, R"(\")");
-        pos += 2;
+        switch (c)
+        {
+        case '"': out += R"(\")"; break;
+        case '\\': out += R"(\\)"; break;
+        case '\n': out += R"(\n)"; break;
+        case '\r': out += R"(\r)"; break;
+        case '\t': out += R"(\t)"; break;
+        default:
+        {
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buffer[7];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x",
+                              static_cast<unsigned int>(c));
+                out += buffer;
+            }
+            else
+            {
+                out += c;
+            }
+            break;
+        }
+        }
     }
+    out += '"';
+}
+
+string make_reply(const request &req, const vector<result> &results)
+{
+    const bool successful{
+        !results.empty()
+        && std::all_of(results.begin(), results.end(),
+                       [](const result &r) { return r.successful; })};
+
+    string reply;
+    if (req.legacy)
+    {
+        if (successful)
+        {
+            append_json_string(reply, "Command successful.");
+        }
+        else
+        {
+            append_json_string(reply, results.empty() ? "No URI given."
+                                                      : results[0].error);
+        }
+
+        return reply;
+    }
+
+    reply = R"({"successful":)";
+    reply += successful ? "true" : "false";
+    reply += R"(,"results":[)";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (i != 0)
+        {
+            reply += ',';
+        }
+        reply += R"({"uri":)";
+        append_json_string(reply, req.uris[i]);
+        reply += R"(,"successful":)";
+        reply += results[i].successful ? "true" : "false";
+        reply += R"(,"error":)";
+        append_json_string(reply, results[i].error);
+        reply += '}';
+    }
+    reply += "]}";
+
+    return reply;
 }
 
 void send_message(const string &message)
 {
-    const auto length = static_cast<uint32_t>(message.length() + 2);
+    const auto length = static_cast<uint32_t>(message.length());
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
     cout.write(reinterpret_cast<const char *>(&length), sizeof(uint32_t));
-    cout << '"' << message << '"';
+    cout << message;
+    cout.flush();
 }
 
-int launch(const string &args)
+result save(const string_view uri_view, const vector<string_view> &tags,
+            const bool archive, Database &db, std::mutex &db_mutex)
 {
-    const string cmd = "remwharead " + args + " 2>/dev/null";
-    // NOLINTNEXTLINE(cert-env33-c)
-    int ret = system(cmd.c_str());
-    if (WIFEXITED(ret)) // NOLINT(hicpp-signed-bitwise)
+    if (uri_view.empty())
+    {
+        return {false, "No URI given."};
+    }
+
+    try
+    {
+        // Runs on the worker pool. Constructing a URI does not touch the
+        // global locale, see the test "URIs are used from several threads".
+        URI uri{string(uri_view)};
+        const html_extract page = uri.get();
+        if (!page)
+        {
+            return {false, "Could not fetch page: " + page.error};
+        }
+
+        std::lock_guard<std::mutex> lock(db_mutex);
+        db.store({string(uri_view), "", std::chrono::system_clock::now(),
+                  vector<string>(tags.begin(), tags.end()), page.title,
+                  page.description, page.fulltext},
+                 archive);
+    }
+    catch (const std::exception &e)
     {
-        ret = WEXITSTATUS(ret); // NOLINT(hicpp-signed-bitwise)
+        return {false, e.what()};
     }
 
-    return ret;
+    return {true, ""};
 }
@@ -5,25 +5,22 @@ let taburl = "";
 const txttags = document.getElementById("txttags");
 const chkarchive = document.getElementById("chkarchive");
 const btnadd = document.getElementById("btnadd");
+const btnaddall = document.getElementById("btnaddall");
 const msgstatus = document.getElementById("msgstatus");
 const msgerror = document.getElementById("msgerror");
-const separator = '\u001f';
 
 
 function set_taburl(tabs)       // Set taburl to URL of current tab.
 {
     const tab = tabs[0];
-    taburl = separator + tab.url + separator;
+    taburl = tab.url;
 }
 
 function get_tags()             // get tags from text input.
 {
-    const tags = txttags.value;
-    if (tags != "")
-    {
-        return separator + "-t " + tags;
-    }
-    return "";
+    return txttags.value.split(",")
+        .map((tag) => tag.trim())
+        .filter((tag) => tag !== "");
 }
 
 function read_options()
@@ -39,18 +36,24 @@ function read_options()
 }
 
 function onResponse(response) {
-    console.log("Received: " + response);
+    console.log("Received: " + JSON.stringify(response));
     msgstatus.textContent = "";
 
-    if (response == "Command successful.")
+    if (response.successful)
     {
         window.close();
     }
+    else if (response.results === undefined)
+    {
+        msgerror.textContent = response.error;
+    }
     else
     {
-        msgerror.textContent = response;
+        msgerror.textContent = response.results
+            .filter((result) => !result.successful)
+            .map((result) => result.uri + ": " + result.error)
+            .join("\n");
     }
-
 }
 
 function onError(error) {
@@ -59,25 +62,33 @@ function onError(error) {
     msgstatus.textContent = "";
 }
 
-function launch(args)           // Launch wrapper and send tags + URL to stdin.
+function launch(message)        // Send message to the wrapper.
 {
-    msgstatus.textContent = "Launching remwharead…";
+    msgstatus.textContent = "Saving…";
     msgerror.textContent = "";
-    console.log("Sending: " + args + " to remwharead");
-    const sending = browser.runtime.sendNativeMessage("remwharead", args);
+    console.log("Sending: " + JSON.stringify(message)
+                + " to background script");
+    const sending = browser.runtime.sendMessage(message);
     sending.then(onResponse, onError);
 }
 
-function add()
+function add(uris)
 {
-    let archive = "";
-    if (chkarchive.checked === false)
-    {
-        archive = separator + "--no-archive";
-    }
-    const args = get_tags() + archive + taburl;
-    console.log(args);
-    launch(args);
+    launch({
+        action: "add",
+        uris: uris,
+        tags: get_tags(),
+        archive: chkarchive.checked
+    });
+}
+
+function add_all()              // Add all tabs of the current window.
+{
+    browser.tabs.query({currentWindow: true}).then(
+        (tabs) =>
+            {
+                add(tabs.map((tab) => tab.url));
+            });
 }
 
 read_options();
@@ -85,15 +96,16 @@ read_options();
 // Call set_taburl() with current tab.
 browser.tabs.query({currentWindow: true, active: true}).then(set_taburl);
 
-btnadd.addEventListener("click", add);
+btnadd.addEventListener("click", () => add([taburl]));
+btnaddall.addEventListener("click", add_all);
 
-txttags.addEventListener(       // Call launch() if enter is hit in text input.
+txttags.addEventListener(       // Call add() if enter is hit in text input.
     "keyup", event =>
         {
             if(event.key !== "Enter")
             {
                 return;
             }
-            add();
+            add([taburl]);
             event.preventDefault();
         });
@@ -0,0 +1,170 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_ARCHIVE_QUEUE_HPP
+#define REMWHAREAD_ARCHIVE_QUEUE_HPP
+
+#include "sqlite.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace remwharead
+{
+using std::string;
+
+/*!
+ *  @brief  Archives the entries in the archive queue of the database.
+ *
+ *  Entries are added to the queue with Database::store(). Requests to the
+ *  archive service are rate limited, failed attempts are retried with
+ *  exponential backoff.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile archive_queue.hpp remwharead/archive_queue.hpp
+ */
+class ArchiveQueue
+{
+public:
+    /*!
+     *  @brief  How the queue is processed.
+     *
+     *  @since  0.10.0
+     *
+     *  @headerfile archive_queue.hpp remwharead/archive_queue.hpp
+     */
+    struct settings
+    {
+        /*!
+         *  @brief  The URL of the archive service.
+         *
+         *  Defaults to the Wayback Machine, or the environment variable
+         *  `REMWHAREAD_ARCHIVE_SERVICE`, if set. See URI::archive().
+         */
+        string service{default_service()};
+        //! Minimum time between 2 requests.
+        std::chrono::milliseconds interval{std::chrono::seconds(5)};
+        //! Wait time after the first failed attempt. Doubled every time.
+        std::chrono::seconds backoff{std::chrono::minutes(1)};
+        //! Maximum wait time between 2 attempts.
+        std::chrono::seconds max_backoff{std::chrono::hours(24)};
+        //! How long a job is reserved for this process while it is archived.
+        std::chrono::seconds lease{std::chrono::minutes(10)};
+        //! Give up after this many failed attempts.
+        unsigned max_attempts{10};
+        //! Write the archive URIs to the database after this many jobs.
+        size_t batch_size{16};
+    };
+
+    /*!
+     *  @brief  Prepare processing of the queue.
+     *
+     *  db is only accessed while db_mutex is locked.
+     *
+     *  @since  0.10.0
+     */
+    ArchiveQueue(const Database &db, std::mutex &db_mutex);
+
+    /*!
+     *  @brief  Prepare processing of the queue with custom settings.
+     *
+     *  @since  0.10.0
+     */
+    ArchiveQueue(const Database &db, std::mutex &db_mutex, settings config);
+
+    //! Calls stop().
+    ~ArchiveQueue();
+
+    ArchiveQueue(const ArchiveQueue &other) = delete;
+    ArchiveQueue &operator=(const ArchiveQueue &other) = delete;
+    ArchiveQueue(ArchiveQueue &&other) = delete;
+    ArchiveQueue &operator=(ArchiveQueue &&other) = delete;
+
+    /*!
+     *  @brief  Process the queue in a background thread.
+     *
+     *  @since  0.10.0
+     */
+    void start();
+
+    /*!
+     *  @brief  Stop the background thread.
+     *
+     *  The current request is finished and its result written to the
+     *  database.
+     *
+     *  @since  0.10.0
+     */
+    void stop();
+
+    /*!
+     *  @brief  Tell the background thread that jobs were added.
+     *
+     *  @since  0.10.0
+     */
+    void notify();
+
+    /*!
+     *  @brief  Process the jobs that are due in this thread.
+     *
+     *  Every job is reserved in the database before the request is sent, so
+     *  that other processes skip it.
+     *
+     *  @param  uri Only process the jobs of this URI, if not empty.
+     *
+     *  @return Number of processed jobs.
+     *
+     *  @since  0.10.0
+     */
+    size_t run_once(const string &uri = "");
+
+    /*!
+     *  @brief  Returns how long to wait after a failed attempt.
+     *
+     *  @param  attempts Number of failed attempts, including this one.
+     *
+     *  @return Nothing if the job should be given up.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static std::optional<std::chrono::seconds>
+    backoff(unsigned attempts, const settings &config);
+
+private:
+    const Database &_db;
+    std::mutex &_db_mutex;
+    const settings _config;
+    std::chrono::steady_clock::time_point _last_request;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop;
+    bool _notified;
+
+    [[nodiscard]] static string default_service();
+
+    //! Wait until the rate limit allows the next request. False if stopped.
+    bool wait_for_slot();
+
+    void run();
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_ARCHIVE_QUEUE_HPP
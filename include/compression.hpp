@@ -0,0 +1,113 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_COMPRESSION_HPP
+#define REMWHAREAD_COMPRESSION_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  Compresses text with zstd, optionally with a dictionary.
+ *
+ *  All functions throw std::runtime_error if remwharead was compiled
+ *  without zstd, see available().
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile compression.hpp remwharead/compression.hpp
+ */
+class Compressor
+{
+public:
+    /*!
+     *  @brief  Use this dictionary for compression and decompression.
+     *
+     *  @param  dictionary A dictionary created by train(), or empty.
+     *
+     *  @since  0.10.0
+     */
+    explicit Compressor(string dictionary = {});
+    ~Compressor();
+
+    Compressor(const Compressor &other) = delete;
+    Compressor &operator=(const Compressor &other) = delete;
+    Compressor(Compressor &&other) = delete;
+    Compressor &operator=(Compressor &&other) = delete;
+
+    /*!
+     *  @brief  Returns true if remwharead was compiled with zstd.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static bool available();
+
+    /*!
+     *  @brief  Compress text.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] string compress(string_view text) const;
+
+    /*!
+     *  @brief  Decompress data into buffer.
+     *
+     *  The buffer is reused, so that repeated calls don't allocate memory.
+     *
+     *  @return The text, pointing into buffer.
+     *
+     *  @since  0.10.0
+     */
+    string_view decompress(string_view data, string &buffer) const;
+
+    /*!
+     *  @brief  Create a dictionary from sample texts.
+     *
+     *  @param  samples  Typical texts. Should be about 100 times as big as
+     *                   the dictionary in total.
+     *  @param  max_size Maximum size of the dictionary in bytes.
+     *
+     *  @return The dictionary, or nothing if the samples are not suitable.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static string train(const vector<string> &samples,
+                                      size_t max_size = 112640);
+
+    //! The dictionary.
+    [[nodiscard]] const string &dictionary() const;
+
+private:
+    struct contexts;
+
+    const string _dictionary;
+    //! Compression and decompression state, reused for every call.
+    const std::unique_ptr<contexts> _contexts;
+    mutable std::mutex _mutex;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_COMPRESSION_HPP
@@ -0,0 +1,105 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_DICTIONARY_HPP
+#define REMWHAREAD_DICTIONARY_HPP
+
+#include "entry_table.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  A sorted list of words, that finds words with typos.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile dictionary.hpp remwharead/dictionary.hpp
+ */
+class Dictionary
+{
+public:
+    Dictionary() = default;
+
+    /*!
+     *  @brief  Sort the words and remove duplicates.
+     *
+     *  @since  0.10.0
+     */
+    explicit Dictionary(vector<string> words);
+
+    /*!
+     *  @brief  The lowercase words of the URIs, tags, titles, descriptions
+     *          and full texts.
+     *
+     *  Words are split like for_each_word() does.
+     *
+     *  @since  0.10.0
+     */
+    explicit Dictionary(const EntryTable &entries);
+
+    /*!
+     *  @brief  Returns the words that are at most max_distance edits away
+     *          from word.
+     *
+     *  An edit is inserting, removing or replacing a byte, so replacing a
+     *  character that is not ASCII usually counts as 2 edits. Instead of
+     *  comparing word with every word, the dictionary is walked like a trie:
+     *  Words with the same start share the work for it, and words that
+     *  start too differently are skipped.
+     *
+     *  @return The words, the most similar first.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] vector<string> find(string_view word,
+                                      size_t max_distance) const;
+
+    //! Number of words.
+    [[nodiscard]] size_t size() const;
+
+    //! The word at index, in sorted order.
+    [[nodiscard]] string_view operator[](size_t index) const;
+
+private:
+    friend class Snapshot;
+
+    size_t _size{0};
+    //! Word i is _text[_offsets[i], _offsets[i + 1]).
+    const std::uint64_t *_offsets{nullptr};
+    const char *_text{nullptr};
+    //! Keeps the memory the pointers point into.
+    std::shared_ptr<const void> _memory;
+};
+
+/*!
+ *  @brief  Returns the Levenshtein distance of a and b, in bytes.
+ *
+ *  @since  0.10.0
+ */
+[[nodiscard]] size_t edit_distance(string_view a, string_view b);
+} // namespace remwharead
+
+#endif  // REMWHAREAD_DICTIONARY_HPP
@@ -0,0 +1,612 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_ENTRY_TABLE_HPP
+#define REMWHAREAD_ENTRY_TABLE_HPP
+
+#include "sqlite.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace remwharead
+{
+using std::list;
+using std::optional;
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  Compact storage for many Database::entry.
+ *
+ *  The table is stored column-wise: Every string field is kept in one
+ *  contiguous buffer, tags are interned into ids. Rows are addressed by index
+ *  and accessed through EntryTable::row, which returns `string_view`s into the
+ *  table. Adding a row does not allocate memory per entry.
+ *
+ *  All memory is allocated from a `std::pmr::memory_resource`. Pass a
+ *  `std::pmr::monotonic_buffer_resource` to keep the data of a query in a few
+ *  large blocks that are released at once. Copies allocate from the memory
+ *  resource of the original. A table that is assigned to keeps its memory
+ *  resource, like the standard containers: Moving copies the data if the
+ *  memory resources are different.
+ *
+ *  A table can also be read from a Snapshot. These tables are read-only.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile entry_table.hpp remwharead/entry_table.hpp
+ */
+class EntryTable
+{
+public:
+    //! Interned tag.
+    using tag_id = std::uint32_t;
+
+    /*!
+     *  @brief  The tags of a row.
+     *
+     *  Iterating yields the tag names as `string_view`.
+     *
+     *  @since  0.10.0
+     */
+    class tag_list
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const string_view *;
+            using reference = string_view;
+
+            iterator(const EntryTable *table, const tag_id *pos)
+                : _table{table}
+                , _pos{pos}
+            {}
+
+            string_view operator*() const
+            {
+                return _table->tag_name(*_pos);
+            }
+
+            iterator &operator++()
+            {
+                ++_pos;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator old{*this};
+                ++_pos;
+                return old;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return _pos == other._pos;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return _pos != other._pos;
+            }
+
+        private:
+            const EntryTable *_table;
+            const tag_id *_pos;
+        };
+
+        tag_list(const EntryTable *table, const tag_id *first,
+                 const tag_id *last)
+            : _table{table}
+            , _first{first}
+            , _last{last}
+        {}
+
+        [[nodiscard]] iterator begin() const
+        {
+            return {_table, _first};
+        }
+
+        [[nodiscard]] iterator end() const
+        {
+            return {_table, _last};
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return static_cast<size_t>(_last - _first);
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return _first == _last;
+        }
+
+        //! The ids of the tags.
+        [[nodiscard]] const tag_id *ids() const
+        {
+            return _first;
+        }
+
+    private:
+        const EntryTable *_table;
+        const tag_id *_first;
+        const tag_id *_last;
+    };
+
+    /*!
+     *  @brief  A view of one row.
+     *
+     *  Only valid as long as the table is alive and not modified.
+     *
+     *  @since  0.10.0
+     */
+    class row
+    {
+    public:
+        row(const EntryTable *table, size_t index)
+            : _table{table}
+            , _index{index}
+        {}
+
+        [[nodiscard]] size_t index() const
+        {
+            return _index;
+        }
+
+        [[nodiscard]] string_view uri() const
+        {
+            return _table->get(field::uri, _index);
+        }
+
+        [[nodiscard]] string_view archive_uri() const
+        {
+            return _table->get(field::archive_uri, _index);
+        }
+
+        [[nodiscard]] time_point datetime() const
+        {
+            return _table->get_datetime(_index);
+        }
+
+        [[nodiscard]] tag_list tags() const
+        {
+            return _table->get_tags(_index);
+        }
+
+        [[nodiscard]] string_view title() const
+        {
+            return _table->get(field::title, _index);
+        }
+
+        [[nodiscard]] string_view description() const
+        {
+            return _table->get(field::description, _index);
+        }
+
+        [[nodiscard]] string_view fulltext() const
+        {
+            return _table->get(field::fulltext, _index);
+        }
+
+        /*!
+         *  @brief  The title, converted with fold_case().
+         *
+         *  Only available if EntryTable::has_folded() is true.
+         *
+         *  @since  0.10.0
+         */
+        [[nodiscard]] string_view folded_title() const
+        {
+            return _table->get_folded(field::title, _index);
+        }
+
+        //! Like folded_title().
+        [[nodiscard]] string_view folded_description() const
+        {
+            return _table->get_folded(field::description, _index);
+        }
+
+        //! Like folded_title().
+        [[nodiscard]] string_view folded_fulltext() const
+        {
+            return _table->get_folded(field::fulltext, _index);
+        }
+
+        //! Returns tags as comma separated string.
+        [[nodiscard]] string tags_to_string() const;
+
+        //! The full text in one line.
+        [[nodiscard]] string fulltext_oneline() const;
+
+        //! Copy the row into a Database::entry.
+        [[nodiscard]] Database::entry to_entry() const;
+
+    private:
+        const EntryTable *_table;
+        size_t _index;
+    };
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const row *;
+        using reference = row;
+
+        const_iterator(const EntryTable *table, size_t index)
+            : _table{table}
+            , _index{index}
+        {}
+
+        row operator*() const
+        {
+            return {_table, _index};
+        }
+
+        const_iterator &operator++()
+        {
+            ++_index;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator old{*this};
+            ++_index;
+            return old;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return _index != other._index;
+        }
+
+    private:
+        const EntryTable *_table;
+        size_t _index;
+    };
+
+    /*!
+     *  @brief  Construct an empty table.
+     *
+     *  @param  resource Memory resource to allocate from.
+     *
+     *  @since  0.10.0
+     */
+    explicit EntryTable(std::pmr::memory_resource *resource
+                        = std::pmr::get_default_resource());
+
+    /*!
+     *  @brief  Copy list of Database::entry into the table.
+     *
+     *  @param  entries  List of Database::entry.
+     *  @param  resource Memory resource to allocate from.
+     *
+     *  @since  0.10.0
+     */
+    explicit EntryTable(const list<Database::entry> &entries,
+                        std::pmr::memory_resource *resource
+                        = std::pmr::get_default_resource());
+
+    /*!
+     *  @brief  Copy a table, using the same memory resource.
+     *
+     *  @since  0.10.0
+     */
+    EntryTable(const EntryTable &other);
+
+    //! Move a table, with its memory resource. @since 0.10.0
+    EntryTable(EntryTable &&other) noexcept = default;
+
+    //! Copy a table, keeping the memory resource. @since 0.10.0
+    EntryTable &operator=(const EntryTable &other);
+
+    /*!
+     *  @brief  Move a table, keeping the memory resource.
+     *
+     *  The data is copied if the memory resources are not equal.
+     *
+     *  @since  0.10.0
+     */
+    EntryTable &operator=(EntryTable &&other);
+
+    ~EntryTable() = default;
+
+    /*!
+     *  @brief  Append a Database::entry.
+     *
+     *  @exception std::logic_error if the table is read-only.
+     *
+     *  @since  0.10.0
+     */
+    void push_back(const Database::entry &entry);
+
+    /*!
+     *  @brief  Append a row.
+     *
+     *  @param  tags Comma separated tags, like in the database.
+     *
+     *  @exception std::logic_error if the table is read-only.
+     *
+     *  @since  0.10.0
+     */
+    void push_back(string_view uri, string_view archive_uri,
+                   const time_point &datetime, string_view tags,
+                   string_view title, string_view description,
+                   string_view fulltext);
+
+    /*!
+     *  @brief  Append a row of another table.
+     *
+     *  @exception std::logic_error if the table is read-only.
+     *
+     *  @since  0.10.0
+     */
+    void push_back(const row &other);
+
+    /*!
+     *  @brief  Reserve memory for rows and bytes of text.
+     *
+     *  @since  0.10.0
+     */
+    void reserve(size_t rows, size_t bytes = 0);
+
+    //! Number of rows.
+    [[nodiscard]] size_t size() const
+    {
+        return _mapped ? _mapped->rows : _datetimes.size();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /*!
+     *  @brief  Returns true if the table is read from a Snapshot.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] bool read_only() const
+    {
+        return _mapped != nullptr;
+    }
+
+    /*!
+     *  @brief  Returns true if the rows have lowercase copies of the title,
+     *          description and full text.
+     *
+     *  Tables read from a Snapshot have them.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] bool has_folded() const
+    {
+        return _mapped != nullptr;
+    }
+
+    [[nodiscard]] row operator[](size_t index) const
+    {
+        return {this, index};
+    }
+
+    [[nodiscard]] const_iterator begin() const
+    {
+        return {this, 0};
+    }
+
+    [[nodiscard]] const_iterator end() const
+    {
+        return {this, size()};
+    }
+
+    /*!
+     *  @brief  Returns the name of a tag.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] string_view tag_name(tag_id id) const
+    {
+        if (_mapped)
+        {
+            return _mapped->get(_mapped->tag_names, _mapped->tag_name_offsets,
+                                id);
+        }
+        return _tag_names[id];
+    }
+
+    /*!
+     *  @brief  Returns the id of a tag, if it is in the table.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] optional<tag_id> find_tag(string_view name) const;
+
+    /*!
+     *  @brief  Number of distinct tags.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] size_t tag_count() const
+    {
+        return _mapped ? _mapped->n_tags : _tag_names.size();
+    }
+
+    /*!
+     *  @brief  The memory resource the table allocates from.
+     *
+     *  Read-only tables return the memory resource they were constructed
+     *  with, for tables made from them.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] std::pmr::memory_resource *resource() const
+    {
+        return _datetimes.get_allocator().resource();
+    }
+
+    /*!
+     *  @brief  Returns a new table with the rows at `indices`, in that order.
+     *
+     *  @param  indices  The rows.
+     *  @param  resource Memory resource of the new table. The memory
+     *                   resource of this table is used if it is nullptr.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] EntryTable
+    select(const vector<size_t> &indices,
+           std::pmr::memory_resource *resource = nullptr) const;
+
+    /*!
+     *  @brief  Returns the indices of the rows, sorted from newest to oldest.
+     *
+     *  Rows with the same date and time keep their order.
+     *
+     *  @param  unique Only return the first of rows with the same date and
+     *                 time.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] vector<size_t> order_by_datetime(bool unique = false) const;
+
+    /*!
+     *  @brief  Copy the table into a list of Database::entry.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] list<Database::entry> to_list() const;
+
+private:
+    friend class Snapshot;
+
+    enum field : std::uint8_t
+    {
+        uri,
+        archive_uri,
+        title,
+        description,
+        fulltext
+    };
+    static constexpr size_t n_fields = 5;
+    //! Title, description and full text have lowercase copies.
+    static constexpr size_t n_folded = 3;
+
+    //! One buffer per string field.
+    std::array<std::pmr::string, n_fields> _columns;
+    //! Start of the field of every row in the buffer, plus the end.
+    std::array<std::pmr::vector<size_t>, n_fields> _offsets;
+    std::pmr::vector<time_point> _datetimes;
+    //! Tag ids of all rows.
+    std::pmr::vector<tag_id> _tags;
+    //! Start of the tags of every row in _tags, plus the end.
+    std::pmr::vector<size_t> _tag_offsets;
+    std::pmr::vector<std::pmr::string> _tag_names;
+    std::pmr::unordered_map<std::pmr::string, tag_id> _tag_ids;
+
+    /*!
+     *  @brief  The data of a read-only table, in memory owned by a Snapshot.
+     *
+     *  Laid out like the members above.
+     */
+    struct mapping
+    {
+        std::array<const char *, n_fields> columns{};
+        std::array<const std::uint64_t *, n_fields> offsets{};
+        //! Nanoseconds since the epoch.
+        const std::int64_t *datetimes{nullptr};
+        const tag_id *tags{nullptr};
+        const std::uint64_t *tag_offsets{nullptr};
+        const char *tag_names{nullptr};
+        const std::uint64_t *tag_name_offsets{nullptr};
+        //! Tag ids, sorted by name.
+        const tag_id *tags_by_name{nullptr};
+        //! Lowercase copies of the fields from title on.
+        std::array<const char *, n_folded> folded{};
+        std::array<const std::uint64_t *, n_folded> folded_offsets{};
+        size_t rows{0};
+        size_t n_tags{0};
+        //! Keeps the memory alive.
+        std::shared_ptr<const void> memory;
+
+        [[nodiscard]] static string_view get(const char *data,
+                                             const std::uint64_t *offsets,
+                                             const size_t index)
+        {
+            return string_view(data + offsets[index],
+                               offsets[index + 1] - offsets[index]);
+        }
+    };
+    //! Nullptr if the table owns its data.
+    std::shared_ptr<const mapping> _mapped;
+
+    [[nodiscard]] string_view get(field f, size_t index) const
+    {
+        if (_mapped)
+        {
+            return mapping::get(_mapped->columns[f], _mapped->offsets[f],
+                                index);
+        }
+        const std::pmr::vector<size_t> &offsets = _offsets[f];
+        return string_view(_columns[f]).substr(offsets[index],
+                                               offsets[index + 1]
+                                                   - offsets[index]);
+    }
+
+    [[nodiscard]] string_view get_folded(const field f,
+                                         const size_t index) const
+    {
+        const size_t folded = f - field::title;
+        return mapping::get(_mapped->folded[folded],
+                            _mapped->folded_offsets[folded], index);
+    }
+
+    [[nodiscard]] time_point get_datetime(size_t index) const;
+
+    [[nodiscard]] tag_list get_tags(size_t index) const;
+
+    //! Append a string to a field. Throws if the table is read-only.
+    void add(field f, string_view text);
+
+    //! Returns the id of a tag, adds it if necessary.
+    tag_id intern_tag(string_view name);
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_ENTRY_TABLE_HPP
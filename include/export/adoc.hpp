@@ -19,6 +19,7 @@
 
 #include "export.hpp"
 #include "sqlite.hpp"
+#include "tag_index.hpp"
 #include <map>
 #include <string>
 #include <vector>
@@ -26,6 +27,7 @@
 namespace remwharead::Export
 {
 using std::string;
+using std::vector;
 
 /*!
  *  @brief  Export as %AsciiDoc document.
@@ -42,7 +44,6 @@ public:
     void print() const override;
 
 private:
-    using tagmap = std::map<string, list<Database::entry>>;
     using replacemap = const std::map<const string, const string>;
 
     //! Replace strings in text.
@@ -62,15 +63,15 @@ private:
     static string replace_in_uri(const string &text);
 
     //! Print things sorted by tag.
-    void print_tags(const tagmap &tags) const;
+    void print_tags(const TagIndex &tags) const;
 
-    //! Get ISO-8601 day from Database::entry.
+    //! Get ISO-8601 day from EntryTable::row.
     [[nodiscard]]
-    static string get_day(const Database::entry &entry);
+    static string get_day(const EntryTable::row &entry);
 
-    //! Get ISO-8601 time from Database::entry.
+    //! Get ISO-8601 time from EntryTable::row.
     [[nodiscard]]
-    static string get_time(const Database::entry &entry);
+    static string get_time(const EntryTable::row &entry);
 };
 } // namespace remwharead::Export
 
@@ -0,0 +1,52 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_EXPORT_ATOM_HPP
+#define REMWHAREAD_EXPORT_ATOM_HPP
+
+#include <string>
+#include "export/rss.hpp"
+
+namespace remwharead::Export
+{
+using std::string;
+
+/*!
+ *  @brief  Export as %Atom feed.
+ *
+ *  Has the same content as the %RSS feed.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile atom.hpp remwharead/export/atom.hpp
+ */
+class Atom : protected RSS
+{
+public:
+    using RSS::RSS;
+
+    void print() const override;
+
+private:
+    //! Append time_point to buffer, formatted according to RFC 3339.
+    static void append_rfc3339(string &buffer, const time_point &tp);
+
+    //! Append the entry of a row to buffer.
+    static void append_entry(string &buffer, const EntryTable::row &entry);
+};
+} // namespace remwharead::Export
+
+#endif  // REMWHAREAD_EXPORT_ATOM_HPP
@@ -19,10 +19,12 @@
 
 #include "export.hpp"
 #include <string>
+#include <string_view>
 
 namespace remwharead::Export
 {
     using std::string;
+    using std::string_view;
 
     /*!
      *  @brief  Export as Comma Separated Values.
@@ -41,7 +43,7 @@ namespace remwharead::Export
     private:
         //! replaces " with "".
         [[nodiscard]]
-        static string quote(string field);
+        static string quote(string_view field);
     };
 } // namespace remwharead::Export
 
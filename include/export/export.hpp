@@ -17,6 +17,7 @@
 #ifndef REMWHAREAD_EXPORT_EXPORT_HPP
 #define REMWHAREAD_EXPORT_EXPORT_HPP
 
+#include "entry_table.hpp"
 #include "sqlite.hpp"
 #include <iostream>
 #include <list>
@@ -44,6 +45,21 @@ public:
      */
     explicit ExportBase(const list<Database::entry> &entries,
                         ostream &out = cout);
+
+    /*!
+     *  @brief  Export EntryTable.
+     *
+     *  The sorted copy is allocated from the memory resource of `entries`.
+     *
+     *  @param  entries    EntryTable to export.
+     *  @param  out        Output stream.
+     *  @param  keep_order Export the entries in the given order, for example
+     *                     sorted by relevance, instead of newest first.
+     *
+     *  @since  0.10.0
+     */
+    explicit ExportBase(const EntryTable &entries, ostream &out = cout,
+                        bool keep_order = false);
     virtual ~ExportBase() = default;
     ExportBase(const ExportBase &) = delete;
     ExportBase &operator=(const ExportBase &) = delete;
@@ -57,18 +73,18 @@ public:
     virtual void print() const = 0;
 
 protected:
-    const list<Database::entry> _entries;
+    const EntryTable _entries;
     ostream &_out;
 
     /*!
      *  @brief  Sort entries from newest to oldest and remove duplicates.
      *
-     *  @param  entries List of Database::entry to sort.
+     *  @param  entries EntryTable to sort.
      *
-     *  @return Sorted list of Database::entry.
+     *  @return Sorted EntryTable.
      */
     [[nodiscard]]
-    static list<Database::entry> sort_entries(list<Database::entry> entries);
+    static EntryTable sort_entries(const EntryTable &entries);
 };
 } // namespace remwharead::Export
 
@@ -18,11 +18,13 @@
 #define REMWHAREAD_EXPORT_RSS_HPP
 
 #include <string>
+#include <string_view>
 #include "export.hpp"
 
 namespace remwharead::Export
 {
 using std::string;
+using std::string_view;
 
 /*!
  *  @brief  Export as %RSS feed.
@@ -37,6 +39,24 @@ public:
     using ExportBase::ExportBase;
 
     void print() const override;
+
+protected:
+    //! Append text to buffer, escaping XML special characters.
+    static void append_escaped(string &buffer, string_view text);
+
+    //! Append the title of a row to buffer, the description if it has none.
+    static void append_title(string &buffer, const EntryTable::row &entry);
+
+    //! Append description, tags and archive URI as escaped HTML to buffer.
+    static void append_description(string &buffer,
+                                   const EntryTable::row &entry);
+
+private:
+    //! Append time_point to buffer, formatted according to RFC 822.
+    static void append_rfc822(string &buffer, const time_point &tp);
+
+    //! Append the item of a row to buffer.
+    static void append_item(string &buffer, const EntryTable::row &entry);
 };
 } // namespace remwharead::Export
 
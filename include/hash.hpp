@@ -0,0 +1,53 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_HASH_HPP
+#define REMWHAREAD_HASH_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//! @file
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+
+/*!
+ *  @brief  Returns the XXH64 hash of data.
+ *
+ *  Compatible with the reference implementation of xxHash. Not suitable for
+ *  cryptographic purposes.
+ *
+ *  @since  0.10.0
+ */
+[[nodiscard]]
+std::uint64_t xxh64(string_view data, std::uint64_t seed = 0);
+
+/*!
+ *  @brief  Returns the hash of data as 16 hexadecimal digits.
+ *
+ *  Used to identify content in the database.
+ *
+ *  @since  0.10.0
+ */
+[[nodiscard]]
+string content_hash(string_view data);
+} // namespace remwharead
+
+#endif  // REMWHAREAD_HASH_HPP
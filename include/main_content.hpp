@@ -0,0 +1,49 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_MAIN_CONTENT_HPP
+#define REMWHAREAD_MAIN_CONTENT_HPP
+
+#include <string>
+#include <string_view>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+
+/*!
+ *  @brief  Returns the text of the main content of an HTML page.
+ *
+ *  Works like the reader view of browsers. Every paragraph gets a score for
+ *  its length and its commas, and the element around it and the element
+ *  around that one get the score too. The element with the best score, minus
+ *  the share of link text in it, is the main content. Elements next to it
+ *  with a good score are added. Navigation, sidebars, footers, comments and
+ *  paragraphs that are mostly links are left out.
+ *
+ *  The page is not parsed into a tree, so this is fast even for large pages.
+ *  HTML entities are not converted.
+ *
+ *  @return One line per paragraph, or an empty string if no main content was
+ *          found.
+ *
+ *  @since  0.10.0
+ */
+[[nodiscard]] string extract_main_content(string_view html);
+} // namespace remwharead
+
+#endif  // REMWHAREAD_MAIN_CONTENT_HPP
@@ -0,0 +1,147 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_PREFIX_INDEX_HPP
+#define REMWHAREAD_PREFIX_INDEX_HPP
+
+#include "entry_table.hpp"
+#include "tag_index.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  Finds the entries with words that start with a prefix.
+ *
+ *  The words of the URI, tags, title, description and full text are stored
+ *  in a sorted dictionary, in lowercase. The words that start with a prefix
+ *  are next to each other in the dictionary, so they are found with a
+ *  binary search. Words are separated by ASCII characters that are not
+ *  letters or digits.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile prefix_index.hpp remwharead/prefix_index.hpp
+ */
+class PrefixIndex
+{
+public:
+    PrefixIndex() = default;
+
+    /*!
+     *  @brief  Index the words of a table by row index.
+     *
+     *  @since  0.10.0
+     */
+    explicit PrefixIndex(const EntryTable &entries);
+
+    /*!
+     *  @brief  Returns the rows with a word that starts with prefix.
+     *
+     *  The prefix has to be lowercase.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] Bitmap find(string_view prefix) const;
+
+    /*!
+     *  @brief  Returns the candidates with a word that starts with prefix.
+     *
+     *  Like `find(prefix) &= candidates`, but only looks at the candidates
+     *  if there are fewer candidates than rows with a matching word.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] Bitmap narrow(const Bitmap &candidates,
+                                string_view prefix) const;
+
+    //! Number of indexed rows.
+    [[nodiscard]] size_t size() const;
+
+    //! All words, sorted.
+    [[nodiscard]] const vector<string> &words() const;
+
+private:
+    using word_id = std::uint32_t;
+
+    vector<string> _words;
+    //! The rows of word i are in _rows[_row_offsets[i], _row_offsets[i+1]).
+    vector<std::uint32_t> _row_offsets;
+    vector<std::uint32_t> _rows;
+    //! The sorted words of row i are in
+    //! _word_ids[_word_offsets[i], _word_offsets[i+1]).
+    vector<std::uint32_t> _word_offsets;
+    vector<word_id> _word_ids;
+
+    //! The ids of the words that start with prefix, [first, last).
+    [[nodiscard]] std::pair<word_id, word_id> range(string_view prefix)
+        const;
+};
+
+/*!
+ *  @brief  %Search while the user types.
+ *
+ *  Every word of the input has to be the start of a word in the entry. The
+ *  results of the previous input are kept, if the new input only adds
+ *  characters or words, only the previous results are searched.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile prefix_index.hpp remwharead/prefix_index.hpp
+ */
+class IncrementalSearch
+{
+public:
+    /*!
+     *  @brief  Index the entries to search.
+     *
+     *  @since  0.10.0
+     */
+    explicit IncrementalSearch(const EntryTable &entries);
+
+    /*!
+     *  @brief  Set the input and return the matching rows.
+     *
+     *  An empty input matches all rows.
+     *
+     *  @return The indices of the matching rows.
+     *
+     *  @since  0.10.0
+     */
+    const Bitmap &update(string_view input);
+
+    //! The matching rows of the last input.
+    [[nodiscard]] const Bitmap &results() const;
+
+private:
+    const PrefixIndex _index;
+    Bitmap _all;
+    //! The words of the input and the rows that match the words up to
+    //! there.
+    vector<std::pair<string, Bitmap>> _steps;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_PREFIX_INDEX_HPP
@@ -0,0 +1,166 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_QUERY_HPP
+#define REMWHAREAD_QUERY_HPP
+
+#include "time.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::vector;
+
+class Dictionary;
+
+/*!
+ *  @brief  A parsed search expression.
+ *
+ *  The expression is made of terms, combined with `OR` (`||`), `AND` (`&&`)
+ *  and `NOT`. `NOT` binds strongest, `OR` weakest. Parentheses group
+ *  expressions, terms next to each other without an operator between them
+ *  are combined with `AND`. Words next to each other form one term,
+ *  *Big Mountain* matches the text *big mountain*. Quotes make one term of
+ *  any text, including operators.
+ *
+ *  A term can be prefixed with a field: `tag:`, `title:`, `description:`,
+ *  `fulltext:` or `uri:`. `after:` and `before:` take a date in the format
+ *  of string_to_timepoint() instead of a term.
+ *
+ *  Regular expressions use parentheses and quotes themselves, so they have no
+ *  special meaning if the expression is a regular expression.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile query.hpp remwharead/query.hpp
+ */
+class Query
+{
+public:
+    //! The fields a term can be restricted to.
+    enum class field : std::uint8_t
+    {
+        tags,
+        title,
+        description,
+        fulltext,
+        uri
+    };
+
+    /*!
+     *  @brief  A node of the syntax tree.
+     *
+     *  @since  0.10.0
+     */
+    struct node
+    {
+        enum class kind : std::uint8_t
+        {
+            //! All terms are in the tags, or all are in the same text field.
+            text,
+            //! The term is in `in`.
+            field_term,
+            //! Added at or after `time`.
+            after,
+            //! Added before `time`.
+            before,
+            //! All children match. Matches everything if there are none.
+            all_of,
+            //! At least one child matches.
+            any_of,
+            //! The child doesn't match.
+            negation
+        };
+
+        kind type{kind::all_of};
+        field in{field::tags};
+        //! Lowercase terms.
+        vector<string> terms;
+        time_point time;
+        vector<node> children;
+    };
+
+    /*!
+     *  @brief  Parse a search expression.
+     *
+     *  @param  expression %Search expression.
+     *  @param  is_re      Are the terms regular expressions?
+     *
+     *  @exception std::invalid_argument if the expression is malformed.
+     *
+     *  @since  0.10.0
+     */
+    Query(const string &expression, bool is_re);
+
+    //! The root of the syntax tree.
+    [[nodiscard]] const node &root() const;
+
+    //! Are the terms regular expressions?
+    [[nodiscard]] bool is_re() const;
+
+    /*!
+     *  @brief  The distinct terms that have to be found, not those after
+     *          `NOT`.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] vector<string> terms() const;
+
+    /*!
+     *  @brief  Returns true if a search in tags needs nothing but the tags.
+     *
+     *  That is, the expression has no `NOT`, no dates and no fields other than
+     *  `tag:`.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] bool only_tags() const;
+
+    /*!
+     *  @brief  Returns the syntax tree as text.
+     *
+     *  Expressions that only differ in whitespace, the spelling of operators,
+     *  the case of terms or redundant parentheses have the same text.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] string normalized() const;
+
+    /*!
+     *  @brief  Returns a copy of the query that tolerates typos.
+     *
+     *  Every term also matches the most similar words in `words`, at most
+     *  16. Terms with 3 to 5 bytes may be 1 edit away, longer terms 2 edits.
+     *  Terms combined with `AND` no longer have to be in the same field.
+     *  Regular expressions are not changed.
+     *
+     *  @param  words The words that can be meant, like the tags or the words
+     *                of the entries.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] Query fuzzy(const Dictionary &words) const;
+
+private:
+    node _root;
+    bool _is_re;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_QUERY_HPP
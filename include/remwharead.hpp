@@ -39,7 +39,12 @@
  *  Or compile your code with `g++ $(pkg-config --cflags --libs remwharead)`.
  */
 
+#include "archive_queue.hpp"
+#include "compression.hpp"
+#include "dictionary.hpp"
+#include "entry_table.hpp"
 #include "export/adoc.hpp"
+#include "export/atom.hpp"
 #include "export/bookmarks.hpp"
 #include "export/csv.hpp"
 #include "export/export.hpp"
@@ -48,9 +53,18 @@
 #include "export/simple.hpp"
 #include "export/list.hpp"
 #include "export/rofi.hpp"
+#include "hash.hpp"
+#include "main_content.hpp"
+#include "prefix_index.hpp"
+#include "query.hpp"
+#include "result_cache.hpp"
 #include "search.hpp"
+#include "snapshot.hpp"
 #include "sqlite.hpp"
+#include "tag_index.hpp"
+#include "term_matcher.hpp"
 #include "time.hpp"
+#include "trigram_index.hpp"
 #include "types.hpp"
 #include "uri.hpp"
 
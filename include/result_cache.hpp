@@ -0,0 +1,112 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_RESULT_CACHE_HPP
+#define REMWHAREAD_RESULT_CACHE_HPP
+
+#include "entry_table.hpp"
+#include "sqlite.hpp"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace remwharead
+{
+using std::string;
+
+/*!
+ *  @brief  Keeps the results of recent searches until the database changes.
+ *
+ *  Every result belongs to a key, which describes the search, and to the
+ *  Database::revision it was computed from. Results of other revisions are
+ *  never returned. If the cache is full, the least recently used results are
+ *  dropped.
+ *
+ *  All methods are thread-safe.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile result_cache.hpp remwharead/result_cache.hpp
+ */
+class ResultCache
+{
+public:
+    /*!
+     *  @brief  Construct an empty cache.
+     *
+     *  @param  max_bytes Keep results up to about this many bytes of text.
+     *
+     *  @since  0.10.0
+     */
+    explicit ResultCache(size_t max_bytes = 64 * 1024 * 1024);
+
+    /*!
+     *  @brief  Returns the result for key, nullptr if there is none for this
+     *          revision.
+     *
+     *  Archive URIs are not searched. If archive_outdated is not nullptr and
+     *  only archive URIs were set since the result was stored, the result is
+     *  returned and `*archive_outdated` is set to true. Its archive URIs have
+     *  to be updated then.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] std::shared_ptr<const EntryTable>
+    find(const string &key, const Database::revision &revision,
+         bool *archive_outdated = nullptr);
+
+    /*!
+     *  @brief  Store the result for key, replacing older results.
+     *
+     *  The entries are copied, the table can use a short-lived memory
+     *  resource. Results that are larger than the cache are not stored.
+     *
+     *  @return The stored result.
+     *
+     *  @since  0.10.0
+     */
+    std::shared_ptr<const EntryTable>
+    insert(const string &key, const Database::revision &revision,
+           const EntryTable &entries);
+
+    //! Number of stored results.
+    [[nodiscard]] size_t size() const;
+
+private:
+    struct cached
+    {
+        string key;
+        Database::revision revision;
+        std::shared_ptr<const EntryTable> entries;
+        size_t bytes;
+    };
+
+    mutable std::mutex _mutex;
+    const size_t _max_bytes;
+    size_t _bytes;
+    //! The most recently used result first.
+    std::list<cached> _results;
+    std::unordered_map<string, std::list<cached>::iterator> _index;
+
+    //! Remove a result. _mutex has to be locked.
+    void erase(std::list<cached>::iterator it);
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_RESULT_CACHE_HPP
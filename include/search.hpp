@@ -17,15 +17,23 @@
 #ifndef REMWHAREAD_SEARCH_HPP
 #define REMWHAREAD_SEARCH_HPP
 
+#include "dictionary.hpp"
+#include "entry_table.hpp"
+#include "query.hpp"
 #include "sqlite.hpp"
+#include "tag_index.hpp"
+#include "trigram_index.hpp"
 #include <list>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace remwharead
 {
 using std::list;
 using std::string;
+using std::string_view;
 using std::vector;
 
 /*!
@@ -38,19 +46,65 @@ using std::vector;
 class Search
 {
 public:
+    /*!
+     *  @brief  A search result and its relevance.
+     *
+     *  @since  0.10.0
+     */
+    struct ranked
+    {
+        //! Index into entries().
+        size_t index;
+        //! Higher is more relevant.
+        double score;
+    };
+
     /*!
      *  @brief  Defines the entries to search.
      *
      *  @since  0.7.0
      */
-    explicit Search(list<Database::entry> entries);
+    explicit Search(const list<Database::entry> &entries);
+
+    /*!
+     *  @brief  Defines the entries to search.
+     *
+     *  Tables of results are allocated from the memory resource of `entries`.
+     *
+     *  @since  0.10.0
+     */
+    explicit Search(EntryTable entries);
+
+    /*!
+     *  @brief  Defines the entries to search and their trigrams.
+     *
+     *  Searches with regular expressions only look at the entries that
+     *  contain the trigrams the regular expressions need.
+     *
+     *  @param  entries  The entries.
+     *  @param  trigrams Index of entries, like Snapshot::trigrams().
+     *
+     *  @since  0.10.0
+     */
+    Search(EntryTable entries, TrigramIndex trigrams);
+
+    /*!
+     *  @brief  Defines the entries to search, their trigrams and their
+     *          words.
+     *
+     *  The words are used for fuzzy searches, instead of collecting them
+     *  from the entries for every search.
+     *
+     *  @since  0.10.0
+     */
+    Search(EntryTable entries, TrigramIndex trigrams, Dictionary words);
 
     /*!
      *  @brief  %Search in tags of database entries.
      *
      *  Only matches whole tags, *Pill* does not match *Pillow*.
      *
-     *  @param  expression %Search expression.
+     *  @param  expression %Search expression, see Query.
      *  @param  is_re      Is it a regular expression?
      *
      *  @return List of matching Database::entry.
@@ -64,9 +118,10 @@ public:
     /*!
      *  @brief  %Search in full text of database entries.
      *
-     *  Searches in tags, title, description and full text.
+     *  Searches in tags, title, description and full text. Terms that are
+     *  combined with `AND` have to be in the same field, or all in the tags.
      *
-     *  @param  expression %Search expression.
+     *  @param  expression %Search expression, see Query.
      *  @param  is_re      Is it a regular expression?
      *
      *  @return List of matching Database::entry.
@@ -95,22 +150,174 @@ public:
     list<Database::entry> search_all_threaded(const string &expression,
                                               bool is_re) const;
 
+    /*!
+     *  @brief  Like search_tags(), but returns indices into entries().
+     *
+     *  @param  fuzzy Also find tags with typos, see Query::fuzzy().
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<size_t> find_tags(const string &expression, bool is_re,
+                             bool fuzzy = false) const;
+
+    /*!
+     *  @brief  Like search_all(), but returns indices into entries().
+     *
+     *  @param  fuzzy Also find words with typos, see Query::fuzzy().
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<size_t> find_all(const string &expression, bool is_re,
+                            bool fuzzy = false) const;
+
+    /*!
+     *  @brief  Like search_all_threaded(), but returns indices into
+     *          entries().
+     *
+     *  @param  fuzzy Also find words with typos, see Query::fuzzy().
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<size_t> find_all_threaded(const string &expression, bool is_re,
+                                     bool fuzzy = false) const;
+
+    /*!
+     *  @brief  Like find_all_threaded(), but sorted by relevance.
+     *
+     *  The relevance is computed with BM25F: Matches in tags and the title
+     *  count more than matches in the description and the full text, long
+     *  texts count less than short ones and terms that occur in many entries
+     *  count less than rare ones. With regular expressions, a field either
+     *  matches or doesn't.
+     *
+     *  Only the best `limit` results are kept while searching.
+     *
+     *  @param  expression %Search expression.
+     *  @param  is_re      Is it a regular expression?
+     *  @param  limit      Return at most this many results. 0 means no
+     *                     limit.
+     *  @param  fuzzy      Also find words with typos, see Query::fuzzy().
+     *
+     *  @return The matching entries, the most relevant first.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<ranked> rank_all(const string &expression, bool is_re,
+                            size_t limit = 0, bool fuzzy = false) const;
+
+    /*!
+     *  @brief  %Search in the tags of a TagIndex.
+     *
+     *  Like find_tags(), but returns the ids used in `index`, like the row
+     *  ids of Database::tag_index(). Only works for expressions where
+     *  Query::only_tags() is true.
+     *
+     *  @param  fuzzy Also find tags with typos, see Query::fuzzy().
+     *
+     *  @exception std::invalid_argument if the expression is malformed or
+     *             needs more than tags.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    static Bitmap find_tags(const TagIndex &index, const string &expression,
+                            bool is_re, bool fuzzy = false);
+
+    /*!
+     *  @brief  The entries that are searched.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    const EntryTable &entries() const;
+
 private:
-    const list<Database::entry> _entries;
+    const EntryTable _entries;
+    //! The tags of _entries, by row index.
+    const TagIndex _tag_index;
+    //! The trigrams of _entries, may be empty.
+    const TrigramIndex _trigrams;
+    //! The words of _entries, if they were given.
+    const std::optional<Dictionary> _words;
+
+    //! Matching rows and how often each term occurs, see rank_all().
+    struct term_counts;
 
     /*!
-     *  @brief  Split expression into subexpressions.
+     *  @brief  Parse expression, make it fuzzy if requested.
      *
-     *  First it splits at `OR` or `||`, then it splits the subexpressions
-     *  at `AND` or `&&`. The first vector contains all tags before the
-     *  first `OR`.
+     *  @param  in_tags Typos are corrected to tags, not to words.
      *
-     *  @return Vector of `OR`-vectors of `AND`-tags.
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    Query parse(const string &expression, bool is_re, bool fuzzy,
+                bool in_tags) const;
+
+    //! The lowercase tags of index.
+    [[nodiscard]]
+    static Dictionary tag_dictionary(const TagIndex &index);
+
+    //! Throw std::invalid_argument if _trigrams is not of _entries.
+    void check_trigrams() const;
+
+    /*!
+     *  @brief  Returns the ids of the entries whose tags match node.
      *
-     *  @since  0.7.0
+     *  @exception std::invalid_argument if node needs more than tags.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    static Bitmap match_tags(const TagIndex &index, const Query::node &node,
+                             bool is_re);
+
+    /*!
+     *  @brief  Returns the rows in [first, last) that match query.
+     *
+     *  @param  in_tags Search only in tags, like find_tags().
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    Bitmap evaluate(const Query &query, size_t first, size_t last,
+                    bool in_tags) const;
+
+    /*!
+     *  @brief  Returns the candidates that match node.
+     *
+     *  The cheap parts of the expression are evaluated first, the expensive
+     *  parts only for the candidates that are left.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    Bitmap evaluate(const Query::node &node, bool is_re, Bitmap candidates,
+                    bool in_tags) const;
+
+    /*!
+     *  @brief  Count the terms in the rows in [first, last).
+     *
+     *  @param  terms The terms of query.
+     *
+     *  @since  0.10.0
+     */
+    void count_terms(const Query &query, const vector<string> &terms,
+                     size_t first, size_t last, term_counts &result) const;
+
+    /*!
+     *  @brief  Split [0, len) into segments for threads.
+     *
+     *  @return The start of every segment, plus len.
+     *
+     *  @since  0.10.0
      */
     [[nodiscard]]
-    static vector<vector<string>> parse_expression(const string &expression);
+    static vector<size_t> segments(size_t len);
 
     /*!
      *  @brief  Convert str to lowercase. Works with unicode.
@@ -118,7 +325,7 @@ private:
      *  @since  0.7.0
      */
     [[nodiscard]]
-    static inline string to_lowercase(const string &str);
+    static inline string to_lowercase(string_view str);
 };
 } // namespace remwharead
 
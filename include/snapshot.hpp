@@ -0,0 +1,157 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_SNAPSHOT_HPP
+#define REMWHAREAD_SNAPSHOT_HPP
+
+#include "dictionary.hpp"
+#include "entry_table.hpp"
+#include "sqlite.hpp"
+#include "trigram_index.hpp"
+#include <cstddef>
+#include <experimental/filesystem>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace remwharead
+{
+namespace fs = std::experimental::filesystem;
+using std::vector;
+
+/*!
+ *  @brief  A read-only copy of the database in a memory-mapped file.
+ *
+ *  The file contains the columns of an EntryTable as they are in memory, so
+ *  opening it does not need to parse anything. The rows are in the order
+ *  they were added to the database.
+ *
+ *  The file is only valid on machines with the same byte order.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile snapshot.hpp remwharead/snapshot.hpp
+ */
+class Snapshot
+{
+public:
+    /*!
+     *  @brief  Map a snapshot file into memory.
+     *
+     *  @exception std::runtime_error if the file can not be read or is not a
+     *             snapshot.
+     *
+     *  @since  0.10.0
+     */
+    explicit Snapshot(const fs::path &path);
+
+    /*!
+     *  @brief  The entries, as a read-only EntryTable.
+     *
+     *  Copies of the table keep the file mapped.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] const EntryTable &entries() const;
+
+    /*!
+     *  @brief  The trigrams of the entries, for regular expression searches.
+     *
+     *  Copies of the index keep the file mapped.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] const TrigramIndex &trigrams() const;
+
+    /*!
+     *  @brief  The words of the entries, for fuzzy searches.
+     *
+     *  Copies of the dictionary keep the file mapped.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] const Dictionary &words() const;
+
+    /*!
+     *  @brief  The revision of the database the snapshot was made from.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] const Database::revision &revision() const;
+
+    /*!
+     *  @brief  Write entries into a snapshot file.
+     *
+     *  The file is replaced atomically, snapshots of the old file stay valid.
+     *
+     *  @exception std::runtime_error if the file can not be written.
+     *
+     *  @since  0.10.0
+     */
+    static void write(const fs::path &path, const EntryTable &entries,
+                      const Database::revision &revision);
+
+    /*!
+     *  @brief  Create or update a snapshot of the database.
+     *
+     *  Nothing is done if the database did not change. If entries were only
+     *  added or archived since the snapshot was made, only the new entries
+     *  and the archive URIs are read from the database and only the new
+     *  entries are indexed, the trigrams and words of the old entries are
+     *  taken from the snapshot.
+     *
+     *  db is only accessed while db_mutex is locked, the file is written
+     *  without it.
+     *
+     *  @return Number of entries read from the database.
+     *
+     *  @exception std::runtime_error if the file can not be written.
+     *  @exception Poco::Exception on database errors.
+     *
+     *  @since  0.10.0
+     */
+    static size_t update(const Database &db, std::mutex &db_mutex,
+                         const fs::path &path);
+
+    /*!
+     *  @brief  Returns the path of the snapshot of the database.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static fs::path default_path(const Database &db);
+
+private:
+    EntryTable _entries;
+    TrigramIndex _trigrams;
+    Dictionary _words;
+    Database::revision _revision;
+
+    /*!
+     *  @brief  Write the rows of all parts, in order.
+     *
+     *  If base is not nullptr, the first part are its entries and its
+     *  trigrams and words are reused. If archive_uris is not nullptr, it
+     *  replaces the archive URIs of the first part.
+     */
+    static void write(const fs::path &path,
+                      const vector<const EntryTable *> &parts,
+                      const Database::revision &revision,
+                      const Snapshot *base = nullptr,
+                      const vector<string_view> *archive_uris = nullptr);
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_SNAPSHOT_HPP
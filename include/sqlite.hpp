@@ -19,10 +19,14 @@
 
 #include <Poco/Data/Session.h>
 #include <chrono>
+#include <cstdint>
 #include <experimental/filesystem>
 #include <list>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace remwharead
@@ -35,6 +39,11 @@ using time_point = system_clock::time_point;
 using std::list;
 using Poco::Data::Session;
 
+class Bitmap;
+class Compressor;
+class EntryTable;
+class TagIndex;
+
 /*!
  *  @brief  Store and retrieve files from/to SQLite.
  *
@@ -79,12 +88,68 @@ public:
         string fulltext_oneline() const;
     };
 
+    /*!
+     *  @brief  An entry waiting to be archived.
+     *
+     *  @since  0.10.0
+     *
+     *  @headerfile sqlite.hpp remwharead/sqlite.hpp
+     */
+    struct archive_job
+    {
+        size_t rowid;
+        string uri;
+        //! Number of failed attempts so far.
+        unsigned attempts;
+    };
+
+    /*!
+     *  @brief  The state of the database, to find out if it has changed.
+     *
+     *  Entries are only appended, unless `modifications` changes. Setting an
+     *  archive URI only changes `archived`.
+     *
+     *  @since  0.10.0
+     *
+     *  @headerfile sqlite.hpp remwharead/sqlite.hpp
+     */
+    struct revision
+    {
+        //! Incremented whenever an entry is changed or removed.
+        std::uint64_t modifications{0};
+        //! The row id of the last entry.
+        std::uint64_t last_row{0};
+        //! Incremented whenever an archive URI is set.
+        std::uint64_t archived{0};
+
+        //! True if the entries are the same, except for archive URIs.
+        [[nodiscard]] bool same_entries(const revision &other) const
+        {
+            return modifications == other.modifications
+                && last_row == other.last_row;
+        }
+
+        friend bool operator==(const revision &a, const revision &b)
+        {
+            return a.same_entries(b) && a.archived == b.archived;
+        }
+
+        friend bool operator!=(const revision &a, const revision &b)
+        {
+            return !(a == b);
+        }
+    };
+
     /*!
      *  @brief  Connects to the database and creates it if necessary.
      *
      *  @since  0.6.0
      */
     Database();
+    ~Database();
+
+    Database(Database &&other) noexcept;
+    Database &operator=(Database &&other) noexcept;
 
     /*!
      *  @brief  Returns true if connected to the database.
@@ -96,18 +161,155 @@ public:
     /*!
      *  @brief  Store a Database::entry in the database.
      *
+     *  @param  data      The entry.
+     *  @param  archive   Add the entry to the archive queue. The archive URI
+     *                    is set by archive_done(). (Since 0.10.0)
+     *  @param  page_text The text of the whole page, if the full text of the
+     *                    entry is only the main content. It is only kept if
+     *                    remwharead was compiled with zstd, see page_text().
+     *                    (Since 0.10.0)
+     *
      *  @since  0.6.0
      */
-    void store(const entry &data) const;
+    void store(const entry &data, bool archive = false,
+               const string &page_text = {}) const;
 
     /*!
      *  @brief  Retrieve a list of Database::entry from the database.
      *
+     *  Entries are sorted from newest to oldest.
+     *
+     *  @param  start First point in time.
+     *  @param  end   Last point in time.
+     *  @param  limit Return at most this many entries. 0 means no limit.
+     *
      *  @since  0.6.0
      */
     [[nodiscard]]
     list<entry> retrieve(const time_point &start = time_point(),
-                         const time_point &end = system_clock::now()) const;
+                         const time_point &end = system_clock::now(),
+                         size_t limit = 0) const;
+
+    /*!
+     *  @brief  Retrieve an EntryTable from the database.
+     *
+     *  Like retrieve(), but without allocating memory for every entry.
+     *  Include entry_table.hpp to use it.
+     *
+     *  @param  start First point in time.
+     *  @param  end   Last point in time.
+     *  @param  limit    Return at most this many entries. 0 means no limit.
+     *  @param  resource The table allocates from this memory resource.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    EntryTable retrieve_table(const time_point &start = time_point(),
+                              const time_point &end = system_clock::now(),
+                              size_t limit = 0,
+                              std::pmr::memory_resource *resource
+                              = std::pmr::get_default_resource()) const;
+
+    /*!
+     *  @brief  Retrieve the entries with these row ids.
+     *
+     *  Only the text of matching entries is read from the database.
+     *
+     *  @param  rowids   Row ids, like returned by tag_index().
+     *  @param  start    First point in time.
+     *  @param  end      Last point in time.
+     *  @param  limit    Return at most this many entries. 0 means no limit.
+     *  @param  resource The table allocates from this memory resource.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    EntryTable retrieve_table(const Bitmap &rowids,
+                              const time_point &start = time_point(),
+                              const time_point &end = system_clock::now(),
+                              size_t limit = 0,
+                              std::pmr::memory_resource *resource
+                              = std::pmr::get_default_resource()) const;
+
+    /*!
+     *  @brief  Retrieve the entries in a range of row ids.
+     *
+     *  Entries are sorted by row id, which is the order they were added in.
+     *
+     *  @param  after    Row id before the first entry.
+     *  @param  last     Row id of the last entry.
+     *  @param  resource The table allocates from this memory resource.
+     *
+     *  @exception Poco::Exception on database errors.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    EntryTable retrieve_rows(std::uint64_t after, std::uint64_t last,
+                             std::pmr::memory_resource *resource
+                             = std::pmr::get_default_resource()) const;
+
+    /*!
+     *  @brief  Retrieve URI, date and archive URI of the entries up to a row
+     *          id.
+     *
+     *  Entries are sorted by row id. The other fields are empty. Used to
+     *  update the archive URIs of copies of the entries.
+     *
+     *  @param  last Row id of the last entry.
+     *
+     *  @exception Poco::Exception on database errors.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    list<entry> retrieve_archive_uris(std::uint64_t last) const;
+
+    /*!
+     *  @brief  Returns the current revision of the database.
+     *
+     *  @exception Poco::Exception on database errors.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    revision current_revision() const;
+
+    /*!
+     *  @brief  Returns the path of the database file.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    const fs::path &path() const;
+
+    /*!
+     *  @brief  Returns the row ids of the entries of every tag.
+     *
+     *  The index is stored in the database and updated by store() and
+     *  remove(). Include tag_index.hpp to use it.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    TagIndex tag_index() const;
+
+    /*!
+     *  @brief  Returns the text of the whole page that was stored with the
+     *          newest entry with this URI.
+     *
+     *  Pages are stored with the full text, so entries with the same full
+     *  text share the page of the first entry that had one.
+     *
+     *  @return The text, or an empty string if none was stored.
+     *
+     *  @exception std::runtime_error if compiled without zstd and there is
+     *             a text.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    string page_text(const string &uri) const;
 
     /*!
      *  @brief  Remove all entries with this URI from database.
@@ -118,6 +320,92 @@ public:
      */
     size_t remove(const string &uri);
 
+    /*!
+     *  @brief  Compress all full texts that are not compressed yet.
+     *
+     *  Creates a dictionary from the stored texts first, if there is none.
+     *  New texts are compressed by store(), if remwharead was compiled with
+     *  zstd.
+     *
+     *  @return Number of compressed texts.
+     *
+     *  @exception std::runtime_error if compiled without zstd.
+     *
+     *  @since  0.10.0
+     */
+    size_t compress_fulltexts();
+
+    /*!
+     *  @brief  Returns the jobs in the archive queue that are due.
+     *
+     *  The jobs are sorted by the time they are due.
+     *
+     *  @param  limit Return at most this many jobs. 0 means no limit.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<archive_job> archive_queue(size_t limit = 0) const;
+
+    /*!
+     *  @brief  Reserve jobs in the archive queue that are due.
+     *
+     *  The jobs are not due for other processes until the lease ends, so
+     *  that an entry is archived only once. archive_done(), archive_failed()
+     *  and release_archive_job() end the lease.
+     *
+     *  @param  limit Reserve at most this many jobs. 0 means no limit.
+     *  @param  lease How long the jobs are reserved.
+     *  @param  uri   Only reserve the jobs of this URI, if not empty.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    vector<archive_job> claim_archive_jobs(size_t limit,
+                                           std::chrono::seconds lease,
+                                           const string &uri = "") const;
+
+    /*!
+     *  @brief  Make a reserved job due again, without counting an attempt.
+     *
+     *  @since  0.10.0
+     */
+    void release_archive_job(const archive_job &job) const;
+
+    /*!
+     *  @brief  Returns when the next job in the archive queue is due.
+     *
+     *  @return Nothing if there are no jobs that will be retried.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]]
+    std::optional<time_point> next_archive_job() const;
+
+    /*!
+     *  @brief  Set the archive URIs and remove the jobs from the queue.
+     *
+     *  All entries are updated in one transaction.
+     *
+     *  @param  archived Pairs of row id and archive URI.
+     *
+     *  @since  0.10.0
+     */
+    void archive_done(const vector<std::pair<size_t, string>> &archived) const;
+
+    /*!
+     *  @brief  Record a failed attempt to archive an entry.
+     *
+     *  @param  job          The job.
+     *  @param  error        The error message.
+     *  @param  next_attempt When to try again. Nothing means never. The job
+     *                       stays in the queue, so the error is not lost.
+     *
+     *  @since  0.10.0
+     */
+    void archive_failed(const archive_job &job, const string &error,
+                        const std::optional<time_point> &next_attempt) const;
+
     /*!
      *  @brief  Returns tags as comma separated string.
      *
@@ -130,9 +418,38 @@ private:
     fs::path _dbpath;
     std::unique_ptr<Session> _session;
     bool _connected;
+    //! Nullptr if compiled without zstd.
+    std::unique_ptr<Compressor> _compressor;
 
     [[nodiscard]]
     static fs::path get_data_home();
+
+    //! Returns the row ids of the entries with this tag.
+    [[nodiscard]]
+    Bitmap load_tag(const string &tag) const;
+
+    //! Stores the row ids of the entries with this tag.
+    void save_tag(const string &tag, const Bitmap &rowids) const;
+
+    //! Build the tag index from the entries.
+    void rebuild_tag_index() const;
+
+    /*!
+     *  @brief  Returns the key of the row with this text in the content
+     *          table, and whether it is stored already.
+     *
+     *  The key is the hash of the text. If another text with the same hash
+     *  is stored, a number is appended. Texts are compared, so a collision
+     *  never gives an entry the text of another one.
+     */
+    [[nodiscard]]
+    std::pair<string, bool> content_key(const string &fulltext) const;
+
+    //! Move the full texts into the content table.
+    void migrate_content() const;
+
+    //! Give the entries an explicit row id, so that VACUUM keeps it.
+    void migrate_row_ids() const;
 };
 } // namespace remwharead
 
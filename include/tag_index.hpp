@@ -0,0 +1,164 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_TAG_INDEX_HPP
+#define REMWHAREAD_TAG_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+class EntryTable;
+
+/*!
+ *  @brief  A set of numbers, stored as bits.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile tag_index.hpp remwharead/tag_index.hpp
+ */
+class Bitmap
+{
+public:
+    void set(size_t bit);
+
+    //! Set the bits in [first, last).
+    void set(size_t first, size_t last);
+
+    void reset(size_t bit);
+    [[nodiscard]] bool test(size_t bit) const;
+
+    //! Number of set bits.
+    [[nodiscard]] size_t count() const;
+
+    //! True if no bit is set.
+    [[nodiscard]] bool none() const;
+
+    //! Intersection.
+    Bitmap &operator&=(const Bitmap &other);
+
+    //! Union.
+    Bitmap &operator|=(const Bitmap &other);
+
+    //! Difference.
+    Bitmap &operator-=(const Bitmap &other);
+
+    bool operator==(const Bitmap &other) const;
+
+    //! The set bits in ascending order.
+    [[nodiscard]] vector<size_t> indices() const;
+
+    /*!
+     *  @brief  Returns the set bits as deltas, encoded as variable length
+     *          integers.
+     *
+     *  Takes about 1 byte per bit if the bits are dense.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] string serialize() const;
+
+    /*!
+     *  @brief  Reverse of serialize().
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static Bitmap deserialize(string_view data);
+
+private:
+    vector<std::uint64_t> _words;
+
+    //! Remove words at the end that are 0.
+    void trim();
+};
+
+/*!
+ *  @brief  Maps tags to the set of entries they are attached to.
+ *
+ *  The entries are identified by numbers: Row indices for an index created
+ *  from an EntryTable, row ids for the index stored in the database.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile tag_index.hpp remwharead/tag_index.hpp
+ */
+class TagIndex
+{
+public:
+    using tagmap = std::map<string, Bitmap, std::less<>>;
+
+    TagIndex() = default;
+
+    /*!
+     *  @brief  Index the tags of a table by row index.
+     *
+     *  @since  0.10.0
+     */
+    explicit TagIndex(const EntryTable &entries);
+
+    //! Attach tag to entry.
+    void add(size_t id, string_view tag);
+
+    //! Attach tag to entries.
+    void add(const Bitmap &ids, string_view tag);
+
+    //! Detach tag from entry.
+    void remove(size_t id, string_view tag);
+
+    /*!
+     *  @brief  Returns the entries with this tag, nullptr if there are none.
+     *
+     *  Matches exactly, use match() for case-insensitive matching.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] const Bitmap *find(string_view tag) const;
+
+    /*!
+     *  @brief  Returns the entries with a tag that matches the `AND`-tags.
+     *
+     *  The tags in `tags_and` have to be lowercase. Tags in the index are
+     *  converted to lowercase once, when they are added.
+     *
+     *  @param  tags_and Tags that all have to match.
+     *  @param  is_re    Are the tags regular expressions?
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] Bitmap match(const vector<string> &tags_and,
+                               bool is_re) const;
+
+    //! All tags, sorted.
+    [[nodiscard]] const tagmap &tags() const;
+
+private:
+    tagmap _tags;
+    //! The tags, by their name converted with fold_case().
+    std::map<string, vector<string>, std::less<>> _folded;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_TAG_INDEX_HPP
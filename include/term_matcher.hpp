@@ -0,0 +1,150 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_TERM_MATCHER_HPP
+#define REMWHAREAD_TERM_MATCHER_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  Convert text to lowercase. Works with unicode.
+ *
+ *  Fast for ASCII. Bytes that are not UTF-8 are not changed.
+ *
+ *  @since  0.10.0
+ */
+[[nodiscard]] string fold_case(string_view text);
+
+/*!
+ *  @brief  Call f with every word of text.
+ *
+ *  Words are separated by ASCII characters that are not letters or digits.
+ *
+ *  @since  0.10.0
+ */
+template <typename F>
+void for_each_word(const string_view text, const F &f)
+{
+    const auto is_separator = [](const char c)
+    {
+        const auto uc = static_cast<unsigned char>(c);
+        return uc < 0x80 && !(uc >= 'a' && uc <= 'z')
+            && !(uc >= 'A' && uc <= 'Z') && !(uc >= '0' && uc <= '9');
+    };
+
+    size_t start = 0;
+    for (size_t pos = 0; pos <= text.size(); ++pos)
+    {
+        if (pos == text.size() || is_separator(text[pos]))
+        {
+            if (pos > start)
+            {
+                f(text.substr(start, pos - start));
+            }
+            start = pos + 1;
+        }
+    }
+}
+
+/*!
+ *  @brief  Finds several terms in one pass over a text, ignoring case.
+ *
+ *  Uses the Aho-Corasick algorithm. The text is converted to lowercase like
+ *  fold_case() while it is scanned, without making a copy.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile term_matcher.hpp remwharead/term_matcher.hpp
+ */
+class TermMatcher
+{
+public:
+    /*!
+     *  @brief  Compile the terms.
+     *
+     *  @param  terms Terms in lowercase. Empty terms are never found.
+     *
+     *  @since  0.10.0
+     */
+    explicit TermMatcher(const vector<string> &terms);
+
+    /*!
+     *  @brief  Count the occurrences of every term in text.
+     *
+     *  Occurrences of the same term don't overlap.
+     *
+     *  @param  counts    Set to the number of occurrences, by term.
+     *  @param  lowercase The text was converted with fold_case() already.
+     *
+     *  @since  0.10.0
+     */
+    void count(string_view text, vector<unsigned> &counts,
+               bool lowercase = false) const;
+
+    /*!
+     *  @brief  Find out which terms are in text.
+     *
+     *  Stops as soon as all terms are found.
+     *
+     *  @param  found     Set to true for every term in text, by term.
+     *  @param  lowercase The text was converted with fold_case() already.
+     *
+     *  @since  0.10.0
+     */
+    void find(string_view text, vector<bool> &found,
+              bool lowercase = false) const;
+
+    //! Number of terms.
+    [[nodiscard]] size_t size() const;
+
+private:
+    using state = std::uint32_t;
+
+    size_t _n_terms;
+    //! Length of every term.
+    vector<size_t> _lengths;
+    //! The next state for every state and byte, 256 per state.
+    vector<state> _next;
+    //! Start of the terms that end in every state in _outputs, plus the end.
+    vector<std::uint32_t> _output_offsets;
+    vector<std::uint32_t> _outputs;
+    //! ASCII bytes that can't start a term, even in lowercase.
+    std::array<bool, 256> _skip;
+
+    /*!
+     *  @brief  Call on_match(term, end) for every occurrence.
+     *
+     *  `end` is the position after the occurrence in the lowercase text.
+     *  Stops if on_match returns false.
+     *
+     *  @tparam lowercase The text is in lowercase already.
+     */
+    template <bool lowercase, typename Function>
+    void scan(string_view text, Function on_match) const;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_TERM_MATCHER_HPP
@@ -17,38 +17,75 @@
 #ifndef REMWHAREAD_TIME_HPP
 #define REMWHAREAD_TIME_HPP
 
+#include <array>
 #include <chrono>
 #include <string>
+#include <string_view>
 
 //! @file
 
 namespace remwharead
 {
 using std::string;
+using std::string_view;
 using std::chrono::system_clock;
 using time_point = system_clock::time_point;
 
+/*!
+ *  @brief  Buffer for timepoint_to_chars(), including the terminating null.
+ *
+ *  Large enough for every year std::tm can hold, up to 11 characters.
+ *
+ *  @since  0.10.0
+ */
+using timestring_buffer = std::array<char, 32>;
+
 /*!
  *  @brief  Convert ISO 8601 or SQLite time-string to time_point.
  *
  *  The SQLite format is *YY-MM-DD hh:mm:ss* instead of *YY-MM-DDThh:mm:ss*.
+ *  Both formats are accepted regardless of `sqlite`. Missing fields at the end
+ *  are set to 0, *YYYY-MM-DD* is midnight. The time is interpreted as local
+ *  time.
+ *
+ *  This function is thread-safe.
  *
  *  @param  strtime Time string in ISO 8601 or SQLite format.
  *  @param  sqlite  Is the string in SQLite format?
  */
 [[nodiscard]]
-time_point string_to_timepoint(const string &strtime, bool sqlite = false);
+time_point string_to_timepoint(string_view strtime, bool sqlite = false);
 
 /*!
  *  @brief  Convert time_point to ISO 8601 or SQLite time-string.
  *
  *  The SQLite format is *YY-MM-DD hh:mm:ss* instead of *YY-MM-DDThh:mm:ss*.
+ *  The time is converted to local time.
+ *
+ *  This function is thread-safe.
  *
  *  @param  time_point The std::chrono::system_clock::time_point.
  *  @param  sqlite     Is the string in SQLite format?
  */
 [[nodiscard]]
 string timepoint_to_string(const time_point &tp, bool sqlite = false);
+
+/*!
+ *  @brief  Convert time_point to ISO 8601 or SQLite time-string in buffer.
+ *
+ *  Like timepoint_to_string(), but does not allocate memory. The returned
+ *  view points into `buffer`.
+ *
+ *  This function is thread-safe.
+ *
+ *  @param  tp      The std::chrono::system_clock::time_point.
+ *  @param  buffer  The buffer to write into.
+ *  @param  sqlite  Is the string in SQLite format?
+ *
+ *  @since  0.10.0
+ */
+string_view timepoint_to_chars(const time_point &tp, timestring_buffer &buffer,
+                               bool sqlite = false);
 } // namespace remwharead
 
 #endif  // REMWHAREAD_TIME_HPP
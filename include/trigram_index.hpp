@@ -0,0 +1,134 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REMWHAREAD_TRIGRAM_INDEX_HPP
+#define REMWHAREAD_TRIGRAM_INDEX_HPP
+
+#include "entry_table.hpp"
+#include "tag_index.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace remwharead
+{
+using std::string;
+using std::string_view;
+using std::vector;
+
+/*!
+ *  @brief  Maps every sequence of 3 bytes to the rows that contain it.
+ *
+ *  The lowercase URI, title, description and full text are indexed. A
+ *  regular expression is translated into the trigrams that every match has
+ *  to contain, so that only the rows that have them need to be searched
+ *  with the regular expression. See
+ *  <https://swtch.com/~rsc/regexp/regexp4.html>.
+ *
+ *  @since  0.10.0
+ *
+ *  @headerfile trigram_index.hpp remwharead/trigram_index.hpp
+ */
+class TrigramIndex
+{
+public:
+    /*!
+     *  @brief  Builds an index row by row.
+     *
+     *  @since  0.10.0
+     */
+    class builder
+    {
+    public:
+        //! Add the lowercase texts of the next row.
+        void add(const vector<string_view> &texts);
+
+        //! Add the rows of an index. Has to be called before adding rows.
+        void add(const TrigramIndex &index);
+
+        //! Returns the index of all added rows.
+        [[nodiscard]] TrigramIndex finish();
+
+    private:
+        struct postings
+        {
+            std::uint32_t last{0};
+            //! Rows as deltas, like Bitmap::serialize().
+            string data;
+        };
+
+        std::unordered_map<std::uint32_t, postings> _postings;
+        vector<std::uint32_t> _row;
+        std::uint32_t _rows{0};
+    };
+
+    /*!
+     *  @brief  An empty index, that does not narrow searches.
+     *
+     *  @since  0.10.0
+     */
+    TrigramIndex() = default;
+
+    /*!
+     *  @brief  Index the rows of a table.
+     *
+     *  @since  0.10.0
+     */
+    explicit TrigramIndex(const EntryTable &entries);
+
+    /*!
+     *  @brief  Returns the candidates that can match the regular expression.
+     *
+     *  The regular expression has to be lowercase, like the terms of a
+     *  Query. If the regular expression has no literal text of at least 3
+     *  bytes that every match needs, or uses features that are not
+     *  understood, all candidates are returned.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] Bitmap narrow(const Bitmap &candidates,
+                                string_view regex) const;
+
+    //! Number of indexed rows.
+    [[nodiscard]] size_t size() const;
+
+    //! Number of distinct trigrams.
+    [[nodiscard]] size_t trigram_count() const;
+
+private:
+    friend class Snapshot;
+
+    size_t _rows{0};
+    size_t _n_trigrams{0};
+    //! The trigrams, sorted.
+    const std::uint32_t *_trigrams{nullptr};
+    //! The rows of trigram i are in
+    //! _postings[_offsets[i], _offsets[i + 1]).
+    const std::uint64_t *_offsets{nullptr};
+    const char *_postings{nullptr};
+    //! Keeps the memory the pointers point into.
+    std::shared_ptr<const void> _memory;
+
+    //! Returns the rows that contain trigram.
+    [[nodiscard]] Bitmap find(std::uint32_t trigram) const;
+};
+} // namespace remwharead
+
+#endif  // REMWHAREAD_TRIGRAM_INDEX_HPP
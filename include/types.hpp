@@ -38,7 +38,8 @@ enum class export_format
     json,
     rss,
     link,
-    rofi
+    rofi,
+    atom
 };
 } // namespace remwharead
 
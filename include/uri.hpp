@@ -19,8 +19,10 @@
 
 #include <curl/curl.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace remwharead
 {
@@ -43,6 +45,8 @@ struct html_extract
     string title;
     string description;
     string fulltext;
+    //! The text of the whole page, if fulltext is only the main content.
+    string page_text;
 
     explicit operator bool() const;
 };
@@ -81,6 +85,9 @@ public:
      *  Initializes TLS and sets proxy from the environment variable
      *  `http_proxy`, if possible.
      *
+     *  Since 0.10.0, constructing a URI is cheap, does not change the global
+     *  locale and can be done from several threads at once.
+     *
      *  @since  0.6.0
      */
     explicit URI(string uri);
@@ -94,9 +101,22 @@ public:
     /*!
      *  @brief  Download %URI and extract title, description and full text.
      *
+     *  Since 0.10.0, the text is extracted according to the type of the
+     *  document: HTML, plain text, XML like RSS or Atom feeds, or PDF if
+     *  remwharead was compiled with poppler. If the type is not in the
+     *  Content-Type header, it is guessed from the beginning of the document.
+     *  No text is extracted from other documents, like images. Texts are cut
+     *  after 4 MiB. Since 0.10.0, the download is stopped after 64 MiB, or as
+     *  soon as it is clear that the document has no text.
+     *
+     *  @param  main_content Only use the main content of HTML pages as full
+     *                       text, see extract_main_content(). The text of
+     *                       the whole page is in html_extract::page_text
+     *                       then. (Since 0.10.0)
+     *
      *  @since  0.6.0
      */
-    [[nodiscard]] html_extract get();
+    [[nodiscard]] html_extract get(bool main_content = false);
 
     /*!
      *  @brief  Save %URI in archive and return archive-URI.
@@ -105,11 +125,140 @@ public:
      */
     [[nodiscard]] archive_answer archive() const;
 
+    /*!
+     *  @brief  Save %URI in archive and return archive-URI.
+     *
+     *  @param  service The %URI is appended to this URL. The answer has to
+     *                  contain the archive-URI in the header `Location` or
+     *                  `Content-Location`.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] archive_answer archive(const string &service) const;
+
 protected:
+    /*!
+     *  @brief  The types of documents, by how their text is extracted.
+     *
+     *  @since  0.10.0
+     */
+    enum class document_type
+    {
+        html,
+        text,
+        //! RSS, Atom and other XML documents.
+        xml,
+        pdf,
+        //! Images, archives and everything else without text.
+        binary
+    };
+
+    //! Texts are cut after this many bytes.
+    static constexpr size_t max_text_size{4 * 1024 * 1024};
+    //! Downloads are stopped after this many bytes.
+    static constexpr size_t max_document_size{16 * max_text_size};
+
+    /*!
+     *  @brief  The state of a download, passed to write_document().
+     *
+     *  @since  0.10.0
+     */
+    struct download
+    {
+        URI *uri;
+        //! The curl easy handle, used to get the Content-Type.
+        void *curl;
+        //! The value of the Content-Type header.
+        string content_type;
+        //! The type of the document can not change anymore.
+        bool type_known{false};
+        //! The transfer was stopped by write_document().
+        bool stopped{false};
+    };
+
     string _uri;
     string _encoding;
     string _document;
 
+    /*!
+     *  @brief  Returns the type of #_document.
+     *
+     *  @param  content_type The value of the Content-Type header.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] document_type detect_type(std::string_view content_type)
+        const;
+
+    /*!
+     *  @brief  libcurl write callback, appends the data to #_document.
+     *
+     *  Stops the transfer if the document is larger than #max_document_size
+     *  or if it has no text, like images.
+     *
+     *  @param  state A download.
+     *
+     *  @since  0.10.0
+     */
+    static size_t write_document(char *data, size_t size, size_t nmemb,
+                                 void *state);
+
+    /*!
+     *  @brief  Extract title, description and full text from an HTML page.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] html_extract extract_html(bool main_content) const;
+
+    /*!
+     *  @brief  Extract the text of a text file. The first line is the title.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] html_extract extract_text() const;
+
+    /*!
+     *  @brief  Extract title, description and text from an XML document,
+     *          like a feed.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] html_extract extract_xml() const;
+
+    /*!
+     *  @brief  Extract title, subject and text from a PDF file.
+     *
+     *  Extracts nothing if remwharead was compiled without poppler.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] html_extract extract_pdf() const;
+
+    /*!
+     *  @brief  Returns the text of the first element with this name.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static string xml_element_text(std::string_view xml,
+                                                 std::string_view name);
+
+    /*!
+     *  @brief  Returns the text of an XML document.
+     *
+     *  CDATA sections and escaped HTML are converted to text too.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static string xml_to_text(std::string_view xml);
+
+    /*!
+     *  @brief  Cut text after at most n_bytes, without cutting UTF-8
+     *          characters.
+     *
+     *  @since  0.10.0
+     */
+    static void cut_bytes(string &text, size_t n_bytes);
+
     /*!
      *  @brief  Extract the title from an HTML page.
      *
@@ -142,6 +291,14 @@ protected:
     [[nodiscard]] static string remove_html_tags(const string &html,
                                                  const string &tag = "");
 
+    /*!
+     *  @brief  Remove carriage returns, spaces at the end of lines and empty
+     *          lines, in place.
+     *
+     *  @since  0.10.0
+     */
+    static void normalize_whitespace(string &text);
+
     /*!
      *  @brief  Convert HTML entities to UTF-8.
      *
@@ -171,18 +328,43 @@ protected:
     [[nodiscard]] static string cut_text(const string &text, uint16_t n_chars);
 
     /*!
-     *  @brief  Converts string to UTF-8.
+     *  @brief  Converts string from #_encoding to UTF-8.
+     *
+     *  If #_encoding is unknown, it is guessed like in detect_encoding().
      *
      *  @since  0.9.2
      */
-    [[nodiscard]] inline string to_utf8(const string &str);
+    [[nodiscard]] string to_utf8(string str);
 
     /*!
-     *  @brief  Try to detect the encoding of the document.
+     *  @brief  Detect the encoding of #_document and store it in #_encoding.
+     *
+     *  Uses the byte order mark, the Content-Type header and the `<meta>`
+     *  tags in the first 4 KiB of the document, in that order. Documents
+     *  without any of them are UTF-8 if they are valid UTF-8, else
+     *  windows-1252.
+     *
+     *  @param  content_type The value of the Content-Type header.
      *
      *  @since  0.9.2
      */
-    void detect_encoding();
+    void detect_encoding(std::string_view content_type);
+
+    /*!
+     *  @brief  Returns the value of the Content-Type header of the last
+     *          response in headers.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static std::string_view
+    content_type(std::string_view headers);
+
+    /*!
+     *  @brief  Returns true if text is valid UTF-8.
+     *
+     *  @since  0.10.0
+     */
+    [[nodiscard]] static bool is_utf8(std::string_view text);
 
     /*!
      *  @brief  Returns true if document is *HTML.
@@ -0,0 +1,695 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "remwharead_cli.hpp"
+#include "archive_queue.hpp"
+#include "sqlite.hpp"
+#include "types.hpp"
+#include <Poco/Environment.h>
+#include <curl/curl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+namespace remwharead_cli
+{
+using Poco::Environment;
+using std::cerr;
+using std::string_view;
+using std::uint32_t;
+using std::int64_t;
+
+namespace
+{
+/*
+ * Protocol: The client sends one request, consisting of a 32 bit length and
+ * the serialized fields. The daemon answers with frames of 1 byte type and a
+ * 32 bit length, followed by the data. The types are 'o' for stdout, 'e' for
+ * stderr and 'x' for the exit code, which is the last frame.
+ */
+
+//! Larger requests are refused.
+constexpr uint32_t max_request_size = 1024 * 1024;
+//! Output is sent in frames of at most this size.
+constexpr uint32_t max_frame_size = 64 * 1024;
+//! Clients that are served at the same time, the others have to wait.
+constexpr size_t max_clients = 16;
+
+//! The listening socket, closed by request_stop().
+std::atomic<int> listening_fd{-1};
+volatile std::sig_atomic_t stop_requested = 0;
+
+//! Closes the file descriptor when it goes out of scope.
+class socket_fd
+{
+public:
+    explicit socket_fd(int fd = -1)
+        : _fd{fd}
+    {}
+    socket_fd(const socket_fd &) = delete;
+    socket_fd &operator=(const socket_fd &) = delete;
+    ~socket_fd()
+    {
+        if (_fd != -1)
+        {
+            ::close(_fd);
+        }
+    }
+
+    [[nodiscard]] int get() const
+    {
+        return _fd;
+    }
+
+private:
+    int _fd;
+};
+
+void write_all(int fd, string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t written = ::send(fd, data.data(), data.size(),
+                                       MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+//! Returns false if the connection was closed before anything was read.
+bool read_all(int fd, char *data, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size)
+    {
+        const ssize_t got = ::recv(fd, data + pos, size - pos, 0);
+        if (got < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "recv");
+        }
+        if (got == 0)
+        {
+            if (pos == 0)
+            {
+                return false;
+            }
+            throw std::runtime_error("Connection closed unexpectedly.");
+        }
+        pos += static_cast<size_t>(got);
+    }
+
+    return true;
+}
+
+void put_uint32(string &out, const uint32_t number)
+{
+    out.append(reinterpret_cast<const char *>(&number), sizeof(number));
+}
+
+void put_int64(string &out, const int64_t number)
+{
+    out.append(reinterpret_cast<const char *>(&number), sizeof(number));
+}
+
+void put_string(string &out, const string_view str)
+{
+    put_uint32(out, static_cast<uint32_t>(str.size()));
+    out.append(str);
+}
+
+//! Reads the fields written by the put_* functions.
+class reader
+{
+public:
+    explicit reader(string_view data)
+        : _data{data}
+    {}
+
+    uint32_t get_uint32()
+    {
+        uint32_t number;
+        std::memcpy(&number, take(sizeof(number)).data(), sizeof(number));
+        return number;
+    }
+
+    int64_t get_int64()
+    {
+        int64_t number;
+        std::memcpy(&number, take(sizeof(number)).data(), sizeof(number));
+        return number;
+    }
+
+    string get_string()
+    {
+        const uint32_t size = get_uint32();
+        return string(take(size));
+    }
+
+private:
+    string_view _data;
+
+    string_view take(const size_t size)
+    {
+        if (size > _data.size())
+        {
+            throw std::runtime_error("Malformed request.");
+        }
+        const string_view part = _data.substr(0, size);
+        _data.remove_prefix(size);
+        return part;
+    }
+};
+
+string serialize(const request &req)
+{
+    string out;
+    put_string(out, req.uri);
+    put_uint32(out, static_cast<uint32_t>(req.tags.size()));
+    for (const string &tag : req.tags)
+    {
+        put_string(out, tag);
+    }
+    put_uint32(out, req.archive ? 1 : 0);
+    put_uint32(out, req.main_content ? 1 : 0);
+    put_string(out, req.delete_uri);
+    put_uint32(out, static_cast<uint32_t>(req.format));
+    put_string(out, req.file);
+    for (const time_point &tp : req.timespan)
+    {
+        put_int64(out, tp.time_since_epoch().count());
+    }
+    put_string(out, req.search_tags);
+    put_string(out, req.search_all);
+    put_uint32(out, req.regex ? 1 : 0);
+    put_uint32(out, req.fuzzy ? 1 : 0);
+    put_uint32(out, req.by_relevance ? 1 : 0);
+    put_int64(out, static_cast<int64_t>(req.limit));
+    put_uint32(out, req.if_changed ? 1 : 0);
+    put_uint32(out, req.compress ? 1 : 0);
+    put_uint32(out, req.build_snapshot ? 1 : 0);
+
+    return out;
+}
+
+request deserialize(const string_view data)
+{
+    reader in(data);
+    request req;
+    req.uri = in.get_string();
+    const uint32_t n_tags = in.get_uint32();
+    for (uint32_t i = 0; i < n_tags; ++i)
+    {
+        req.tags.push_back(in.get_string());
+    }
+    req.archive = in.get_uint32() != 0;
+    req.main_content = in.get_uint32() != 0;
+    req.delete_uri = in.get_string();
+    req.format = static_cast<export_format>(in.get_uint32());
+    req.file = in.get_string();
+    for (time_point &tp : req.timespan)
+    {
+        tp = time_point(time_point::duration(in.get_int64()));
+    }
+    req.search_tags = in.get_string();
+    req.search_all = in.get_string();
+    req.regex = in.get_uint32() != 0;
+    req.fuzzy = in.get_uint32() != 0;
+    req.by_relevance = in.get_uint32() != 0;
+    req.limit = static_cast<size_t>(in.get_int64());
+    req.if_changed = in.get_uint32() != 0;
+    req.compress = in.get_uint32() != 0;
+    req.build_snapshot = in.get_uint32() != 0;
+
+    return req;
+}
+
+void send_frame(int fd, const char type, const string_view data)
+{
+    string frame(1, type);
+    put_string(frame, data);
+    write_all(fd, frame);
+}
+
+//! Sends everything written to it as frames of one type.
+class frame_buffer : public std::streambuf
+{
+public:
+    frame_buffer(int fd, char type)
+        : _fd{fd}
+        , _type{type}
+    {
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (sync() != 0)
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        const auto size = static_cast<size_t>(pptr() - pbase());
+        if (size == 0)
+        {
+            return 0;
+        }
+        try
+        {
+            send_frame(_fd, _type, string_view(pbase(), size));
+        }
+        catch (const std::exception &)
+        {
+            return -1;
+        }
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+
+        return 0;
+    }
+
+private:
+    int _fd;
+    char _type;
+    std::array<char, max_frame_size> _buffer{};
+};
+
+//! Limits the number of clients that are served at the same time.
+class client_slots
+{
+public:
+    explicit client_slots(const size_t max)
+        : _free{max}
+        , _max{max}
+    {}
+
+    //! Wait until a slot is free and take it.
+    void acquire()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return _free > 0; });
+        --_free;
+    }
+
+    //! Give a slot back.
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_free;
+        // wait_all() can return as soon as the lock is released, and then
+        // the slots are destroyed. So notify while holding it.
+        _cv.notify_all();
+    }
+
+    //! Wait until all slots are free.
+    void wait_all()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this] { return _free == _max; });
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    size_t _free;
+    const size_t _max;
+};
+
+//! Signal handler. Makes accept() fail, so that the daemon can clean up.
+void request_stop(int /*signum*/)
+{
+    stop_requested = 1;
+    const int fd = listening_fd.load();
+    if (fd != -1)
+    {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+}
+
+//! Returns true if the other end of the socket is run by the same user.
+bool same_user(const int fd)
+{
+    ucred cred{};
+    socklen_t len = sizeof(cred);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    {
+        return false;
+    }
+
+    return cred.uid == ::getuid();
+}
+
+sockaddr_un make_address(const fs::path &path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    const string str = path.string();
+    if (str.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long: " + str);
+    }
+    str.copy(addr.sun_path, str.size());
+
+    return addr;
+}
+
+//! Returns -1 if no daemon is listening.
+int connect_to(const fs::path &path)
+{
+    const sockaddr_un addr = make_address(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr),
+                  sizeof(addr)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    // Anyone can create the socket if it is in /tmp.
+    if (!same_user(fd))
+    {
+        ::close(fd);
+        cerr << "Warning: Ignoring " << path
+             << ", it belongs to another user.\n";
+        return -1;
+    }
+
+    return fd;
+}
+
+void serve_client(const int client, Database &db, std::mutex &db_mutex,
+                  ArchiveQueue &archive_queue, ResultCache &cache)
+{
+    const socket_fd fd(client);
+    try
+    {
+        uint32_t size;
+        if (!read_all(fd.get(), reinterpret_cast<char *>(&size),
+                      sizeof(size)))
+        {
+            return;
+        }
+        if (size > max_request_size)
+        {
+            throw std::runtime_error("Request is too large.");
+        }
+        string data(size, '\0');
+        if (!read_all(fd.get(), data.data(), data.size()))
+        {
+            return;
+        }
+        const request req = deserialize(data);
+
+        frame_buffer buf_out(fd.get(), 'o');
+        frame_buffer buf_err(fd.get(), 'e');
+        std::ostream out(&buf_out);
+        std::ostream err(&buf_err);
+
+        int ret;
+        try
+        {
+            ret = process(req, db, db_mutex, archive_queue, &cache, out,
+                          err);
+        }
+        catch (const std::exception &e)
+        {
+            err << "Error: " << e.what() << '\n';
+            ret = 2;
+        }
+        out.flush();
+        err.flush();
+
+        string code;
+        put_uint32(code, static_cast<uint32_t>(ret));
+        send_frame(fd.get(), 'x', code);
+    }
+    catch (const std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << '\n';
+    }
+}
+} // namespace
+
+fs::path socket_path()
+{
+    if (Environment::has("XDG_RUNTIME_DIR"))
+    {
+        return Environment::get("XDG_RUNTIME_DIR")
+            / fs::path("remwharead.sock");
+    }
+
+    return fs::path("/tmp") / ("remwharead-" + std::to_string(::getuid())
+                               + ".sock");
+}
+
+int run_daemon()
+{
+    const fs::path path = socket_path();
+
+    const int running = connect_to(path);
+    if (running != -1)
+    {
+        ::close(running);
+        cerr << "Error: Daemon is already running on " << path << ".\n";
+        return 1;
+    }
+
+    // Initialize curl once for all requests. Later calls to
+    // curl_global_init() only increase a counter.
+    // NOLINTNEXTLINE(hicpp-signed-bitwise)
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    {
+        cerr << "Error: Could not initialize curl.\n";
+        return 2;
+    }
+
+    Database db;
+    if (!db)
+    {
+        cerr << "Error: Database could not be opened.\n";
+        return 2;
+    }
+    std::mutex db_mutex;
+    ArchiveQueue archive_queue(db, db_mutex);
+    archive_queue.start();
+    // Repeated searches are answered from here until the database changes.
+    ResultCache cache;
+
+    // Clients that disconnect early must not kill us.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const socket_fd server(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    try
+    {
+        if (server.get() == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+
+        // Remove the socket of a daemon that did not exit cleanly.
+        std::error_code ec;
+        fs::remove(path, ec);
+
+        // Create the socket without permissions for others, so that there is
+        // no moment in which they can connect.
+        const sockaddr_un addr = make_address(path);
+        const mode_t old_umask = ::umask(S_IRWXG | S_IRWXO);
+        const int bound = ::bind(server.get(),
+                                 reinterpret_cast<const sockaddr *>(&addr),
+                                 sizeof(addr));
+        const int bind_errno = errno;
+        ::umask(old_umask);
+        if (bound != 0)
+        {
+            throw std::system_error(bind_errno, std::generic_category(),
+                                    "bind");
+        }
+        if (::listen(server.get(), SOMAXCONN) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "listen");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << '\n';
+        archive_queue.stop();
+        curl_global_cleanup();
+        return 2;
+    }
+
+    // Stop accepting clients on SIGTERM and SIGINT, finish the running
+    // requests and remove the socket. No SA_RESTART, accept() has to return.
+    listening_fd = server.get();
+    struct sigaction action{};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGTERM, &action, nullptr);
+    ::sigaction(SIGINT, &action, nullptr);
+
+    client_slots slots(max_clients);
+    while (true)
+    {
+        slots.acquire();
+        const int client = ::accept4(server.get(), nullptr, nullptr,
+                                     SOCK_CLOEXEC);
+        if (client == -1)
+        {
+            slots.release();
+            if (stop_requested != 0)
+            {
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            cerr << "Error in " << __func__ << ": accept: "
+                 << std::strerror(errno) << '\n';
+            break;
+        }
+        if (!same_user(client))
+        {
+            ::close(client);
+            slots.release();
+            continue;
+        }
+        // Clients that send nothing must not keep their slot forever.
+        const timeval timeout{10, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                     sizeof(timeout));
+
+        std::thread([client, &db, &db_mutex, &archive_queue, &cache, &slots]
+                    {
+                        serve_client(client, db, db_mutex, archive_queue,
+                                     cache);
+                        slots.release();
+                    })
+            .detach();
+    }
+
+    listening_fd = -1;
+    fs::remove(path);
+    slots.wait_all();
+    archive_queue.stop();
+    curl_global_cleanup();
+
+    return stop_requested != 0 ? 0 : 2;
+}
+
+std::optional<int> run_client(const request &req)
+{
+    const socket_fd fd(connect_to(socket_path()));
+    if (fd.get() == -1)
+    {
+        return {};
+    }
+
+    try
+    {
+        const string data = serialize(req);
+        string message;
+        put_string(message, data);
+        write_all(fd.get(), message);
+
+        while (true)
+        {
+            char type;
+            if (!read_all(fd.get(), &type, 1))
+            {
+                throw std::runtime_error("Daemon closed the connection.");
+            }
+            uint32_t size;
+            read_all(fd.get(), reinterpret_cast<char *>(&size), sizeof(size));
+            if (size > max_frame_size)
+            {
+                throw std::runtime_error("Reply from daemon is too large.");
+            }
+            string payload(size, '\0');
+            read_all(fd.get(), payload.data(), payload.size());
+
+            switch (type)
+            {
+            case 'o':
+            {
+                std::cout << payload;
+                break;
+            }
+            case 'e':
+            {
+                cerr << payload;
+                break;
+            }
+            case 'x':
+            {
+                std::cout.flush();
+                return static_cast<int>(reader(payload).get_uint32());
+            }
+            default:
+            {
+                throw std::runtime_error("Unknown reply from daemon.");
+            }
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << '\n';
+        return 2;
+    }
+}
+} // namespace remwharead_cli
@@ -1,5 +1,5 @@
 /*  This file is part of remwharead.
- *  Copyright © 2019 tastytea <tastytea@tastytea.de>
+ *  Copyright © 2019, 2020 tastytea <tastytea@tastytea.de>
  *
  *  This program is free software: you can redistribute it and/or modify
  *  it under the terms of the GNU General Public License as published by
@@ -15,34 +15,19 @@
  */
 
 #include "remwharead_cli.hpp"
-#include "export/adoc.hpp"
-#include "export/bookmarks.hpp"
-#include "export/csv.hpp"
-#include "export/json.hpp"
-#include "export/link.hpp"
-#include "export/rofi.hpp"
-#include "export/rss.hpp"
-#include "export/simple.hpp"
-#include "search.hpp"
+#include "archive_queue.hpp"
 #include "sqlite.hpp"
 #include "types.hpp"
-#include "uri.hpp"
-#include <chrono>
-#include <fstream>
 #include <iostream>
-#include <list>
 #include <locale>
+#include <mutex>
 #include <string>
-#include <thread>
+#include <vector>
 
 using namespace remwharead;
 using namespace remwharead_cli;
 using std::cerr;
-using std::endl;
-using std::string;
-using std::chrono::system_clock;
-using std::ofstream;
-using std::list;
+using std::cout;
 
 int App::main(const std::vector<std::string> &args)
 {
@@ -59,199 +44,55 @@ int App::main(const std::vector<std::string> &args)
     }
     if (!args.empty())
     {
-        _uri = args[0];
+        _request.uri = args[0];
     }
-    if (_uri.empty() && _format == export_format::undefined)
+
+    if (_daemon)
     {
-        cerr << "Error: You have to specify either an URI or --export.\n";
-        return 1;
+        return run_daemon();
     }
 
-    Database db;
-    if (!db)
+    if (_request.uri.empty() && _request.format == export_format::undefined
+        && _request.delete_uri.empty() && !_request.compress
+        && !_request.build_snapshot)
     {
-        cerr << "Error: Database could not be opened.\n";
-        return 2;
+        cerr << "Error: You have to specify either an URI or --export.\n";
+        return 1;
     }
-
-    if (!_uri.empty())
+    if (_request.by_relevance && _request.search_all.empty())
     {
-        URI uri(_uri);
-
-        archive_answer archive_data;
-        std::thread thread_archive;
-        if (_archive)
-        {
-            // clang-format off
-            thread_archive = std::thread([&archive_data, &uri]
-                                         {
-                                             archive_data = uri.archive();
-                                         });
-            // clang-format on
-        }
-
-        html_extract page = uri.get();
-
-        if (_archive)
-        {
-            thread_archive.join();
-            if (!archive_data)
-            {
-                cerr << "Error archiving URL: " << archive_data.error << endl;
-            }
-        }
-
-        if (!page)
-        {
-            cerr << "Error: Could not fetch page.\n";
-            cerr << page.error << endl;
-            return 3;
-        }
-
-        db.store({_uri, archive_data.uri, system_clock::now(), _tags,
-                  page.title, page.description, page.fulltext});
+        cerr << "Error: Sorting by relevance needs --search-all.\n";
+        return 1;
+    }
+    if (!_request.file.empty())
+    {   // The daemon may have a different working directory.
+        _request.file = fs::absolute(_request.file).string();
     }
 
-    ofstream file;
-    if (!_file.empty())
+    if (auto ret = run_client(_request))
     {
-        file.open(_file);
-        if (!file.good())
-        {
-            cerr << "Error: Could not open file: " << _file << endl;
-            return 2;
-        }
+        return *ret;
     }
 
-    if (_format != export_format::undefined)
+    Database db;
+    if (!db)
     {
-        list<Database::entry> entries = db.retrieve(_timespan[0], _timespan[1]);
-
-        if (!_search_tags.empty())
-        {
-            Search search(entries);
-            entries = search.search_tags(_search_tags, _regex);
-        }
-        else if (!_search_all.empty())
-        {
-            Search search(entries);
-            entries = search.search_all_threaded(_search_all, _regex);
-        }
+        cerr << "Error: Database could not be opened.\n";
+        return 2;
+    }
 
-        switch (_format)
-        {
-        case export_format::csv:
-        {
-            if (file.is_open())
-            {
-                Export::CSV(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::CSV(entries).print();
-            }
-            break;
-        }
-        case export_format::asciidoc:
-        {
-            if (file.is_open())
-            {
-                Export::AsciiDoc(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::AsciiDoc(entries).print();
-            }
-            break;
-        }
-        case export_format::bookmarks:
-        {
-            if (file.is_open())
-            {
-                Export::Bookmarks(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::Bookmarks(entries).print();
-            }
-            break;
-        }
-        case export_format::simple:
-        {
-            if (file.is_open())
-            {
-                Export::Simple(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::Simple(entries).print();
-            }
-            break;
-        }
-        case export_format::json:
-        {
-            if (file.is_open())
-            {
-                Export::JSON(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::JSON(entries).print();
-            }
-            break;
-        }
-        case export_format::rss:
-        {
-            if (file.is_open())
-            {
-                Export::RSS(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::RSS(entries).print();
-            }
-            break;
-        }
-        case export_format::link:
-        {
-            if (file.is_open())
-            {
-                Export::Link(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::Link(entries).print();
-            }
-            break;
-        }
-        case export_format::rofi:
-        {
-            if (file.is_open())
-            {
-                Export::Rofi(entries, file).print();
-                file.close();
-            }
-            else
-            {
-                Export::Rofi(entries).print();
-            }
-            break;
-        }
-        default:
-        {
-            break;
-        }
-        }
+    std::mutex db_mutex;
+    ArchiveQueue archive_queue(db, db_mutex);
+    const int ret = process(_request, db, db_mutex, archive_queue, nullptr,
+                            cout, cerr);
+    if (ret == 0 && !_request.uri.empty() && _request.archive)
+    {   // Without daemon, archive after the output is complete. The rest of
+        // the queue is left to the daemon.
+        cout.flush();
+        archive_queue.run_once(_request.uri);
     }
 
-    return 0;
+    return ret;
 }
 
 POCO_APP_MAIN(App)
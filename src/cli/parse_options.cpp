@@ -20,8 +20,13 @@
 #include "version.hpp"
 #include <Poco/Util/HelpFormatter.h>
 #include <Poco/Util/Option.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <exception>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 using namespace remwharead_cli;
 using std::cout;
@@ -31,13 +36,53 @@ using Poco::Util::Option;
 using Poco::Util::OptionCallback;
 using Poco::Util::HelpFormatter;
 
+namespace
+{
+//! Dates are YYYY[-MM[-DD[Thh:mm[:ss]]]], like for string_to_timepoint().
+bool is_date(const string &date)
+{
+    constexpr std::array<size_t, 6> widths = {4, 2, 2, 2, 2, 2};
+    constexpr std::array<char, 6> separators = {'\0', '-', '-', 'T', ':', ':'};
+    constexpr std::array<int, 6> minimums = {0, 1, 1, 0, 0, 0};
+    constexpr std::array<int, 6> maximums = {9999, 12, 31, 23, 59, 60};
+
+    size_t pos = 0;
+    for (size_t i = 0; i < widths.size(); ++i)
+    {
+        if (i != 0)
+        {
+            if (pos == date.size())
+            {   // Every field but the hours can end the date.
+                return i != 4;
+            }
+            if (date[pos] != separators[i] && !(i == 3 && date[pos] == ' '))
+            {
+                return false;
+            }
+            ++pos;
+        }
+        const string digits = date.substr(pos, widths[i]);
+        if (digits.size() != widths[i]
+            || digits.find_first_not_of("0123456789") != string::npos)
+        {
+            return false;
+        }
+        const int value = std::stoi(digits);
+        if (value < minimums[i] || value > maximums[i])
+        {
+            return false;
+        }
+        pos += widths[i];
+    }
+
+    return pos == date.size();
+}
+} // namespace
+
 App::App()
     : _exit_requested{false}
     , _argument_error{false}
-    , _format{export_format::undefined}
-    , _timespan{{time_point(), system_clock::now()}}
-    , _archive{true}
-    , _regex{false}
+    , _daemon{false}
 {}
 
 void App::defineOptions(OptionSet& options)
@@ -66,6 +111,20 @@ void App::defineOptions(OptionSet& options)
                "Only export entries between YYYY-MM-DD,YYYY-MM-DD.")
         .argument("times")
         .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("since", "",
+               "Only export entries since YYYY-MM-DD[Thh:mm:ss].")
+        .argument("time")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("limit", "l", "Only export the newest N entries.")
+        .argument("N")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("if-changed", "",
+               "Only write file if the database changed since the last "
+               "time.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
     options.addOption(
         Option("search-tags", "s",
                "Search in tags. Format: tag1 AND tag2 OR tag3.")
@@ -79,14 +138,39 @@ void App::defineOptions(OptionSet& options)
     options.addOption(
         Option("regex", "r", "Use regular expression for search.")
         .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("fuzzy", "", "Also find tags and words with typos.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("sort", "",
+               "Sort search results by date (default) or relevance.")
+        .argument("order")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
     options.addOption(
         Option("no-archive", "N", "Do not archive URI.")
         .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("main-content", "",
+               "Only store the main content of the page, without navigation, "
+               "comments and the like.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
     options.addOption(
         Option("delete", "d",
                "Remove all entries with this URI from database.")
         .argument("URI")
         .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("compress", "",
+               "Compress the full texts in the database. Needs zstd.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("build-snapshot", "",
+               "Write a snapshot of the database for faster exports.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
+    options.addOption(
+        Option("daemon", "", "Run in the background and answer requests of "
+               "other remwharead processes.")
+        .callback(OptionCallback<App>(this, &App::handle_options)));
 }
 
 void App::handle_options(const std::string &name, const std::string &value)
@@ -121,7 +205,7 @@ void App::handle_options(const std::string &name, const std::string &value)
             }
             if (!buffer.empty())
             {
-                _tags.push_back(buffer);
+                _request.tags.push_back(buffer);
             }
             pos_start = pos_end + 1;
         }
@@ -130,35 +214,39 @@ void App::handle_options(const std::string &name, const std::string &value)
     {
         if (value == "csv")
         {
-            _format = export_format::csv;
+            _request.format = export_format::csv;
         }
         else if (value == "asciidoc" || value == "adoc")
         {
-            _format = export_format::asciidoc;
+            _request.format = export_format::asciidoc;
         }
         else if (value == "bookmarks")
         {
-            _format = export_format::bookmarks;
+            _request.format = export_format::bookmarks;
         }
         else if (value == "simple")
         {
-            _format = export_format::simple;
+            _request.format = export_format::simple;
         }
         else if (value == "json")
         {
-            _format = export_format::json;
+            _request.format = export_format::json;
         }
         else if (value == "rss")
         {
-            _format = export_format::rss;
+            _request.format = export_format::rss;
+        }
+        else if (value == "atom")
+        {
+            _request.format = export_format::atom;
         }
         else if (value == "link")
         {
-            _format = export_format::link;
+            _request.format = export_format::link;
         }
         else if (value == "rofi")
         {
-            _format = export_format::rofi;
+            _request.format = export_format::rofi;
         }
         else
         {
@@ -168,14 +256,15 @@ void App::handle_options(const std::string &name, const std::string &value)
     }
     else if (name == "file")
     {
-        _file = value;
+        _request.file = value;
     }
     else if (name == "time-span")
     {
         size_t pos = value.find(',');
-        if (pos != std::string::npos)
+        if (pos != std::string::npos && is_date(value.substr(0, pos))
+            && is_date(value.substr(pos + 1)))
         {
-            _timespan =
+            _request.timespan =
                 {
                     string_to_timepoint(value.substr(0, pos)),
                     string_to_timepoint(value.substr(pos + 1))
@@ -188,27 +277,101 @@ void App::handle_options(const std::string &name, const std::string &value)
             _argument_error = true;
         }
     }
+    else if (name == "since")
+    {
+        if (is_date(value))
+        {
+            _request.timespan[0] = string_to_timepoint(value);
+        }
+        else
+        {
+            cerr << "Error: Start must be in format: "
+                "YYYY-MM-DD[Thh:mm:ss].\n";
+            _argument_error = true;
+        }
+    }
+    else if (name == "limit")
+    {
+        try
+        {
+            // std::stoul() accepts signs and leading whitespace.
+            if (value.empty() || std::isdigit(
+                    static_cast<unsigned char>(value.front())) == 0)
+            {
+                throw std::invalid_argument("Not a number.");
+            }
+            size_t pos = 0;
+            _request.limit = std::stoul(value, &pos);
+            if (pos != value.size())
+            {
+                throw std::invalid_argument("Not a number.");
+            }
+        }
+        catch (const std::exception &)
+        {
+            cerr << "Error: Limit must be a positive number.\n";
+            _argument_error = true;
+        }
+    }
+    else if (name == "if-changed")
+    {
+        _request.if_changed = true;
+    }
     else if (name == "search-tags")
     {
-        _search_tags = value;
+        _request.search_tags = value;
     }
     else if (name == "search-all")
     {
-        _search_all = value;
+        _request.search_all = value;
     }
     else if (name == "no-archive")
     {
-        _archive = false;
+        _request.archive = false;
+    }
+    else if (name == "main-content")
+    {
+        _request.main_content = true;
     }
     else if (name == "regex")
     {
-        _regex = true;
+        _request.regex = true;
+    }
+    else if (name == "fuzzy")
+    {
+        _request.fuzzy = true;
+    }
+    else if (name == "sort")
+    {
+        if (value == "relevance")
+        {
+            _request.by_relevance = true;
+        }
+        else if (value == "date")
+        {
+            _request.by_relevance = false;
+        }
+        else
+        {
+            cerr << "Error: Order must be date or relevance.\n";
+            _argument_error = true;
+        }
     }
     else if (name == "delete")
     {
-        Database db;
-        cout << "Deleted " << db.remove(value) << " entries.\n";
-        _exit_requested = true;
+        _request.delete_uri = value;
+    }
+    else if (name == "compress")
+    {
+        _request.compress = true;
+    }
+    else if (name == "build-snapshot")
+    {
+        _request.build_snapshot = true;
+    }
+    else if (name == "daemon")
+    {
+        _daemon = true;
     }
 }
 
@@ -222,9 +385,13 @@ void App::print_help(const string &option)
         helpFormatter = std::make_unique<HelpFormatter>(options());
         helpFormatter->setCommand(commandName());
         helpFormatter->setUsage("[-t tags] [-N] URI\n"
-                                "-e format [-f file] [-T start,end] "
-                                "[[-s|-S] expression] [-r]\n"
-                                "-d URI");
+                                "-e format [-f file [--if-changed]] "
+                                "[-T start,end | --since start] [-l N] "
+                                "[[-s|-S] expression [--sort order]] [-r]\n"
+                                "-d URI\n"
+                                "--compress\n"
+                                "--build-snapshot\n"
+                                "--daemon");
     }
     else
     {
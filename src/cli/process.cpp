@@ -0,0 +1,491 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2019, 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "remwharead_cli.hpp"
+#include "archive_queue.hpp"
+#include "entry_table.hpp"
+#include "export/adoc.hpp"
+#include "export/atom.hpp"
+#include "export/bookmarks.hpp"
+#include "export/csv.hpp"
+#include "export/json.hpp"
+#include "export/link.hpp"
+#include "export/rofi.hpp"
+#include "export/rss.hpp"
+#include "export/simple.hpp"
+#include "query.hpp"
+#include "result_cache.hpp"
+#include "search.hpp"
+#include "snapshot.hpp"
+#include "sqlite.hpp"
+#include "tag_index.hpp"
+#include "types.hpp"
+#include "uri.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace remwharead_cli
+{
+using std::endl;
+using std::ofstream;
+using std::ostream;
+using lock_guard = std::lock_guard<std::mutex>;
+
+namespace
+{
+int add(const request &req, Database &db, std::mutex &db_mutex,
+        ArchiveQueue &archive_queue, ostream &err)
+{
+    URI uri(req.uri);
+    html_extract page = uri.get(req.main_content);
+    if (!page)
+    {
+        err << "Error: Could not fetch page.\n";
+        err << page.error << endl;
+        return 3;
+    }
+
+    {
+        const lock_guard lock(db_mutex);
+        db.store({req.uri, "", system_clock::now(), req.tags,
+                  page.title, page.description, page.fulltext},
+                 req.archive, page.page_text);
+    }
+    if (req.archive)
+    {
+        archive_queue.notify();
+    }
+
+    return 0;
+}
+
+//! Returns the snapshot, if the user made one, updated if necessary.
+std::optional<Snapshot> open_snapshot(const Database &db, std::mutex &db_mutex,
+                                      ostream &err)
+{
+    const fs::path path = Snapshot::default_path(db);
+    if (!fs::exists(path))
+    {
+        return {};
+    }
+
+    try
+    {
+        Snapshot::update(db, db_mutex, path);
+        return Snapshot(path);
+    }
+    catch (const std::exception &e)
+    {   // Fall back to the database.
+        err << "Error: Could not use snapshot: " << e.what() << endl;
+    }
+
+    return {};
+}
+
+//! The indices of ranked search results, in order.
+vector<size_t> indices_of(const vector<Search::ranked> &results)
+{
+    vector<size_t> indices;
+    indices.reserve(results.size());
+    for (const Search::ranked &result : results)
+    {
+        indices.push_back(result.index);
+    }
+
+    return indices;
+}
+
+//! Select the entries of the request from a snapshot, in export order.
+EntryTable select_entries(const request &req, const Snapshot &snapshot,
+                          std::pmr::memory_resource *arena)
+{
+    const EntryTable &all = snapshot.entries();
+    vector<size_t> order;
+    vector<bool> matches(all.size(), true);
+    if (req.by_relevance)
+    {   // The time span is applied afterwards, so there is no limit here.
+        order = indices_of(Search(all, snapshot.trigrams(), snapshot.words())
+                           .rank_all(req.search_all, req.regex, 0,
+                                     req.fuzzy));
+    }
+    else
+    {
+        order = all.order_by_datetime();
+        if (!req.search_tags.empty() || !req.search_all.empty())
+        {
+            const Search search(all, snapshot.trigrams(), snapshot.words());
+            const vector<size_t> found = req.search_tags.empty()
+                ? search.find_all_threaded(req.search_all, req.regex,
+                                           req.fuzzy)
+                : search.find_tags(req.search_tags, req.regex, req.fuzzy);
+            matches.assign(all.size(), false);
+            for (const size_t index : found)
+            {
+                matches[index] = true;
+            }
+        }
+    }
+
+    vector<size_t> selected;
+    for (const size_t index : order)
+    {
+        const time_point datetime = all[index].datetime();
+        if (matches[index] && datetime >= req.timespan[0]
+            && datetime <= req.timespan[1])
+        {
+            selected.push_back(index);
+            if (selected.size() == req.limit)
+            {
+                break;
+            }
+        }
+    }
+
+    return all.select(selected, arena);
+}
+
+//! Select the entries of the request, in export order.
+EntryTable find_entries(const request &req, const bool only_tags,
+                        Database &db, std::mutex &db_mutex,
+                        std::pmr::memory_resource *arena, ostream &err)
+{
+    EntryTable entries(arena);
+
+    if (const auto snapshot = open_snapshot(db, db_mutex, err))
+    {
+        entries = select_entries(req, *snapshot, arena);
+    }
+    else if (!req.search_tags.empty() && only_tags)
+    {   // Only read the matching entries from the database.
+        const lock_guard lock(db_mutex);
+        const Bitmap rowids = Search::find_tags(db.tag_index(),
+                                                req.search_tags, req.regex,
+                                                req.fuzzy);
+        entries = db.retrieve_table(rowids, req.timespan[0], req.timespan[1],
+                                    req.limit, arena);
+    }
+    else if (!req.search_tags.empty() || !req.search_all.empty())
+    {
+        // If we search, the limit can only be applied to the results.
+        std::unique_lock<std::mutex> lock(db_mutex);
+        const Search search(db.retrieve_table(req.timespan[0],
+                                              req.timespan[1], 0, arena));
+        lock.unlock();
+        if (req.by_relevance)
+        {   // Only the best results are copied.
+            entries = search.entries().select(indices_of(
+                search.rank_all(req.search_all, req.regex, req.limit,
+                                req.fuzzy)));
+        }
+        else if (!req.search_tags.empty())
+        {
+            entries = search.entries().select(
+                search.find_tags(req.search_tags, req.regex, req.fuzzy));
+        }
+        else
+        {
+            entries = search.entries().select(
+                search.find_all_threaded(req.search_all, req.regex,
+                                         req.fuzzy));
+        }
+    }
+    else
+    {
+        const lock_guard lock(db_mutex);
+        entries = db.retrieve_table(req.timespan[0], req.timespan[1],
+                                    req.limit, arena);
+    }
+
+    if (req.limit != 0 && entries.size() > req.limit && !req.by_relevance)
+    {
+        vector<size_t> newest = entries.order_by_datetime();
+        newest.resize(req.limit);
+        entries = entries.select(newest);
+    }
+
+    return entries;
+}
+
+/*!
+ *  @brief  Copy entries, with the archive URIs of the archived entries.
+ *
+ *  Entries are matched by URI and date.
+ */
+EntryTable with_archive_uris(const EntryTable &entries,
+                             const list<Database::entry> &archived,
+                             std::pmr::memory_resource *arena)
+{
+    std::map<std::pair<string_view, time_point>, string_view> archive_uris;
+    for (const Database::entry &entry : archived)
+    {
+        archive_uris[{entry.uri, entry.datetime}] = entry.archive_uri;
+    }
+
+    EntryTable copy(arena);
+    copy.reserve(entries.size());
+    for (const EntryTable::row row : entries)
+    {
+        const auto it = archive_uris.find({row.uri(), row.datetime()});
+        copy.push_back(row.uri(),
+                       it != archive_uris.end() ? it->second
+                                                : row.archive_uri(),
+                       row.datetime(), row.tags_to_string(), row.title(),
+                       row.description(), row.fulltext());
+    }
+
+    return copy;
+}
+
+//! Describes everything that changes the exported entries.
+string export_key(const request &req, const Query &query)
+{
+    return string(req.search_tags.empty() ? "all" : "tags")
+        + (req.by_relevance ? ",relevance," : ",date,")
+        + (req.fuzzy ? "fuzzy," : "")
+        + std::to_string(req.limit) + ','
+        + std::to_string(req.timespan[0].time_since_epoch().count())
+        + ',' + std::to_string(req.timespan[1].time_since_epoch().count())
+        + ',' + query.normalized();
+}
+
+/*!
+ *  @brief  Where --if-changed remembers what was exported to file.
+ *
+ *  Contains the revision of the database, the format and export_key().
+ */
+fs::path stamp_path(const string &file)
+{
+    return file + ".revision";
+}
+
+//! Returns the content of the stamp file, or an empty string.
+string read_stamp(const fs::path &path)
+{
+    std::ifstream file(path);
+    return string(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+}
+
+int export_entries(const request &req, Database &db, std::mutex &db_mutex,
+                   ResultCache *cache, ostream &out, ostream &err)
+{
+    const string &expression = req.search_tags.empty() ? req.search_all
+                                                       : req.search_tags;
+    std::optional<Query> query;
+    try
+    {
+        query.emplace(expression, req.regex);
+    }
+    catch (const std::invalid_argument &e)
+    {
+        err << "Error: " << e.what() << endl;
+        return 1;
+    }
+    const bool only_tags = query->only_tags();
+    const string key = export_key(req, *query);
+    Database::revision revision;
+    {
+        const lock_guard lock(db_mutex);
+        revision = db.current_revision();
+    }
+
+    // Skip the export if the database did not change since the file was
+    // written. Deleted and updated entries change the revision too.
+    const bool stamped = req.if_changed && !req.file.empty();
+    const string stamp = std::to_string(revision.modifications) + ','
+        + std::to_string(revision.last_row) + ','
+        + std::to_string(revision.archived) + ','
+        + std::to_string(static_cast<int>(req.format)) + ',' + key;
+    if (stamped && fs::exists(req.file)
+        && read_stamp(stamp_path(req.file)) == stamp)
+    {
+        return 0;
+    }
+
+    ofstream file;
+    if (!req.file.empty())
+    {
+        file.open(req.file);
+        if (!file.good())
+        {
+            err << "Error: Could not open file: " << req.file << endl;
+            return 2;
+        }
+    }
+
+    // All tables of this export live in the arena and are freed at once.
+    std::pmr::monotonic_buffer_resource arena;
+    EntryTable entries(&arena);
+    std::shared_ptr<const EntryTable> cached;
+    if (cache != nullptr)
+    {
+        bool archive_outdated = false;
+        cached = cache->find(key, revision, &archive_outdated);
+        if (cached && archive_outdated)
+        {   // Only archive URIs were set, the same entries are found.
+            list<Database::entry> archived;
+            {
+                const lock_guard lock(db_mutex);
+                archived = db.retrieve_archive_uris(revision.last_row);
+            }
+            entries = with_archive_uris(*cached, archived, &arena);
+            cached = cache->insert(key, revision, entries);
+        }
+        else if (!cached)
+        {
+            entries = find_entries(req, only_tags, db, db_mutex, &arena, err);
+            cached = cache->insert(key, revision, entries);
+        }
+    }
+    else
+    {
+        entries = find_entries(req, only_tags, db, db_mutex, &arena, err);
+    }
+    const EntryTable &result = cached ? *cached : entries;
+
+    ostream &target = file.is_open() ? file : out;
+    switch (req.format)
+    {
+    case export_format::csv:
+    {
+        Export::CSV(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::asciidoc:
+    {
+        Export::AsciiDoc(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::bookmarks:
+    {
+        Export::Bookmarks(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::simple:
+    {
+        Export::Simple(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::json:
+    {
+        Export::JSON(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::rss:
+    {
+        Export::RSS(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::atom:
+    {
+        Export::Atom(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::link:
+    {
+        Export::Link(result, target, req.by_relevance).print();
+        break;
+    }
+    case export_format::rofi:
+    {
+        Export::Rofi(result, target, req.by_relevance).print();
+        break;
+    }
+    default:
+    {
+        break;
+    }
+    }
+    target.flush();
+
+    if (stamped)
+    {
+        ofstream stamp_file(stamp_path(req.file));
+        stamp_file << stamp;
+    }
+
+    return 0;
+}
+} // namespace
+
+int process(const request &req, Database &db, std::mutex &db_mutex,
+            ArchiveQueue &archive_queue, ResultCache *cache, ostream &out,
+            ostream &err)
+{
+    if (!req.delete_uri.empty())
+    {
+        const lock_guard lock(db_mutex);
+        out << "Deleted " << db.remove(req.delete_uri) << " entries.\n";
+        return 0;
+    }
+
+    if (req.compress)
+    {
+        try
+        {
+            const lock_guard lock(db_mutex);
+            out << "Compressed " << db.compress_fulltexts() << " texts.\n";
+        }
+        catch (const std::runtime_error &e)
+        {
+            err << "Error: " << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (req.build_snapshot)
+    {
+        try
+        {
+            const size_t read = Snapshot::update(db, db_mutex,
+                                                 Snapshot::default_path(db));
+            out << "Read " << read << " entries into the snapshot.\n";
+        }
+        catch (const std::exception &e)
+        {
+            err << "Error: " << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!req.uri.empty())
+    {
+        const int ret = add(req, db, db_mutex, archive_queue, err);
+        if (ret != 0)
+        {
+            return ret;
+        }
+    }
+
+    if (req.format != export_format::undefined)
+    {
+        return export_entries(req, db, db_mutex, cache, out, err);
+    }
+
+    return 0;
+}
+} // namespace remwharead_cli
@@ -17,11 +17,17 @@
 #ifndef REMWHAREAD_PARSE_OPTIONS_HPP
 #define REMWHAREAD_PARSE_OPTIONS_HPP
 
+#include "archive_queue.hpp"
+#include "result_cache.hpp"
+#include "sqlite.hpp"
 #include "types.hpp"
 #include <Poco/Util/Application.h>
 #include <Poco/Util/OptionSet.h>
 #include <array>
 #include <chrono>
+#include <mutex>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -35,6 +41,37 @@ using std::chrono::system_clock;
 using time_point = system_clock::time_point;
 using Poco::Util::OptionSet;
 
+/*!
+ *  @brief  What the user wants to do, parsed from the command line.
+ *
+ *  Sent to the daemon in client mode.
+ */
+struct request
+{
+    string uri;
+    vector<string> tags;
+    bool archive{true};
+    //! Only store the main content of the page.
+    bool main_content{false};
+    string delete_uri;
+    export_format format{export_format::undefined};
+    string file;
+    //! The end is open by default, so that the same request has the same
+    //! time span later.
+    array<time_point, 2> timespan{{time_point(), time_point::max()}};
+    string search_tags;
+    string search_all;
+    bool regex{false};
+    //! Also find tags and words with typos.
+    bool fuzzy{false};
+    //! Sort the results of search_all by relevance.
+    bool by_relevance{false};
+    size_t limit{0};
+    bool if_changed{false};
+    bool compress{false};
+    bool build_snapshot{false};
+};
+
 class App : public Poco::Util::Application
 {
 public:
@@ -50,16 +87,41 @@ protected:
 private:
     bool _exit_requested;
     bool _argument_error;
-    string _uri;
-    vector<string> _tags;
-    export_format _format;
-    string _file;
-    array<time_point, 2> _timespan;
-    string _search_tags;
-    string _search_all;
-    bool _archive;
-    bool _regex;
+    bool _daemon;
+    request _request;
 };
+
+/*!
+ *  @brief  Delete, add and export like requested.
+ *
+ *  db is only accessed while db_mutex is locked. Added URIs are put into
+ *  the archive queue. If cache is not nullptr, exports are taken from it if
+ *  possible.
+ *
+ *  @return The exit code.
+ */
+int process(const request &req, Database &db, std::mutex &db_mutex,
+            ArchiveQueue &archive_queue, ResultCache *cache,
+            std::ostream &out, std::ostream &err);
+
+//! Path of the socket the daemon listens on.
+[[nodiscard]] fs::path socket_path();
+
+/*!
+ *  @brief  Listen on socket_path() and process the requests of clients.
+ *
+ *  @return The exit code.
+ */
+int run_daemon();
+
+/*!
+ *  @brief  Let the daemon process the request, if it is running.
+ *
+ *  Output is written to stdout and stderr.
+ *
+ *  @return The exit code, or nothing if no daemon is running.
+ */
+[[nodiscard]] std::optional<int> run_client(const request &req);
 } // namespace remwharead_cli
 
 #endif  // REMWHAREAD_PARSE_OPTIONS_HPP
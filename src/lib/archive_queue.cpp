@@ -0,0 +1,214 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archive_queue.hpp"
+#include "uri.hpp"
+#include <Poco/Environment.h>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace remwharead
+{
+using std::cerr;
+using std::endl;
+using std::vector;
+using Poco::Environment;
+using steady_clock = std::chrono::steady_clock;
+
+ArchiveQueue::ArchiveQueue(const Database &db, std::mutex &db_mutex)
+    : ArchiveQueue(db, db_mutex, settings())
+{}
+
+ArchiveQueue::ArchiveQueue(const Database &db, std::mutex &db_mutex,
+                           settings config)
+    : _db{db}
+    , _db_mutex{db_mutex}
+    , _config{std::move(config)}
+    , _stop{false}
+    , _notified{false}
+{}
+
+ArchiveQueue::~ArchiveQueue()
+{
+    stop();
+}
+
+void ArchiveQueue::start()
+{
+    if (_thread.joinable())
+    {
+        return;
+    }
+
+    _stop = false;
+    _thread = std::thread(&ArchiveQueue::run, this);
+}
+
+void ArchiveQueue::stop()
+{
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void ArchiveQueue::notify()
+{
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        _notified = true;
+    }
+    _cv.notify_all();
+}
+
+size_t ArchiveQueue::run_once(const string &uri)
+{
+    size_t processed = 0;
+    vector<std::pair<size_t, string>> archived;
+
+    while (true)
+    {
+        vector<Database::archive_job> jobs;
+        {
+            const std::lock_guard<std::mutex> lock(_db_mutex);
+            jobs = _db.claim_archive_jobs(1, _config.lease, uri);
+        }
+        if (jobs.empty())
+        {
+            break;
+        }
+        const Database::archive_job &job = jobs.front();
+
+        if (!wait_for_slot())
+        {
+            const std::lock_guard<std::mutex> lock(_db_mutex);
+            _db.release_archive_job(job);
+            break;
+        }
+
+        const archive_answer answer = URI(job.uri).archive(_config.service);
+        _last_request = steady_clock::now();
+        ++processed;
+
+        if (answer)
+        {
+            archived.emplace_back(job.rowid, answer.uri);
+            if (archived.size() >= _config.batch_size)
+            {
+                const std::lock_guard<std::mutex> lock(_db_mutex);
+                _db.archive_done(archived);
+                archived.clear();
+            }
+            continue;
+        }
+
+        std::optional<time_point> next_attempt;
+        if (const auto wait = backoff(job.attempts + 1, _config))
+        {
+            next_attempt = system_clock::now() + *wait;
+        }
+        const std::lock_guard<std::mutex> lock(_db_mutex);
+        _db.archive_failed(job, answer.error, next_attempt);
+    }
+
+    if (!archived.empty())
+    {
+        const std::lock_guard<std::mutex> lock(_db_mutex);
+        _db.archive_done(archived);
+    }
+
+    return processed;
+}
+
+std::optional<std::chrono::seconds>
+ArchiveQueue::backoff(const unsigned attempts, const settings &config)
+{
+    if (attempts >= config.max_attempts)
+    {
+        return {};
+    }
+
+    std::chrono::seconds wait = config.backoff;
+    for (unsigned i = 1; i < attempts && wait < config.max_backoff; ++i)
+    {
+        wait *= 2;
+    }
+
+    return std::min(wait, config.max_backoff);
+}
+
+string ArchiveQueue::default_service()
+{
+    return Environment::get("REMWHAREAD_ARCHIVE_SERVICE",
+                            "https://web.archive.org/save/");
+}
+
+bool ArchiveQueue::wait_for_slot()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    const auto next = _last_request + _config.interval;
+
+    return !_cv.wait_until(lock, next, [this] { return _stop; });
+}
+
+void ArchiveQueue::run()
+{
+    while (true)
+    {
+        try
+        {
+            run_once();
+        }
+        catch (const std::exception &e)
+        {
+            cerr << "Error in " << __func__ << ": " << e.what() << endl;
+        }
+
+        std::optional<time_point> next;
+        {
+            const std::lock_guard<std::mutex> lock(_db_mutex);
+            next = _db.next_archive_job();
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        const auto woken = [this] { return _stop || _notified; };
+        if (next)
+        {
+            // Convert to the steady clock, so that clock changes don't matter.
+            const auto wait = *next - system_clock::now();
+            _cv.wait_until(lock, steady_clock::now() + wait, woken);
+        }
+        else
+        {
+            _cv.wait(lock, woken);
+        }
+        if (_stop)
+        {
+            return;
+        }
+        _notified = false;
+    }
+}
+} // namespace remwharead
@@ -0,0 +1,215 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compression.hpp"
+#include <stdexcept>
+#include <utility>
+
+#ifdef REMWHAREAD_WITH_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace remwharead
+{
+#ifdef REMWHAREAD_WITH_ZSTD
+namespace
+{
+// Good ratio, still fast enough to not be noticeable when saving a page.
+constexpr int level = 9;
+
+void check(const size_t code)
+{
+    if (ZSTD_isError(code) != 0)
+    {
+        throw std::runtime_error(ZSTD_getErrorName(code));
+    }
+}
+} // namespace
+
+struct Compressor::contexts
+{
+    ZSTD_CCtx *cctx{ZSTD_createCCtx()};
+    ZSTD_DCtx *dctx{ZSTD_createDCtx()};
+    ZSTD_CDict *cdict{nullptr};
+    ZSTD_DDict *ddict{nullptr};
+
+    ~contexts()
+    {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+Compressor::Compressor(string dictionary)
+    : _dictionary{std::move(dictionary)}
+    , _contexts{std::make_unique<contexts>()}
+{
+    if (_contexts->cctx == nullptr || _contexts->dctx == nullptr)
+    {
+        throw std::runtime_error("Could not initialize zstd.");
+    }
+    if (!_dictionary.empty())
+    {
+        _contexts->cdict = ZSTD_createCDict(_dictionary.data(),
+                                            _dictionary.size(), level);
+        _contexts->ddict = ZSTD_createDDict(_dictionary.data(),
+                                            _dictionary.size());
+        if (_contexts->cdict == nullptr || _contexts->ddict == nullptr)
+        {
+            throw std::runtime_error("Could not load zstd dictionary.");
+        }
+    }
+}
+
+Compressor::~Compressor() = default;
+
+bool Compressor::available()
+{
+    return true;
+}
+
+string Compressor::compress(const string_view text) const
+{
+    string data(ZSTD_compressBound(text.size()), '\0');
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    size_t size;
+    if (_contexts->cdict != nullptr)
+    {
+        size = ZSTD_compress_usingCDict(_contexts->cctx, data.data(),
+                                        data.size(), text.data(), text.size(),
+                                        _contexts->cdict);
+    }
+    else
+    {
+        size = ZSTD_compressCCtx(_contexts->cctx, data.data(), data.size(),
+                                 text.data(), text.size(), level);
+    }
+    check(size);
+    data.resize(size);
+
+    return data;
+}
+
+string_view Compressor::decompress(const string_view data,
+                                   string &buffer) const
+{
+    const unsigned long long size = ZSTD_getFrameContentSize(data.data(),
+                                                             data.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        throw std::runtime_error("Compressed text is damaged.");
+    }
+    const unsigned dict_id = ZSTD_getDictID_fromFrame(data.data(),
+                                                      data.size());
+    if (dict_id != 0 && _contexts->ddict == nullptr)
+    {
+        throw std::runtime_error("Dictionary for compressed text is missing.");
+    }
+    buffer.resize(size);
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    size_t written;
+    if (dict_id != 0)
+    {
+        written = ZSTD_decompress_usingDDict(_contexts->dctx, buffer.data(),
+                                             buffer.size(), data.data(),
+                                             data.size(), _contexts->ddict);
+    }
+    else
+    {
+        written = ZSTD_decompressDCtx(_contexts->dctx, buffer.data(),
+                                      buffer.size(), data.data(), data.size());
+    }
+    check(written);
+
+    return string_view(buffer.data(), written);
+}
+
+string Compressor::train(const vector<string> &samples, const size_t max_size)
+{
+    string concatenated;
+    vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const string &sample : samples)
+    {
+        concatenated += sample;
+        sizes.push_back(sample.size());
+    }
+
+    string dictionary(max_size, '\0');
+    const size_t size = ZDICT_trainFromBuffer(
+        dictionary.data(), dictionary.size(), concatenated.data(),
+        sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size) != 0)
+    {   // Usually not enough samples.
+        return {};
+    }
+    dictionary.resize(size);
+
+    return dictionary;
+}
+
+#else  // REMWHAREAD_WITH_ZSTD
+
+namespace
+{
+[[noreturn]] void unavailable()
+{
+    throw std::runtime_error("remwharead was compiled without zstd.");
+}
+} // namespace
+
+struct Compressor::contexts
+{};
+
+Compressor::Compressor(string dictionary)
+    : _dictionary{std::move(dictionary)}
+{
+    unavailable();
+}
+
+Compressor::~Compressor() = default;
+
+bool Compressor::available()
+{
+    return false;
+}
+
+string Compressor::compress(const string_view) const
+{
+    unavailable();
+}
+
+string_view Compressor::decompress(const string_view, string &) const
+{
+    unavailable();
+}
+
+string Compressor::train(const vector<string> &, const size_t)
+{
+    unavailable();
+}
+#endif // REMWHAREAD_WITH_ZSTD
+
+const string &Compressor::dictionary() const
+{
+    return _dictionary;
+}
+} // namespace remwharead
@@ -0,0 +1,220 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dictionary.hpp"
+#include "term_matcher.hpp"
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+#include <utility>
+
+namespace remwharead
+{
+using std::uint64_t;
+
+namespace
+{
+//! The memory of a dictionary that was built, not mapped.
+struct storage
+{
+    vector<uint64_t> offsets;
+    string text;
+};
+
+//! Length of the common start of a and b.
+size_t common_prefix(const string_view a, const string_view b)
+{
+    const size_t len = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < len && a[i] == b[i])
+    {
+        ++i;
+    }
+
+    return i;
+}
+} // namespace
+
+Dictionary::Dictionary(vector<string> words)
+{
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    auto memory = std::make_shared<storage>();
+    memory->offsets.reserve(words.size() + 1);
+    memory->offsets.push_back(0);
+    for (const string &word : words)
+    {
+        memory->text += word;
+        memory->offsets.push_back(memory->text.size());
+    }
+
+    _size = words.size();
+    _offsets = memory->offsets.data();
+    _text = memory->text.data();
+    _memory = std::move(memory);
+}
+
+Dictionary::Dictionary(const EntryTable &entries)
+{
+    std::unordered_set<string> words;
+    const auto add = [&words](const string_view text)
+    {
+        for_each_word(text, [&words](const string_view word)
+        {
+            words.emplace(word);
+        });
+    };
+
+    for (const EntryTable::row row : entries)
+    {
+        add(fold_case(row.uri()));
+        for (const string_view tag : row.tags())
+        {
+            add(fold_case(tag));
+        }
+        if (entries.has_folded())
+        {
+            add(row.folded_title());
+            add(row.folded_description());
+            add(row.folded_fulltext());
+        }
+        else
+        {
+            add(fold_case(row.title()));
+            add(fold_case(row.description()));
+            add(fold_case(row.fulltext()));
+        }
+    }
+
+    *this = Dictionary(vector<string>(words.begin(), words.end()));
+}
+
+vector<string> Dictionary::find(const string_view word,
+                                const size_t max_distance) const
+{
+    // rows[k][j] is the distance between the first k bytes of the current
+    // dictionary word and the first j bytes of word.
+    vector<vector<size_t>> rows(1, vector<size_t>(word.size() + 1));
+    std::iota(rows[0].begin(), rows[0].end(), 0);
+    string_view previous;
+    // The rows up to here are valid for previous.
+    size_t valid = 0;
+
+    vector<std::pair<size_t, string_view>> found;
+    size_t i = 0;
+    while (i < _size)
+    {
+        const string_view current = (*this)[i];
+        valid = std::min(valid, common_prefix(previous, current));
+        previous = current;
+
+        bool skip = false;
+        for (size_t k = valid + 1; k <= current.size(); ++k)
+        {
+            if (rows.size() <= k)
+            {
+                rows.emplace_back(word.size() + 1);
+            }
+            const vector<size_t> &above = rows[k - 1];
+            vector<size_t> &row = rows[k];
+            row[0] = k;
+            size_t lowest = row[0];
+            for (size_t j = 1; j <= word.size(); ++j)
+            {
+                const size_t replace = above[j - 1]
+                    + (current[k - 1] == word[j - 1] ? 0 : 1);
+                row[j] = std::min({above[j] + 1, row[j - 1] + 1, replace});
+                lowest = std::min(lowest, row[j]);
+            }
+            valid = k;
+
+            if (lowest > max_distance)
+            {   // No word that starts like this is close enough.
+                const string_view prefix = current.substr(0, k);
+                size_t first = i + 1;
+                size_t last = _size;
+                while (first < last)
+                {
+                    const size_t middle = first + (last - first) / 2;
+                    if ((*this)[middle].compare(0, k, prefix) == 0)
+                    {
+                        first = middle + 1;
+                    }
+                    else
+                    {
+                        last = middle;
+                    }
+                }
+                i = first;
+                skip = true;
+                break;
+            }
+        }
+        if (skip)
+        {
+            continue;
+        }
+
+        const size_t distance = rows[current.size()][word.size()];
+        if (distance <= max_distance)
+        {
+            found.emplace_back(distance, current);
+        }
+        ++i;
+    }
+
+    std::sort(found.begin(), found.end());
+    vector<string> words;
+    words.reserve(found.size());
+    for (const auto &match : found)
+    {
+        words.emplace_back(match.second);
+    }
+
+    return words;
+}
+
+size_t Dictionary::size() const
+{
+    return _size;
+}
+
+string_view Dictionary::operator[](const size_t index) const
+{
+    return {_text + _offsets[index], _offsets[index + 1] - _offsets[index]};
+}
+
+size_t edit_distance(const string_view a, const string_view b)
+{
+    vector<size_t> row(b.size() + 1);
+    std::iota(row.begin(), row.end(), 0);
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j)
+        {
+            const size_t above = row[j];
+            row[j] = std::min({above + 1, row[j - 1] + 1,
+                               diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+
+    return row[b.size()];
+}
+} // namespace remwharead
@@ -0,0 +1,374 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "entry_table.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace remwharead
+{
+EntryTable::EntryTable(std::pmr::memory_resource *resource)
+    : _columns{{std::pmr::string(resource), std::pmr::string(resource),
+                std::pmr::string(resource), std::pmr::string(resource),
+                std::pmr::string(resource)}}
+    , _offsets{{std::pmr::vector<size_t>(1, 0, resource),
+                std::pmr::vector<size_t>(1, 0, resource),
+                std::pmr::vector<size_t>(1, 0, resource),
+                std::pmr::vector<size_t>(1, 0, resource),
+                std::pmr::vector<size_t>(1, 0, resource)}}
+    , _datetimes(resource)
+    , _tags(resource)
+    , _tag_offsets(1, 0, resource)
+    , _tag_names(resource)
+    , _tag_ids(resource)
+{}
+
+EntryTable::EntryTable(const list<Database::entry> &entries,
+                       std::pmr::memory_resource *resource)
+    : EntryTable(resource)
+{
+    size_t bytes = 0;
+    for (const Database::entry &entry : entries)
+    {
+        bytes += entry.fulltext.size();
+    }
+    reserve(entries.size(), bytes);
+
+    for (const Database::entry &entry : entries)
+    {
+        push_back(entry);
+    }
+}
+
+EntryTable::EntryTable(const EntryTable &other)
+    : EntryTable(other.resource())
+{
+    *this = other;
+}
+
+EntryTable &EntryTable::operator=(const EntryTable &other)
+{
+    // Assigning keeps the memory resource of the left side.
+    if (this != &other)
+    {
+        _columns = other._columns;
+        _offsets = other._offsets;
+        _datetimes = other._datetimes;
+        _tags = other._tags;
+        _tag_offsets = other._tag_offsets;
+        _tag_names = other._tag_names;
+        _tag_ids = other._tag_ids;
+        _mapped = other._mapped;
+    }
+
+    return *this;
+}
+
+EntryTable &EntryTable::operator=(EntryTable &&other)
+{
+    // The members are moved if the memory resources are equal, and copied
+    // otherwise.
+    if (this != &other)
+    {
+        _columns = std::move(other._columns);
+        _offsets = std::move(other._offsets);
+        _datetimes = std::move(other._datetimes);
+        _tags = std::move(other._tags);
+        _tag_offsets = std::move(other._tag_offsets);
+        _tag_names = std::move(other._tag_names);
+        _tag_ids = std::move(other._tag_ids);
+        _mapped = std::move(other._mapped);
+    }
+
+    return *this;
+}
+
+void EntryTable::push_back(const Database::entry &entry)
+{
+    add(field::uri, entry.uri);
+    add(field::archive_uri, entry.archive_uri);
+    add(field::title, entry.title);
+    add(field::description, entry.description);
+    add(field::fulltext, entry.fulltext);
+    _datetimes.push_back(entry.datetime);
+    for (const string &tag : entry.tags)
+    {
+        _tags.push_back(intern_tag(tag));
+    }
+    _tag_offsets.push_back(_tags.size());
+}
+
+void EntryTable::push_back(const string_view uri, const string_view archive_uri,
+                           const time_point &datetime, const string_view tags,
+                           const string_view title,
+                           const string_view description,
+                           const string_view fulltext)
+{
+    add(field::uri, uri);
+    add(field::archive_uri, archive_uri);
+    add(field::title, title);
+    add(field::description, description);
+    add(field::fulltext, fulltext);
+    _datetimes.push_back(datetime);
+
+    size_t pos = 0;
+    while (pos != string_view::npos)
+    {
+        const size_t newpos = tags.find(',', pos);
+        const string_view tag = tags.substr(pos, newpos - pos);
+        if (!tag.empty())
+        {
+            _tags.push_back(intern_tag(tag));
+        }
+        pos = newpos;
+        if (pos != string_view::npos)
+        {
+            ++pos;
+        }
+    }
+    _tag_offsets.push_back(_tags.size());
+}
+
+void EntryTable::push_back(const row &other)
+{
+    add(field::uri, other.uri());
+    add(field::archive_uri, other.archive_uri());
+    add(field::title, other.title());
+    add(field::description, other.description());
+    add(field::fulltext, other.fulltext());
+    _datetimes.push_back(other.datetime());
+    for (const string_view tag : other.tags())
+    {
+        _tags.push_back(intern_tag(tag));
+    }
+    _tag_offsets.push_back(_tags.size());
+}
+
+void EntryTable::reserve(const size_t rows, const size_t bytes)
+{
+    for (std::pmr::vector<size_t> &offsets : _offsets)
+    {
+        offsets.reserve(rows + 1);
+    }
+    _columns[field::fulltext].reserve(bytes);
+    _datetimes.reserve(rows);
+    _tag_offsets.reserve(rows + 1);
+}
+
+optional<EntryTable::tag_id> EntryTable::find_tag(const string_view name) const
+{
+    if (_mapped)
+    {
+        const tag_id *first = _mapped->tags_by_name;
+        const tag_id *last = first + _mapped->n_tags;
+        const tag_id *it = std::lower_bound(first, last, name,
+                                            [this](const tag_id id,
+                                                   const string_view n)
+                                            {
+                                                return tag_name(id) < n;
+                                            });
+        if (it != last && tag_name(*it) == name)
+        {
+            return *it;
+        }
+
+        return {};
+    }
+
+    std::array<std::byte, 256> buffer;
+    std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+    const auto it = _tag_ids.find(std::pmr::string(name, &resource));
+    if (it != _tag_ids.end())
+    {
+        return it->second;
+    }
+
+    return {};
+}
+
+EntryTable EntryTable::select(const vector<size_t> &indices,
+                              std::pmr::memory_resource *resource) const
+{
+    EntryTable table(resource != nullptr ? resource : this->resource());
+    size_t bytes = 0;
+    for (const size_t index : indices)
+    {
+        bytes += (*this)[index].fulltext().size();
+    }
+    table.reserve(indices.size(), bytes);
+
+    // Keep the ids of the tags.
+    if (_mapped)
+    {
+        for (size_t id = 0; id < tag_count(); ++id)
+        {
+            table.intern_tag(tag_name(static_cast<tag_id>(id)));
+        }
+    }
+    else
+    {
+        table._tag_names = _tag_names;
+        table._tag_ids = _tag_ids;
+    }
+
+    for (const size_t index : indices)
+    {
+        table.push_back((*this)[index]);
+    }
+
+    return table;
+}
+
+vector<size_t> EntryTable::order_by_datetime(const bool unique) const
+{
+    vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](const size_t a, const size_t b)
+                     {
+                         return get_datetime(a) > get_datetime(b);
+                     });
+
+    if (unique)
+    {
+        const auto last = std::unique(order.begin(), order.end(),
+                                      [this](const size_t a, const size_t b)
+                                      {
+                                          return get_datetime(a)
+                                              == get_datetime(b);
+                                      });
+        order.erase(last, order.end());
+    }
+
+    return order;
+}
+
+list<Database::entry> EntryTable::to_list() const
+{
+    list<Database::entry> entries;
+    for (const row entry : *this)
+    {
+        entries.push_back(entry.to_entry());
+    }
+
+    return entries;
+}
+
+time_point EntryTable::get_datetime(const size_t index) const
+{
+    if (_mapped)
+    {
+        return time_point(std::chrono::duration_cast<time_point::duration>(
+            std::chrono::nanoseconds(_mapped->datetimes[index])));
+    }
+
+    return _datetimes[index];
+}
+
+EntryTable::tag_list EntryTable::get_tags(const size_t index) const
+{
+    if (_mapped)
+    {
+        const tag_id *data = _mapped->tags;
+        return {this, data + _mapped->tag_offsets[index],
+                data + _mapped->tag_offsets[index + 1]};
+    }
+
+    const tag_id *data = _tags.data();
+    return {this, data + _tag_offsets[index], data + _tag_offsets[index + 1]};
+}
+
+void EntryTable::add(const field f, const string_view text)
+{
+    if (_mapped)
+    {
+        throw std::logic_error("The table is read-only.");
+    }
+    _columns[f].append(text);
+    _offsets[f].push_back(_columns[f].size());
+}
+
+EntryTable::tag_id EntryTable::intern_tag(const string_view name)
+{
+    const optional<tag_id> found = find_tag(name);
+    if (found)
+    {
+        return *found;
+    }
+
+    const auto id = static_cast<tag_id>(_tag_names.size());
+    _tag_names.emplace_back(name);
+    _tag_ids.emplace(std::pmr::string(name, resource()), id);
+
+    return id;
+}
+
+string EntryTable::row::tags_to_string() const
+{
+    string strtags;
+    for (const string_view tag : tags())
+    {
+        if (!strtags.empty())
+        {
+            strtags += ',';
+        }
+        strtags += tag;
+    }
+
+    return strtags;
+}
+
+string EntryTable::row::fulltext_oneline() const
+{
+    string oneline;
+    const string_view text = fulltext();
+    oneline.reserve(text.size());
+
+    size_t pos = 0;
+    size_t newpos = 0;
+    while ((newpos = text.find('\n', pos)) != string_view::npos)
+    {
+        oneline.append(text, pos, newpos - pos);
+        oneline += "\\n";
+        pos = newpos + 1;
+    }
+    oneline.append(text, pos, string_view::npos);
+
+    return oneline;
+}
+
+Database::entry EntryTable::row::to_entry() const
+{
+    Database::entry entry;
+    entry.uri = uri();
+    entry.archive_uri = archive_uri();
+    entry.datetime = datetime();
+    for (const string_view tag : tags())
+    {
+        entry.tags.emplace_back(tag);
+    }
+    entry.title = title();
+    entry.description = description();
+    entry.fulltext = fulltext();
+
+    return entry;
+}
+} // namespace remwharead
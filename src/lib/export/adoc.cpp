@@ -27,9 +27,12 @@
 namespace remwharead
 {
 using std::string;
+using std::string_view;
+using std::vector;
 using std::cerr;
 using std::endl;
-using tagpair = std::pair<string,list<Database::entry>>;
+//! Number of entries and tag.
+using tagpair = std::pair<size_t, const TagIndex::tagmap::value_type *>;
 
 void Export::AsciiDoc::print() const
 {
@@ -43,9 +46,8 @@ void Export::AsciiDoc::print() const
              << ":TOCLevels: 2\n"
              << ":!webfonts:\n\n";
 
-        tagmap alltags;
         string day;
-        for (const Database::entry &entry : _entries)
+        for (const EntryTable::row entry : _entries)
         {
             const string newday = get_day(entry);
 
@@ -55,11 +57,11 @@ void Export::AsciiDoc::print() const
                 _out << "== " << day << endl << endl;
             }
 
-            _out << "[[dt_" << timepoint_to_string(entry.datetime)
-                 << "]]\n" << "* link:" << replace_in_uri(entry.uri);
-            if (!entry.title.empty())
+            _out << "[[dt_" << timepoint_to_string(entry.datetime())
+                 << "]]\n" << "* link:" << replace_in_uri(string(entry.uri()));
+            if (!entry.title().empty())
             {
-                _out << '[' << replace_in_title(entry.title) << ']';
+                _out << '[' << replace_in_title(string(entry.title())) << ']';
             }
             else
             {
@@ -68,15 +70,16 @@ void Export::AsciiDoc::print() const
             _out << " +" << endl;
 
             _out << '_' << get_time(entry).substr(0, 5) << '_';
-            if (!entry.archive_uri.empty())
+            if (!entry.archive_uri().empty())
             {
-                _out << " (link:" << replace_in_uri(entry.archive_uri)
+                _out << " (link:" << replace_in_uri(string(entry.archive_uri()))
                      << "[archived version])";
             }
 
             bool separator = false;
-            for (const string &tag : entry.tags)
+            for (const string_view tag_view : entry.tags())
             {
+                const string tag{tag_view};
                 if (tag.empty())
                 {
                     continue;
@@ -86,33 +89,24 @@ void Export::AsciiDoc::print() const
                     _out << "\n| ";
                     separator = true;
                 }
-
-                auto globaltag = alltags.find(tag);
-                if (globaltag != alltags.end())
-                {
-                    globaltag->second.push_back(entry);
-                }
                 else
                 {
-                    alltags.insert({ tag, { entry } });
+                    _out << ", ";
                 }
 
                 _out << "xref:t_" << replace_in_tag(tag)
                      << "[" << tag << ']';
-                if (tag != *(entry.tags.rbegin()))
-                {
-                    _out << ", ";
-                }
             }
 
-            if (!entry.description.empty())
+            if (!entry.description().empty())
             {
-                _out << " +\n+" << entry.description << '+';
+                _out << " +\n+" << entry.description() << '+';
             }
             _out << endl << endl;
         }
 
-        if (!alltags.empty())
+        const TagIndex alltags(_entries);
+        if (!alltags.tags().empty())
         {
             print_tags(alltags);
         }
@@ -177,28 +171,34 @@ string Export::AsciiDoc::replace_in_uri(const string &text)
     return out;
 }
 
-void Export::AsciiDoc::print_tags(const tagmap &tags) const
+void Export::AsciiDoc::print_tags(const TagIndex &tags) const
 {
     _out << "== Tags\n\n";
-    vector<tagpair> sortedtags(tags.size());
-    std::move(tags.begin(), tags.end(), sortedtags.begin());
+    vector<tagpair> sortedtags;
+    sortedtags.reserve(tags.tags().size());
+    for (const auto &tag : tags.tags())
+    {
+        sortedtags.emplace_back(tag.second.count(), &tag);
+    }
 
     const auto compare_tags =
         [](const tagpair &a, tagpair &b)
         {
-            if (a.second.size() != b.second.size())
+            if (a.first != b.first)
             {  // Sort by number of occurrences if they are different.
-                return a.second.size() > b.second.size();
+                return a.first > b.first;
             }
 
             // Sort by tag names otherwise.
+            const string &name_a = a.second->first;
+            const string &name_b = b.second->first;
             const std::locale loc;
             const auto &coll = std::use_facet<std::collate<char>>(loc);
             return (coll.compare(
                         // NOLINTNEXTLINE – pointer arithmetic
-                        &a.first[0], &a.first[0] + a.first.size(),
+                        &name_a[0], &name_a[0] + name_a.size(),
                         // NOLINTNEXTLINE – pointer arithmetic
-                        &b.first[0], &b.first[0] + b.first.size()) == -1);
+                        &name_b[0], &name_b[0] + name_b.size()) == -1);
         };
     std::sort(sortedtags.begin(), sortedtags.end(), compare_tags);
 
@@ -207,7 +207,7 @@ void Export::AsciiDoc::print_tags(const tagmap &tags) const
     {
         // If we have more than 20 tags, group all tags that occur only 1
         // time under the section “Less used tags”.
-        if (sortedtags.size() > 20 && tag.second.size() == 1)
+        if (sortedtags.size() > 20 && tag.first == 1)
         {
             if (!othertags)
             {
@@ -217,16 +217,17 @@ void Export::AsciiDoc::print_tags(const tagmap &tags) const
             _out << "=";
         }
 
-        _out << "=== [[t_" << replace_in_tag(tag.first) << "]]"
-             << tag.first << '\n';
-        for (const Database::entry &entry : tag.second)
+        const string &name = tag.second->first;
+        _out << "=== [[t_" << replace_in_tag(name) << "]]" << name << '\n';
+        for (const size_t index : tag.second->second.indices())
         {
-            const string datetime = timepoint_to_string(entry.datetime);
+            const EntryTable::row entry = _entries[index];
+            const string datetime = timepoint_to_string(entry.datetime());
             const string date = datetime.substr(0, datetime.find('T'));
-            string title = replace_in_title(entry.title);
+            string title = replace_in_title(string(entry.title()));
             if (title.empty())
             {
-                title = "++" + entry.uri + "++";
+                title = "++" + string(entry.uri()) + "++";
             }
             _out << "\n* xref:dt_" << datetime << '[' << title << "] _("
                  << date << ")_" << endl;
@@ -236,15 +237,15 @@ void Export::AsciiDoc::print_tags(const tagmap &tags) const
     _out << endl;
 }
 
-string Export::AsciiDoc::get_day(const Database::entry &entry)
+string Export::AsciiDoc::get_day(const EntryTable::row &entry)
 {
-    const string datetime = timepoint_to_string(entry.datetime);
+    const string datetime = timepoint_to_string(entry.datetime());
     return datetime.substr(0, datetime.find('T'));
 }
 
-string Export::AsciiDoc::get_time(const Database::entry &entry)
+string Export::AsciiDoc::get_time(const EntryTable::row &entry)
 {
-    const string datetime = timepoint_to_string(entry.datetime);
+    const string datetime = timepoint_to_string(entry.datetime());
     return datetime.substr(datetime.find('T') + 1);
 }
 } // namespace remwharead
@@ -0,0 +1,118 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "export/atom.hpp"
+#include "version.hpp"
+#include <array>
+#include <ctime>
+
+namespace remwharead
+{
+using std::array;
+using std::cerr;
+using std::endl;
+using std::time_t;
+
+void Export::Atom::print() const
+{
+    try
+    {
+        // Write the buffer to the stream whenever it grows beyond this size.
+        constexpr size_t flush_at = 64 * 1024;
+        string buffer;
+        buffer.reserve(flush_at + 4096);
+
+        buffer += R"(<feed xmlns="http://www.w3.org/2005/Atom">)"
+            "<title>Visited things</title>"
+            "<subtitle>Export from remwharead.</subtitle>"
+            "<id>urn:remwharead:visited-things</id><updated>";
+        append_rfc3339(buffer, system_clock::now());
+        buffer += "</updated><author><name>remwharead</name></author>"
+            R"(<generator version=")";
+        append_escaped(buffer, version);
+        buffer += R"(">remwharead</generator>)";
+
+        for (const EntryTable::row entry : _entries)
+        {
+            append_entry(buffer, entry);
+            if (buffer.size() >= flush_at)
+            {
+                _out.write(buffer.data(),
+                           static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+
+        buffer += "</feed>";
+        _out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        _out << endl;
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+}
+
+void Export::Atom::append_rfc3339(string &buffer, const time_point &tp)
+{
+    const time_t time = system_clock::to_time_t(tp);
+    std::tm tm = {};
+    gmtime_r(&time, &tm);
+
+    // “1970-01-01T00:00:00Z”.
+    array<char, 20> out = {};
+    const auto put2 = [&out](const size_t pos, const int value)
+    {
+        out[pos] = static_cast<char>('0' + value / 10);
+        out[pos + 1] = static_cast<char>('0' + value % 10);
+    };
+    const int year = tm.tm_year + 1900;
+
+    put2(0, year / 100);
+    put2(2, year % 100);
+    out[4] = '-';
+    put2(5, tm.tm_mon + 1);
+    out[7] = '-';
+    put2(8, tm.tm_mday);
+    out[10] = 'T';
+    put2(11, tm.tm_hour);
+    out[13] = ':';
+    put2(14, tm.tm_min);
+    out[16] = ':';
+    put2(17, tm.tm_sec);
+    out[19] = 'Z';
+
+    buffer.append(out.data(), out.size());
+}
+
+void Export::Atom::append_entry(string &buffer, const EntryTable::row &entry)
+{
+    buffer += "<entry><title>";
+    append_title(buffer, entry);
+    buffer += R"(</title><link href=")";
+    append_escaped(buffer, entry.uri());
+    buffer += R"("/><id>)";
+    // The same URI can be saved more than once, the time makes it unique.
+    append_escaped(buffer, entry.uri());
+    buffer += entry.uri().find('#') == string_view::npos ? '#' : '-';
+    append_rfc3339(buffer, entry.datetime());
+    buffer += "</id><updated>";
+    append_rfc3339(buffer, entry.datetime());
+    buffer += R"(</updated><summary type="html">)";
+    append_description(buffer, entry);
+    buffer += "</summary></entry>";
+}
+} // namespace remwharead
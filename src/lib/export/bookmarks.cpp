@@ -18,6 +18,7 @@
 #include "sqlite.hpp"
 #include <chrono>
 #include <string>
+#include <string_view>
 
 namespace remwharead
 {
@@ -25,6 +26,7 @@ using std::chrono::system_clock;
 using std::chrono::duration_cast;
 using std::chrono::seconds;
 using std::string;
+using std::string_view;
 
 void Export::Bookmarks::print() const
 {
@@ -37,19 +39,19 @@ void Export::Bookmarks::print() const
         "<DT><H3>remwharead</H3>\n"
         "<DL><p>\n";
 
-    for (const Database::entry & entry : _entries)
+    for (const EntryTable::row entry : _entries)
     {
-        string title = entry.title;
+        string_view title = entry.title();
         if (title.empty())
         {
-            title = entry.uri;
+            title = entry.uri();
         }
-        system_clock::time_point tp = entry.datetime;
+        system_clock::time_point tp = entry.datetime();
         system_clock::duration duration = tp.time_since_epoch();
         string time_seconds =
             std::to_string(duration_cast<seconds>(duration).count());
 
-        _out << "<DT><A HREF=\"" << entry.uri << "\" "
+        _out << "<DT><A HREF=\"" << entry.uri() << "\" "
              << "ADD_DATE=\"" << time_seconds << "\">"
              << title << "</A>\n";
     }
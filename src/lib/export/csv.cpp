@@ -28,14 +28,15 @@ void Export::CSV::print() const
     {
         _out << R"("URI","Archived URI","Date & time","Tags",)"
              << R"("Title","Description","Full text")" << "\r\n";
-        for (const Database::entry &entry : _entries)
+        for (const EntryTable::row entry : _entries)
         {
-            _out << '"' << quote(entry.uri) << "\",\""
-                 << quote(entry.archive_uri) << "\",\""
-                 << timepoint_to_string(entry.datetime) << "\",\""
-                 << quote(Database::tags_to_string(entry.tags)) << "\",\""
-                 << quote(entry.title) << "\",\""
-                 << quote(entry.description) << "\",\""
+            timestring_buffer datetime;
+            _out << '"' << quote(entry.uri()) << "\",\""
+                 << quote(entry.archive_uri()) << "\",\""
+                 << timepoint_to_chars(entry.datetime(), datetime) << "\",\""
+                 << quote(entry.tags_to_string()) << "\",\""
+                 << quote(entry.title()) << "\",\""
+                 << quote(entry.description()) << "\",\""
                  << quote(entry.fulltext_oneline()) << '"'<< "\r\n";
         }
     }
@@ -45,13 +46,21 @@ void Export::CSV::print() const
     }
 }
 
-string Export::CSV::quote(string field)
+string Export::CSV::quote(const string_view field)
 {
+    string quoted;
+    quoted.reserve(field.size());
+
     size_t pos = 0;
-    while ((pos = field.find('"', pos)) != std::string::npos)
+    size_t newpos = 0;
+    while ((newpos = field.find('"', pos)) != string_view::npos)
     {
-        field.replace(pos, 1, "\"\"");
+        quoted.append(field, pos, newpos + 1 - pos);
+        quoted += '"';
+        pos = newpos + 1;
     }
-    return field;
+    quoted.append(field, pos, string_view::npos);
+
+    return quoted;
 }
 } // namespace remwharead
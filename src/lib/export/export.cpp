@@ -15,24 +15,22 @@
  */
 
 #include "export/export.hpp"
-#include <algorithm>
 
 namespace remwharead::Export
 {
 ExportBase::ExportBase(const list<Database::entry> &entries, ostream &out)
-    : _entries(sort_entries(entries))
+    : _entries(sort_entries(EntryTable(entries)))
     , _out(out)
 {}
 
-list<Database::entry>
-ExportBase::sort_entries(list<Database::entry> entries)
-{
-    entries.sort([](const auto &a, const auto &b)
-                 {
-                     return (a.datetime > b.datetime);
-                 });
-    entries.unique();
+ExportBase::ExportBase(const EntryTable &entries, ostream &out,
+                       const bool keep_order)
+    : _entries(keep_order ? entries : sort_entries(entries))
+    , _out(out)
+{}
 
-    return entries;
+EntryTable ExportBase::sort_entries(const EntryTable &entries)
+{
+    return entries.select(entries.order_by_datetime(true));
 }
 } // namespace remwharead::Export
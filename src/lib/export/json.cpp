@@ -18,12 +18,15 @@
 #include "time.hpp"
 #include <Poco/JSON/Object.h>
 #include <Poco/JSON/Stringifier.h>
+#include <string>
+#include <string_view>
 
 
 namespace remwharead
 {
 using std::cerr;
 using std::endl;
+using std::string_view;
 
 void Export::JSON::print() const
 {
@@ -31,22 +34,22 @@ void Export::JSON::print() const
     {
         Poco::JSON::Array root = Poco::JSON::Array();
 
-        for (const Database::entry &entry : _entries)
+        for (const EntryTable::row entry : _entries)
         {
             Poco::JSON::Object json_entry = Poco::JSON::Object();
 
-            json_entry.set("uri", entry.uri);
-            json_entry.set("archive_uri", entry.archive_uri);
-            json_entry.set("datetime", timepoint_to_string(entry.datetime));
+            json_entry.set("uri", string(entry.uri()));
+            json_entry.set("archive_uri", string(entry.archive_uri()));
+            json_entry.set("datetime", timepoint_to_string(entry.datetime()));
             Poco::JSON::Array tags = Poco::JSON::Array();
-            for (const string &tag : entry.tags)
+            for (const string_view tag : entry.tags())
             {
-                tags.add(tag);
+                tags.add(string(tag));
             }
             json_entry.set("tags", tags);
-            json_entry.set("title", entry.title);
-            json_entry.set("description", entry.description);
-            json_entry.set("fulltext", entry.fulltext);
+            json_entry.set("title", string(entry.title()));
+            json_entry.set("description", string(entry.description()));
+            json_entry.set("fulltext", string(entry.fulltext()));
 
             root.add(json_entry);
         }
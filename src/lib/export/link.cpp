@@ -24,9 +24,9 @@ using std::string;
 
 void Export::Link::print() const
 {
-    for (const Database::entry & entry : _entries)
+    for (const EntryTable::row entry : _entries)
     {
-        _out << entry.uri << '\n';
+        _out << entry.uri() << '\n';
     }
 }
 } // namespace remwharead
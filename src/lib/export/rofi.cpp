@@ -27,13 +27,13 @@ void Export::Rofi::print() const
     _out << static_cast<char>(0x00) << "markup-rows"
          << static_cast<char>(0x1f) << "true\n";
 
-    for (const Database::entry & entry : _entries)
+    for (const EntryTable::row entry : _entries)
     {
-        _out << entry.title
+        _out << entry.title()
              << R"( <span size="small" weight="light" style="italic">()"
-             << Database::tags_to_string(entry.tags) << ")</span> "
+             << entry.tags_to_string() << ")</span> "
              << R"(<span size="xx-small" weight="ultralight">)"
-             << entry.uri << "</span>\n";
+             << entry.uri() << "</span>\n";
     }
 }
 } // namespace remwharead
@@ -17,135 +17,50 @@
 #include "export/rss.hpp"
 #include "time.hpp"
 #include "version.hpp"
-#include <Poco/DateTime.h>
-#include <Poco/DateTimeFormatter.h>
-#include <Poco/SAX/AttributesImpl.h>
-#include <Poco/Timestamp.h>
-#include <Poco/XML/XMLWriter.h>
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <ctime>
 
 namespace remwharead
 {
+using std::array;
 using std::cerr;
 using std::endl;
 using std::time_t;
-using Poco::XML::XMLWriter;
-using Poco::XML::AttributesImpl;
-using Poco::DateTime;
-using Poco::DateTimeFormatter;
-using Poco::Timestamp;
 
 void Export::RSS::print() const
 {
     try
     {
-        XMLWriter writer(_out, XMLWriter::CANONICAL);
-        AttributesImpl attrs_rss;
-        AttributesImpl attrs_guid;
-        constexpr char timefmt_rfc822[] = "%w, %d %b %Y %H:%M:%S %Z";
-
-        attrs_rss.addAttribute("", "", "version", "", "2.0");
-        attrs_rss.addAttribute("", "", "xmlns:atom", "",
-                               "http://www.w3.org/2005/Atom");
-        attrs_guid.addAttribute("", "", "isPermaLink", "", "false");
-
-        writer.startDocument();
-        writer.startElement("", "", "rss", attrs_rss);
-        writer.startElement("", "", "channel");
-
-        writer.startElement("", "", "title");
-        writer.characters("Visited things");
-        writer.endElement("", "", "title");
-
-        writer.startElement("", "", "link");
-        writer.endElement("", "", "link");
-
-        writer.startElement("", "", "description");
-        writer.characters("Export from remwharead.");
-        writer.endElement("", "", "description");
-
-        writer.startElement("", "", "generator");
-        writer.characters(string("remwharead ") + version);
-        writer.endElement("", "", "generator");
-
-        const string now = DateTimeFormatter::format(DateTime(),
-                                                     timefmt_rfc822);
-        writer.startElement("", "", "lastBuildDate");
-        writer.characters(now);
-        writer.endElement("", "", "lastBuildDate");
-
-        for (const Database::entry &entry : _entries)
+        // Write the buffer to the stream whenever it grows beyond this size.
+        constexpr size_t flush_at = 64 * 1024;
+        string buffer;
+        buffer.reserve(flush_at + 4096);
+
+        buffer += R"(<rss version="2.0" )"
+            R"(xmlns:atom="http://www.w3.org/2005/Atom"><channel>)"
+            "<title>Visited things</title><link/>"
+            "<description>Export from remwharead.</description>"
+            "<generator>remwharead ";
+        append_escaped(buffer, version);
+        buffer += "</generator><lastBuildDate>";
+        append_rfc822(buffer, system_clock::now());
+        buffer += "</lastBuildDate>";
+
+        for (const EntryTable::row entry : _entries)
         {
-            writer.startElement("", "", "item");
-
-            writer.startElement("", "", "title");
-            if (!entry.title.empty())
-            {
-                writer.characters(entry.title);
-            }
-            else
-            {
-                constexpr std::uint8_t maxlen = 100;
-                string title = entry.description.substr(0, maxlen);
-                if (entry.description.length() > maxlen)
-                {
-                    title += " […]";
-                }
-                writer.characters(title);
-            }
-            writer.endElement("", "", "title");
-
-            writer.startElement("", "", "link");
-            writer.characters(entry.uri);
-            writer.endElement("", "", "link");
-
-            writer.startElement("", "", "guid", attrs_guid);
-            writer.characters(entry.uri + " at "
-                              + timepoint_to_string(entry.datetime));
-            writer.endElement("", "", "guid");
-
-            const time_t time = system_clock::to_time_t(entry.datetime);
-            const string time_visited = DateTimeFormatter::format(
-                Timestamp::fromEpochTime(time), timefmt_rfc822);
-            writer.startElement("", "", "pubDate");
-            writer.characters(time_visited);
-            writer.endElement("", "", "pubDate");
-
-            string description = entry.description;
-            if (!description.empty())
-            {
-                description = "<p>" + description.append("</p>");
-            }
-            if (!entry.tags.empty())
+            append_item(buffer, entry);
+            if (buffer.size() >= flush_at)
             {
-                description += "<p><strong>Tags:</strong> ";
-                for (const string &tag : entry.tags)
-                {
-                    description += tag;
-                    if (tag != *(entry.tags.rbegin()))
-                    {
-                        description += ", ";
-                    }
-                }
-                description += "</p>";
+                _out.write(buffer.data(),
+                           static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
             }
-            if (!entry.archive_uri.empty())
-            {
-                description += "<p><strong>Archived version:</strong> "
-                    "<a href=\"" + entry.archive_uri + "\">"
-                    + entry.archive_uri + "</a></p>";
-            }
-            writer.startElement("", "", "description");
-            writer.characters(description);
-            writer.endElement("", "", "description");
-
-            writer.endElement("", "", "item");
         }
 
-        writer.endElement("", "", "channel");
-        writer.endElement("", "", "rss");
-        writer.endDocument();
+        buffer += "</channel></rss>";
+        _out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
         _out << endl;
     }
     catch (std::exception &e)
@@ -153,4 +68,161 @@ void Export::RSS::print() const
         cerr << "Error in " << __func__ << ": " << e.what() << endl;
     }
 }
+
+void Export::RSS::append_escaped(string &buffer, const string_view text)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        const char c = text[i];
+        const char *replacement = nullptr;
+        switch (c)
+        {
+        case '&':
+            replacement = "&amp;";
+            break;
+        case '<':
+            replacement = "&lt;";
+            break;
+        case '>':
+            replacement = "&gt;";
+            break;
+        case '"':
+            replacement = "&quot;";
+            break;
+        case '\'':
+            replacement = "&apos;";
+            break;
+        default:
+        {
+            // Control characters other than tab and newlines are not allowed
+            // in XML 1.0, skip them.
+            const auto uc = static_cast<unsigned char>(c);
+            if (uc >= 0x20 || c == '\t' || c == '\n' || c == '\r')
+            {
+                continue;
+            }
+            replacement = "";
+            break;
+        }
+        }
+
+        buffer.append(text, pos, i - pos);
+        buffer += replacement;
+        pos = i + 1;
+    }
+    buffer.append(text, pos, string_view::npos);
+}
+
+void Export::RSS::append_rfc822(string &buffer, const time_point &tp)
+{
+    constexpr array<const char *, 7> weekdays
+        = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    constexpr array<const char *, 12> months
+        = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+           "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    const time_t time = system_clock::to_time_t(tp);
+    std::tm tm = {};
+    gmtime_r(&time, &tm);
+
+    // “Thu, 01 Jan 1970 00:00:00 GMT”.
+    array<char, 29> out = {};
+    const auto put2 = [&out](const size_t pos, const int value)
+    {
+        out[pos] = static_cast<char>('0' + value / 10);
+        out[pos + 1] = static_cast<char>('0' + value % 10);
+    };
+    const int year = tm.tm_year + 1900;
+
+    std::copy_n(weekdays[static_cast<size_t>(tm.tm_wday)], 3, out.begin());
+    out[3] = ',';
+    out[4] = ' ';
+    put2(5, tm.tm_mday);
+    out[7] = ' ';
+    std::copy_n(months[static_cast<size_t>(tm.tm_mon)], 3, out.begin() + 8);
+    out[11] = ' ';
+    put2(12, year / 100);
+    put2(14, year % 100);
+    out[16] = ' ';
+    put2(17, tm.tm_hour);
+    out[19] = ':';
+    put2(20, tm.tm_min);
+    out[22] = ':';
+    put2(23, tm.tm_sec);
+    std::copy_n(" GMT", 4, out.begin() + 25);
+
+    buffer.append(out.data(), out.size());
+}
+
+void Export::RSS::append_title(string &buffer, const EntryTable::row &entry)
+{
+    if (!entry.title().empty())
+    {
+        append_escaped(buffer, entry.title());
+    }
+    else
+    {
+        constexpr std::uint8_t maxlen = 100;
+        append_escaped(buffer, entry.description().substr(0, maxlen));
+        if (entry.description().length() > maxlen)
+        {
+            buffer += " […]";
+        }
+    }
+}
+
+void Export::RSS::append_description(string &buffer,
+                                     const EntryTable::row &entry)
+{
+    // The description contains HTML, which is escaped as a whole.
+    if (!entry.description().empty())
+    {
+        buffer += "&lt;p&gt;";
+        append_escaped(buffer, entry.description());
+        buffer += "&lt;/p&gt;";
+    }
+    if (!entry.tags().empty())
+    {
+        buffer += "&lt;p&gt;&lt;strong&gt;Tags:&lt;/strong&gt; ";
+        bool first = true;
+        for (const string_view tag : entry.tags())
+        {
+            if (!first)
+            {
+                buffer += ", ";
+            }
+            append_escaped(buffer, tag);
+            first = false;
+        }
+        buffer += "&lt;/p&gt;";
+    }
+    if (!entry.archive_uri().empty())
+    {
+        buffer += "&lt;p&gt;&lt;strong&gt;Archived version:&lt;/strong&gt; "
+            "&lt;a href=&quot;";
+        append_escaped(buffer, entry.archive_uri());
+        buffer += "&quot;&gt;";
+        append_escaped(buffer, entry.archive_uri());
+        buffer += "&lt;/a&gt;&lt;/p&gt;";
+    }
+}
+
+void Export::RSS::append_item(string &buffer, const EntryTable::row &entry)
+{
+    buffer += "<item><title>";
+    append_title(buffer, entry);
+    buffer += "</title><link>";
+    append_escaped(buffer, entry.uri());
+    buffer += R"(</link><guid isPermaLink="false">)";
+    append_escaped(buffer, entry.uri());
+    buffer += " at ";
+    timestring_buffer datetime;
+    buffer += timepoint_to_chars(entry.datetime(), datetime);
+    buffer += "</guid><pubDate>";
+    append_rfc822(buffer, entry.datetime());
+    buffer += "</pubDate><description>";
+    append_description(buffer, entry);
+    buffer += "</description></item>";
+}
 } // namespace remwharead
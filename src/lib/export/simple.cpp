@@ -18,24 +18,28 @@
 #include "sqlite.hpp"
 #include "time.hpp"
 #include <string>
+#include <string_view>
 
 namespace remwharead
 {
 using std::string;
+using std::string_view;
 
 void Export::Simple::print() const
 {
-    for (const Database::entry & entry : _entries)
+    for (const EntryTable::row entry : _entries)
     {
-        const string timestring = timepoint_to_string(entry.datetime);
+        timestring_buffer buffer;
+        const string_view timestring = timepoint_to_chars(entry.datetime(),
+                                                          buffer);
         _out << timestring.substr(0, timestring.find('T')) << ": ";
-        if (!entry.title.empty())
+        if (!entry.title().empty())
         {
-            _out << entry.title << '\n';
+            _out << entry.title() << '\n';
             _out << "            ";
         }
 
-        _out << "<" << entry.uri << ">\n";
+        _out << "<" << entry.uri() << ">\n";
     }
 }
 } // namespace remwharead
@@ -0,0 +1,154 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hash.hpp"
+#include <array>
+#include <cstdint>
+
+namespace remwharead
+{
+using std::uint32_t;
+using std::uint64_t;
+
+namespace
+{
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+constexpr uint64_t rotl(const uint64_t x, const int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// The reference implementation reads little endian.
+uint64_t read64(const char *p)
+{
+    uint64_t value = 0;
+    for (size_t i = 8; i > 0; --i)
+    {
+        value = (value << 8) | static_cast<unsigned char>(p[i - 1]);
+    }
+    return value;
+}
+
+uint32_t read32(const char *p)
+{
+    uint32_t value = 0;
+    for (size_t i = 4; i > 0; --i)
+    {
+        value = (value << 8) | static_cast<unsigned char>(p[i - 1]);
+    }
+    return value;
+}
+
+constexpr uint64_t round(uint64_t acc, const uint64_t input)
+{
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+constexpr uint64_t merge_round(uint64_t acc, const uint64_t val)
+{
+    acc ^= round(0, val);
+    return acc * prime1 + prime4;
+}
+} // namespace
+
+uint64_t xxh64(const string_view data, const uint64_t seed)
+{
+    const char *p = data.data();
+    const char *const end = p + data.size();
+    uint64_t hash;
+
+    if (data.size() >= 32)
+    {
+        uint64_t v1 = seed + prime1 + prime2;
+        uint64_t v2 = seed + prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime1;
+
+        const char *const limit = end - 32;
+        do
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+
+    hash += data.size();
+
+    while (end - p >= 8)
+    {
+        hash ^= round(0, read64(p));
+        hash = rotl(hash, 27) * prime1 + prime4;
+        p += 8;
+    }
+    if (end - p >= 4)
+    {
+        hash ^= static_cast<uint64_t>(read32(p)) * prime1;
+        hash = rotl(hash, 23) * prime2 + prime3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= static_cast<unsigned char>(*p) * prime5;
+        hash = rotl(hash, 11) * prime1;
+        ++p;
+    }
+
+    // Avalanche.
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+string content_hash(const string_view data)
+{
+    constexpr std::array<char, 16> digits{'0', '1', '2', '3', '4', '5', '6',
+                                          '7', '8', '9', 'a', 'b', 'c', 'd',
+                                          'e', 'f'};
+    uint64_t hash = xxh64(data);
+    string hex(16, '0');
+    for (size_t i = hex.size(); i > 0; --i)
+    {
+        hex[i - 1] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+
+    return hex;
+}
+} // namespace remwharead
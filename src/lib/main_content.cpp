@@ -0,0 +1,552 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "main_content.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+namespace remwharead
+{
+using std::vector;
+
+namespace
+{
+//! An element that separates paragraphs, like `<div>` or `<p>`.
+struct element
+{
+    string tag;
+    size_t parent;
+    //! The last element inside this one.
+    size_t last;
+    //! Score for the tag name, class and id.
+    double weight;
+    //! Score for the paragraphs inside.
+    double score;
+    //! Bytes of text inside, and how many of them are in links.
+    size_t text_length;
+    size_t link_length;
+    //! Navigation, sidebar and the like, or inside one.
+    bool unlikely;
+};
+
+//! Text between two element boundaries.
+struct paragraph
+{
+    size_t element;
+    //! Position in the collected text.
+    size_t offset;
+    size_t size;
+    size_t link_length;
+};
+
+//! Class and id parts of elements that are not the main content.
+const std::initializer_list<string_view> unlikely_words{
+    "banner", "breadcrumb", "combx", "comment", "community", "consent",
+    "cookie", "disqus", "footer", "gdpr", "header", "menu", "modal",
+    "navbar", "newsletter", "pager", "pagination", "popup", "related",
+    "remark", "replies", "share", "shoutbox", "sidebar", "skyscraper",
+    "social", "sponsor", "subscribe", "widget"};
+//! Class and id parts that make unlikely_words unreliable.
+const std::initializer_list<string_view> maybe_words{
+    "article", "body", "column", "content", "main"};
+const std::initializer_list<string_view> positive_words{
+    "article", "blog", "body", "content", "entry", "main", "page", "post",
+    "story", "text"};
+const std::initializer_list<string_view> negative_words{
+    "comment", "contact", "foot", "masthead", "meta", "promo", "related",
+    "share", "sidebar", "sponsor", "tags", "tool", "widget"};
+
+bool is_space(const char c)
+{
+    return (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f'
+            || c == '\v');
+}
+
+bool is_alnum(const char c)
+{
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9'));
+}
+
+char to_lower(const char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool is_one_of(const string_view name,
+               const std::initializer_list<string_view> names)
+{
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+bool contains_any(const string_view text,
+                  const std::initializer_list<string_view> words)
+{
+    return std::any_of(words.begin(), words.end(),
+                       [text](const string_view word)
+                       { return text.find(word) != string_view::npos; });
+}
+
+//! Elements that end paragraphs.
+bool is_block(const string_view tag)
+{
+    return is_one_of(tag, {"address", "article", "aside", "blockquote",
+                           "body", "caption", "center", "dd", "details",
+                           "dialog", "div", "dl", "dt", "fieldset",
+                           "figcaption", "figure", "footer", "form", "h1",
+                           "h2", "h3", "h4", "h5", "h6", "header", "li",
+                           "main", "nav", "ol", "p", "pre", "section",
+                           "summary", "table", "tbody", "td", "tfoot", "th",
+                           "thead", "tr", "ul"});
+}
+
+//! Elements whose content is never text of the page.
+bool is_skipped(const string_view tag)
+{
+    return is_one_of(tag, {"button", "iframe", "noscript", "script",
+                           "select", "style", "svg", "template", "textarea",
+                           "title"});
+}
+
+//! Returns the position of the > that ends the tag.
+size_t tag_end(const string_view html, size_t pos)
+{
+    char quote = 0;
+    char previous = 0;
+    for (; pos < html.size(); ++pos)
+    {
+        const char c = html[pos];
+        if (quote != 0)
+        {
+            if (c == quote)
+            {
+                quote = 0;
+            }
+            continue;
+        }
+        if ((c == '"' || c == '\'') && previous == '=')
+        {
+            quote = c;
+        }
+        else if (c == '>')
+        {
+            return pos;
+        }
+        if (!is_space(c))
+        {
+            previous = c;
+        }
+    }
+
+    return html.size();
+}
+
+//! Returns the position after the end tag.
+size_t skip_element(const string_view html, size_t pos, const string_view tag)
+{
+    while ((pos = html.find("</", pos)) != string_view::npos)
+    {
+        pos += 2;
+        const string_view name{html.substr(pos, tag.size())};
+        if (std::equal(name.begin(), name.end(), tag.begin(), tag.end(),
+                       [](const char a, const char b)
+                       { return to_lower(a) == b; }))
+        {
+            pos = html.find('>', pos);
+            return (pos == string_view::npos) ? html.size() : pos + 1;
+        }
+    }
+
+    return html.size();
+}
+
+//! The values of the class and id attributes, in lowercase.
+string class_and_id(const string_view attributes)
+{
+    string lowercase(attributes);
+    std::transform(lowercase.begin(), lowercase.end(), lowercase.begin(),
+                   to_lower);
+
+    string words;
+    for (const string_view name : {"class", "id"})
+    {
+        size_t pos = 0;
+        while ((pos = lowercase.find(name, pos)) != string::npos)
+        {
+            const bool whole_name = (pos > 0 && is_space(lowercase[pos - 1]));
+            pos = lowercase.find_first_not_of(" \t\r\n", pos + name.size());
+            if (!whole_name || pos == string::npos || lowercase[pos] != '=')
+            {
+                continue;
+            }
+
+            size_t start = lowercase.find_first_not_of(" \t\r\n", pos + 1);
+            if (start == string::npos)
+            {
+                break;
+            }
+            size_t end = 0;
+            if (lowercase[start] == '"' || lowercase[start] == '\'')
+            {
+                end = lowercase.find(lowercase[start], start + 1);
+                ++start;
+            }
+            else
+            {
+                end = lowercase.find_first_of(" \t\r\n", start);
+            }
+            words.append(lowercase, start, end - start) += ' ';
+            break;
+        }
+    }
+
+    return words;
+}
+
+//! Score for the tag name, class and id, like in Readability.
+double weight_of(const string_view tag, const string_view words)
+{
+    double weight = 0;
+    if (tag == "div")
+    {
+        weight = 5;
+    }
+    else if (is_one_of(tag, {"blockquote", "pre", "td"}))
+    {
+        weight = 3;
+    }
+    else if (is_one_of(tag, {"address", "dd", "dl", "dt", "form", "li", "ol",
+                             "ul"}))
+    {
+        weight = -3;
+    }
+    else if (is_one_of(tag, {"h1", "h2", "h3", "h4", "h5", "h6", "th"}))
+    {
+        weight = -5;
+    }
+
+    if (contains_any(words, positive_words))
+    {
+        weight += 25;
+    }
+    if (contains_any(words, negative_words))
+    {
+        weight -= 25;
+    }
+
+    return weight;
+}
+
+bool is_unlikely(const string_view tag, const string_view words)
+{
+    if (is_one_of(tag, {"aside", "dialog", "footer", "nav"}))
+    {
+        return true;
+    }
+    if (is_one_of(tag, {"article", "body", "main"}))
+    {
+        return false;
+    }
+
+    return (contains_any(words, unlikely_words)
+            && !contains_any(words, maybe_words));
+}
+
+//! Share of the text that is in links.
+double link_density(const size_t text_length, const size_t link_length)
+{
+    if (text_length == 0)
+    {
+        return 0;
+    }
+
+    return static_cast<double>(link_length)
+        / static_cast<double>(text_length);
+}
+} // namespace
+
+string extract_main_content(const string_view html)
+{
+    // Element 0 is the page itself.
+    vector<element> elements{{"", 0, 0, 0, 0, 0, 0, false}};
+    vector<size_t> open;
+    vector<paragraph> paragraphs;
+    // The text of all paragraphs, with whitespace collapsed.
+    string text;
+    text.reserve(html.size() / 2);
+    paragraph current{0, 0, 0, 0};
+    size_t links = 0;           // Number of open <a> elements.
+    bool space = false;
+
+    const auto innermost = [&open]
+    {
+        return open.empty() ? size_t{0} : open.back();
+    };
+    const auto add = [&](const char c)
+    {
+        if (is_space(c))
+        {
+            space = (text.size() > current.offset);
+            return;
+        }
+        if (space)
+        {
+            text += ' ';
+            current.link_length += (links > 0) ? 1 : 0;
+            space = false;
+        }
+        text += c;
+        current.link_length += (links > 0) ? 1 : 0;
+    };
+    const auto end_paragraph = [&]
+    {
+        current.size = text.size() - current.offset;
+        if (current.size != 0)
+        {
+            paragraphs.push_back(current);
+        }
+        current = {innermost(), text.size(), 0, 0};
+        space = false;
+    };
+    // Close elements until n_open are open.
+    const auto close = [&](const size_t n_open)
+    {
+        while (open.size() > n_open)
+        {
+            elements[open.back()].last = elements.size() - 1;
+            open.pop_back();
+        }
+    };
+
+    size_t pos = 0;
+    while (pos < html.size())
+    {
+        if (html[pos] != '<')
+        {
+            add(html[pos]);
+            ++pos;
+            continue;
+        }
+        if (html.compare(pos, 4, "<!--") == 0)
+        {
+            pos = html.find("-->", pos + 4);
+            pos = (pos == string_view::npos) ? html.size() : pos + 3;
+            continue;
+        }
+
+        const bool closing = (html.compare(pos, 2, "</") == 0);
+        const size_t name_start = pos + (closing ? 2 : 1);
+        size_t name_end = name_start;
+        while (name_end < html.size() && is_alnum(html[name_end]))
+        {
+            ++name_end;
+        }
+        if (name_end == name_start)
+        {
+            if (name_start < html.size()
+                && (html[name_start] == '!' || html[name_start] == '?'))
+            {   // <!DOCTYPE …> and the like.
+                pos = std::min(tag_end(html, name_start) + 1, html.size());
+            }
+            else
+            {   // Not a tag.
+                add('<');
+                ++pos;
+            }
+            continue;
+        }
+
+        string tag(html.substr(name_start, name_end - name_start));
+        std::transform(tag.begin(), tag.end(), tag.begin(), to_lower);
+        const size_t end = tag_end(html, name_end);
+        const string_view attributes{html.substr(name_end, end - name_end)};
+        pos = std::min(end + 1, html.size());
+
+        if (!closing && is_skipped(tag)
+            && (attributes.empty() || attributes.back() != '/'))
+        {
+            pos = skip_element(html, pos, tag);
+            continue;
+        }
+        if (tag == "a")
+        {
+            if (!closing)
+            {
+                ++links;
+            }
+            else if (links > 0)
+            {
+                --links;
+            }
+            continue;
+        }
+        if (tag == "br" || tag == "hr")
+        {
+            end_paragraph();
+            continue;
+        }
+        if (!is_block(tag))
+        {
+            continue;
+        }
+
+        end_paragraph();
+        if (closing)
+        {
+            for (size_t i = open.size(); i > 0; --i)
+            {
+                if (elements[open[i - 1]].tag == tag)
+                {
+                    close(i - 1);
+                    break;
+                }
+            }
+        }
+        else
+        {
+            // Some end tags can be left out.
+            const string_view top{elements[innermost()].tag};
+            const auto both_one_of
+                = [&](const std::initializer_list<string_view> names)
+            {
+                return is_one_of(tag, names) && is_one_of(top, names);
+            };
+            if (top == "p" || (tag == "li" && top == "li")
+                || both_one_of({"dd", "dt"}) || both_one_of({"td", "th"}))
+            {
+                close(open.size() - 1);
+            }
+
+            const size_t parent = innermost();
+            const string words = class_and_id(attributes);
+            const double weight = weight_of(tag, words);
+            const bool unlikely = (elements[parent].unlikely
+                                   || is_unlikely(tag, words));
+            elements.push_back({std::move(tag), parent, elements.size(),
+                                weight, 0, 0, 0, unlikely});
+            open.push_back(elements.size() - 1);
+        }
+        current.element = innermost();
+    }
+    end_paragraph();
+    close(0);
+    elements.front().last = elements.size() - 1;
+
+    // Elements contain the text of the elements inside them. Elements are
+    // numbered in the order they start, so the elements inside come later.
+    for (const paragraph &p : paragraphs)
+    {
+        elements[p.element].text_length += p.size;
+        elements[p.element].link_length += p.link_length;
+    }
+    for (size_t i = elements.size() - 1; i > 0; --i)
+    {
+        element &parent = elements[elements[i].parent];
+        parent.text_length += elements[i].text_length;
+        parent.link_length += elements[i].link_length;
+    }
+
+    // Paragraphs give their score to the element around them, and half of it
+    // to the element around that one.
+    constexpr size_t min_length = 25;
+    for (const paragraph &p : paragraphs)
+    {
+        const element &e = elements[p.element];
+        if (e.unlikely || p.size < min_length)
+        {
+            continue;
+        }
+        const auto first = text.begin() + static_cast<std::ptrdiff_t>(p.offset);
+        const double score = 1.0
+            + static_cast<double>(
+                std::count(first, first + static_cast<std::ptrdiff_t>(p.size),
+                           ','))
+            + static_cast<double>(std::min(p.size / 100, size_t{3}));
+        elements[e.parent].score += score;
+        elements[elements[e.parent].parent].score += score / 2;
+    }
+
+    const auto final_score = [](const element &e)
+    {
+        return (e.score + e.weight)
+            * (1.0 - link_density(e.text_length, e.link_length));
+    };
+    size_t best = elements.size();
+    double best_score = 0;
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        const element &e = elements[i];
+        if (e.score > 0 && !e.unlikely
+            && (best == elements.size() || final_score(e) > best_score))
+        {
+            best = i;
+            best_score = final_score(e);
+        }
+    }
+    if (best == elements.size())
+    {
+        return {};
+    }
+
+    // Add elements next to the best one that are good enough.
+    vector<size_t> selected{best};
+    if (best != 0)
+    {
+        const size_t parent = elements[best].parent;
+        const double threshold = std::max(10.0, best_score * 0.2);
+        for (size_t i = 1; i < elements.size(); ++i)
+        {
+            const element &e = elements[i];
+            if (i == best || e.parent != parent || e.unlikely)
+            {
+                continue;
+            }
+            const double density = link_density(e.text_length,
+                                                e.link_length);
+            if ((e.score > 0 && final_score(e) >= threshold)
+                || (e.tag == "p" && e.text_length > 80 && density < 0.25))
+            {
+                selected.push_back(i);
+            }
+        }
+    }
+
+    string content;
+    for (const paragraph &p : paragraphs)
+    {
+        if (elements[p.element].unlikely || p.link_length * 2 > p.size)
+        {
+            continue;
+        }
+        const bool inside = std::any_of(
+            selected.begin(), selected.end(),
+            [&](const size_t i)
+            { return p.element >= i && p.element <= elements[i].last; });
+        if (inside)
+        {
+            content.append(text, p.offset, p.size) += '\n';
+        }
+    }
+    if (!content.empty())
+    {
+        content.pop_back();
+    }
+
+    return content;
+}
+} // namespace remwharead
@@ -0,0 +1,246 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefix_index.hpp"
+#include "term_matcher.hpp"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+namespace remwharead
+{
+namespace
+{
+bool starts_with(const string_view text, const string_view prefix)
+{
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+} // namespace
+
+PrefixIndex::PrefixIndex(const EntryTable &entries)
+{
+    // Number the words in the order they appear first, sort them afterwards.
+    std::unordered_map<string, word_id> ids;
+    vector<word_id> row_words;
+    const auto add = [&](const string_view text)
+    {
+        for_each_word(text, [&](const string_view word)
+        {
+            const auto it = ids.try_emplace(string(word),
+                                            static_cast<word_id>(ids.size()));
+            row_words.push_back(it.first->second);
+        });
+    };
+
+    _word_offsets.reserve(entries.size() + 1);
+    _word_offsets.push_back(0);
+    for (const EntryTable::row row : entries)
+    {
+        row_words.clear();
+        add(fold_case(row.uri()));
+        for (const string_view tag : row.tags())
+        {
+            add(fold_case(tag));
+        }
+        if (entries.has_folded())
+        {
+            add(row.folded_title());
+            add(row.folded_description());
+            add(row.folded_fulltext());
+        }
+        else
+        {
+            add(fold_case(row.title()));
+            add(fold_case(row.description()));
+            add(fold_case(row.fulltext()));
+        }
+
+        std::sort(row_words.begin(), row_words.end());
+        row_words.erase(std::unique(row_words.begin(), row_words.end()),
+                        row_words.end());
+        _word_ids.insert(_word_ids.end(), row_words.begin(), row_words.end());
+        _word_offsets.push_back(static_cast<std::uint32_t>(_word_ids.size()));
+    }
+
+    vector<const string *> sorted(ids.size());
+    for (const auto &[word, id] : ids)
+    {
+        sorted[id] = &word;
+    }
+    vector<word_id> order(ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&sorted](const word_id a, const word_id b)
+              {
+                  return *sorted[a] < *sorted[b];
+              });
+    vector<word_id> new_id(ids.size());
+    _words.reserve(ids.size());
+    for (word_id i = 0; i < order.size(); ++i)
+    {
+        new_id[order[i]] = i;
+        _words.push_back(*sorted[order[i]]);
+    }
+
+    // Renumber the words of the rows and build the list of rows per word.
+    _row_offsets.assign(_words.size() + 1, 0);
+    for (word_id &id : _word_ids)
+    {
+        id = new_id[id];
+        ++_row_offsets[id + 1];
+    }
+    std::partial_sum(_row_offsets.begin(), _row_offsets.end(),
+                     _row_offsets.begin());
+    _rows.resize(_word_ids.size());
+    vector<std::uint32_t> next(_row_offsets.begin(), _row_offsets.end() - 1);
+    for (std::uint32_t row = 0; row < entries.size(); ++row)
+    {
+        const auto first = _word_ids.begin() + _word_offsets[row];
+        const auto last = _word_ids.begin() + _word_offsets[row + 1];
+        std::sort(first, last);
+        for (auto it = first; it != last; ++it)
+        {
+            _rows[next[*it]++] = row;
+        }
+    }
+}
+
+Bitmap PrefixIndex::find(const string_view prefix) const
+{
+    const auto [first, last] = range(prefix);
+    Bitmap found;
+    for (auto i = _row_offsets[first]; i < _row_offsets[last]; ++i)
+    {
+        found.set(_rows[i]);
+    }
+
+    return found;
+}
+
+Bitmap PrefixIndex::narrow(const Bitmap &candidates,
+                           const string_view prefix) const
+{
+    const auto [first, last] = range(prefix);
+    if (first == last)
+    {
+        return {};
+    }
+
+    if (_row_offsets[last] - _row_offsets[first] <= candidates.count())
+    {
+        Bitmap found = find(prefix);
+        found &= candidates;
+        return found;
+    }
+
+    // Look for a word in [first, last) in the sorted words of every
+    // candidate.
+    Bitmap found;
+    for (const size_t row : candidates.indices())
+    {
+        if (row >= size())
+        {
+            break;
+        }
+        const auto row_last = _word_ids.begin() + _word_offsets[row + 1];
+        const auto it = std::lower_bound(
+            _word_ids.begin() + _word_offsets[row], row_last, first);
+        if (it != row_last && *it < last)
+        {
+            found.set(row);
+        }
+    }
+
+    return found;
+}
+
+size_t PrefixIndex::size() const
+{
+    return _word_offsets.empty() ? 0 : _word_offsets.size() - 1;
+}
+
+const vector<string> &PrefixIndex::words() const
+{
+    return _words;
+}
+
+std::pair<PrefixIndex::word_id, PrefixIndex::word_id>
+PrefixIndex::range(const string_view prefix) const
+{
+    // The words that start with prefix are the first ones that are not less
+    // than prefix.
+    const auto first = std::lower_bound(_words.begin(), _words.end(), prefix);
+    const auto last = std::partition_point(
+        first, _words.end(), [prefix](const string &word)
+        {
+            return starts_with(word, prefix);
+        });
+
+    return {static_cast<word_id>(first - _words.begin()),
+            static_cast<word_id>(last - _words.begin())};
+}
+
+IncrementalSearch::IncrementalSearch(const EntryTable &entries)
+    : _index{entries}
+{
+    _all.set(0, entries.size());
+}
+
+const Bitmap &IncrementalSearch::update(const string_view input)
+{
+    vector<string> words;
+    for_each_word(fold_case(input), [&words](const string_view word)
+    {
+        words.emplace_back(word);
+    });
+
+    size_t same = 0;
+    while (same < words.size() && same < _steps.size()
+           && words[same] == _steps[same].first)
+    {
+        ++same;
+    }
+
+    // If characters were added to a word, only the rows that matched the
+    // shorter word can match.
+    Bitmap candidates;
+    if (same < words.size() && same < _steps.size()
+        && starts_with(words[same], _steps[same].first))
+    {
+        candidates = std::move(_steps[same].second);
+    }
+    else
+    {
+        candidates = same == 0 ? _all : _steps[same - 1].second;
+    }
+    _steps.resize(same);
+
+    for (size_t i = same; i < words.size(); ++i)
+    {
+        Bitmap found = _index.narrow(i == same ? candidates
+                                               : _steps.back().second,
+                                     words[i]);
+        _steps.emplace_back(std::move(words[i]), std::move(found));
+    }
+
+    return results();
+}
+
+const Bitmap &IncrementalSearch::results() const
+{
+    return _steps.empty() ? _all : _steps.back().second;
+}
+} // namespace remwharead
@@ -0,0 +1,599 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "query.hpp"
+#include "dictionary.hpp"
+#include "term_matcher.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace remwharead
+{
+using std::string_view;
+using std::move;
+
+namespace
+{
+using kind = Query::node::kind;
+
+struct token
+{
+    enum class kind : std::uint8_t
+    {
+        word,
+        quoted,
+        field,
+        open,
+        close,
+        op_or,
+        op_and,
+        op_not
+    };
+
+    kind type;
+    //! The text of words and quoted terms, the value of fields.
+    string text;
+    //! The name of fields.
+    string name;
+    //! Position in the expression, [start, end).
+    size_t start;
+    size_t end;
+};
+
+constexpr std::array<string_view, 7> field_names{
+    {"tag", "title", "description", "fulltext", "uri", "after", "before"}};
+
+[[noreturn]] void fail(const string &what, const size_t pos)
+{
+    throw std::invalid_argument("Invalid search expression: " + what
+                                + " at position " + std::to_string(pos + 1)
+                                + ".");
+}
+
+bool is_space(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+vector<token> tokenize(const string &expression, const bool is_re)
+{
+    vector<token> tokens;
+    size_t pos = 0;
+    const auto is_delimiter = [is_re](const char c)
+    {
+        return is_space(c) || (!is_re && (c == '(' || c == ')'));
+    };
+    const auto read_word = [&]
+    {
+        const size_t start = pos;
+        while (pos < expression.size() && !is_delimiter(expression[pos]))
+        {
+            ++pos;
+        }
+        return expression.substr(start, pos - start);
+    };
+    const auto read_quoted = [&]
+    {
+        const size_t close = expression.find('"', pos + 1);
+        if (close == string::npos)
+        {
+            fail("Missing closing quote", pos);
+        }
+        string text = expression.substr(pos + 1, close - pos - 1);
+        pos = close + 1;
+        return text;
+    };
+
+    while (true)
+    {
+        while (pos < expression.size() && is_space(expression[pos]))
+        {
+            ++pos;
+        }
+        if (pos == expression.size())
+        {
+            break;
+        }
+
+        const size_t start = pos;
+        const char c = expression[pos];
+        if (!is_re && (c == '(' || c == ')'))
+        {
+            ++pos;
+            tokens.push_back({c == '(' ? token::kind::open
+                                       : token::kind::close,
+                              {}, {}, start, pos});
+            continue;
+        }
+        if (!is_re && c == '"')
+        {
+            string text = read_quoted();
+            tokens.push_back({token::kind::quoted, move(text), {}, start, pos});
+            continue;
+        }
+
+        const size_t colon = expression.find(':', pos);
+        const string_view name = colon == string::npos ? string_view()
+            : string_view(expression).substr(pos, colon - pos);
+        if (std::find(field_names.begin(), field_names.end(), name)
+            != field_names.end())
+        {
+            pos = colon + 1;
+            string value = !is_re && pos < expression.size()
+                && expression[pos] == '"' ? read_quoted() : read_word();
+            if (value.empty())
+            {
+                fail("Missing value after " + string(name) + ":", start);
+            }
+            tokens.push_back({token::kind::field, move(value), string(name),
+                              start, pos});
+            continue;
+        }
+
+        string word = read_word();
+        token::kind type = token::kind::word;
+        if (word == "OR" || word == "||")
+        {
+            type = token::kind::op_or;
+        }
+        else if (word == "AND" || word == "&&")
+        {
+            type = token::kind::op_and;
+        }
+        else if (word == "NOT")
+        {
+            type = token::kind::op_not;
+        }
+        tokens.push_back({type, move(word), {}, start, pos});
+    }
+
+    return tokens;
+}
+
+//! Recursive descent parser, one function per precedence level.
+class parser
+{
+public:
+    parser(const string &expression, const bool is_re)
+        : _expression{expression}
+        , _tokens{tokenize(expression, is_re)}
+    {}
+
+    Query::node parse()
+    {
+        if (_tokens.empty())
+        {
+            return {};
+        }
+
+        Query::node root = parse_or();
+        if (_pos < _tokens.size())
+        {
+            fail("Unexpected \")\"", _tokens[_pos].start);
+        }
+
+        return root;
+    }
+
+private:
+    const string &_expression;
+    const vector<token> _tokens;
+    size_t _pos{0};
+
+    [[nodiscard]] bool next_is(const token::kind type) const
+    {
+        return _pos < _tokens.size() && _tokens[_pos].type == type;
+    }
+
+    //! Returns true if the next token can start an operand.
+    [[nodiscard]] bool next_is_operand() const
+    {
+        return next_is(token::kind::word) || next_is(token::kind::quoted)
+            || next_is(token::kind::field) || next_is(token::kind::open)
+            || next_is(token::kind::op_not);
+    }
+
+    //! Replace nodes with only one child by the child.
+    static Query::node simplify(Query::node node)
+    {
+        if (node.children.size() == 1)
+        {
+            return move(node.children.front());
+        }
+        return node;
+    }
+
+    static Query::node text(const string &term)
+    {
+        Query::node node;
+        node.type = kind::text;
+        node.terms.push_back(fold_case(term));
+        return node;
+    }
+
+    Query::node parse_or()
+    {
+        Query::node result;
+        result.type = kind::any_of;
+        result.children.push_back(parse_and());
+        while (next_is(token::kind::op_or))
+        {
+            ++_pos;
+            result.children.push_back(parse_and());
+        }
+
+        return simplify(move(result));
+    }
+
+    Query::node parse_and()
+    {
+        Query::node result;
+        result.type = kind::all_of;
+        // The plain terms have to be in the same field.
+        Query::node same_field;
+        same_field.type = kind::text;
+        const auto add = [&](Query::node operand)
+        {
+            if (operand.type == kind::text)
+            {
+                same_field.terms.insert(same_field.terms.end(),
+                                        operand.terms.begin(),
+                                        operand.terms.end());
+            }
+            else
+            {
+                result.children.push_back(move(operand));
+            }
+        };
+
+        add(parse_not());
+        while (true)
+        {
+            if (next_is(token::kind::op_and))
+            {
+                ++_pos;
+                add(parse_not());
+            }
+            else if (next_is_operand())
+            {
+                add(parse_not());
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (!same_field.terms.empty())
+        {
+            result.children.insert(result.children.begin(),
+                                   move(same_field));
+        }
+
+        return simplify(move(result));
+    }
+
+    Query::node parse_not()
+    {
+        if (next_is(token::kind::op_not))
+        {
+            ++_pos;
+            Query::node result;
+            result.type = kind::negation;
+            result.children.push_back(parse_not());
+            return result;
+        }
+
+        return parse_primary();
+    }
+
+    Query::node parse_primary()
+    {
+        if (_pos == _tokens.size())
+        {
+            fail("Missing term", _expression.size());
+        }
+
+        const token &current = _tokens[_pos++];
+        switch (current.type)
+        {
+        case token::kind::open:
+        {
+            Query::node inner = parse_or();
+            if (!next_is(token::kind::close))
+            {
+                fail("Missing \")\"", _pos < _tokens.size()
+                     ? _tokens[_pos].start : _expression.size());
+            }
+            ++_pos;
+            return inner;
+        }
+        case token::kind::quoted:
+        {
+            return text(current.text);
+        }
+        case token::kind::word:
+        {   // Words next to each other form one term, with the space between
+            // them.
+            size_t end = current.end;
+            while (next_is(token::kind::word))
+            {
+                end = _tokens[_pos++].end;
+            }
+            return text(_expression.substr(current.start,
+                                           end - current.start));
+        }
+        case token::kind::field:
+        {
+            return field(current);
+        }
+        default:
+        {
+            fail("Missing term", current.start);
+        }
+        }
+    }
+
+    static Query::node field(const token &current)
+    {
+        Query::node result;
+        if (current.name == "after" || current.name == "before")
+        {
+            const string &date = current.text;
+            if (date.size() < 4
+                || !std::all_of(date.begin(), date.begin() + 4,
+                                [](const unsigned char c)
+                                {
+                                    return std::isdigit(c) != 0;
+                                }))
+            {
+                fail("Invalid date", current.start);
+            }
+            result.type = current.name == "after" ? kind::after
+                                                  : kind::before;
+            result.time = string_to_timepoint(date);
+            return result;
+        }
+
+        result.type = kind::field_term;
+        result.terms.push_back(fold_case(current.text));
+        if (current.name == "tag")
+        {
+            result.in = Query::field::tags;
+        }
+        else if (current.name == "title")
+        {
+            result.in = Query::field::title;
+        }
+        else if (current.name == "description")
+        {
+            result.in = Query::field::description;
+        }
+        else if (current.name == "fulltext")
+        {
+            result.in = Query::field::fulltext;
+        }
+        else
+        {
+            result.in = Query::field::uri;
+        }
+
+        return result;
+    }
+};
+
+void collect_terms(const Query::node &node, vector<string> &terms)
+{
+    if (node.type == kind::negation)
+    {
+        return;
+    }
+    for (const string &term : node.terms)
+    {
+        if (std::find(terms.begin(), terms.end(), term) == terms.end())
+        {
+            terms.push_back(term);
+        }
+    }
+    for (const Query::node &child : node.children)
+    {
+        collect_terms(child, terms);
+    }
+}
+
+void normalize(const Query::node &node, string &out)
+{
+    constexpr std::array<string_view, 7> kinds{
+        {"text", "", "after", "before", "and", "or", "not"}};
+    constexpr std::array<string_view, 5> fields{
+        {"tag", "title", "description", "fulltext", "uri"}};
+
+    out += node.type == kind::field_term
+        ? fields[static_cast<size_t>(node.in)]
+        : kinds[static_cast<size_t>(node.type)];
+    out += '(';
+    for (const string &term : node.terms)
+    {
+        out += '"';
+        for (const char c : term)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+    if (node.type == kind::after || node.type == kind::before)
+    {
+        out += std::to_string(node.time.time_since_epoch().count());
+    }
+    for (const Query::node &child : node.children)
+    {
+        normalize(child, out);
+    }
+    out += ')';
+}
+
+//! The similar words of term in words, term first.
+vector<string> similar(const Dictionary &words, const string &term)
+{
+    constexpr size_t max_similar = 16;
+    const size_t max_distance = term.size() < 3 ? 0
+        : term.size() < 6 ? 1 : 2;
+    vector<string> variants{term};
+    if (max_distance == 0)
+    {
+        return variants;
+    }
+
+    for (string &word : words.find(term, max_distance))
+    {
+        if (variants.size() == max_similar)
+        {
+            break;
+        }
+        if (word != term)
+        {
+            variants.push_back(move(word));
+        }
+    }
+
+    return variants;
+}
+
+Query::node make_fuzzy(const Query::node &node, const Dictionary &words)
+{
+    if (node.type != kind::text && node.type != kind::field_term)
+    {
+        Query::node result = node;
+        for (Query::node &child : result.children)
+        {
+            child = make_fuzzy(child, words);
+        }
+        return result;
+    }
+
+    // Every term becomes one of its variants.
+    Query::node result;
+    result.type = kind::all_of;
+    bool changed = false;
+    for (const string &term : node.terms)
+    {
+        Query::node any;
+        any.type = kind::any_of;
+        for (string &variant : similar(words, term))
+        {
+            Query::node single = node;
+            single.terms = {move(variant)};
+            any.children.push_back(move(single));
+        }
+        changed = changed || any.children.size() > 1;
+        result.children.push_back(any.children.size() == 1
+                                  ? move(any.children.front()) : move(any));
+    }
+    if (!changed)
+    {   // Terms in the same field stay in the same field.
+        return node;
+    }
+
+    if (result.children.size() == 1)
+    {
+        return move(result.children.front());
+    }
+    return result;
+}
+
+bool only_tags(const Query::node &node)
+{
+    switch (node.type)
+    {
+    case kind::text:
+    {
+        return true;
+    }
+    case kind::field_term:
+    {
+        return node.in == Query::field::tags;
+    }
+    case kind::all_of:
+    case kind::any_of:
+    {
+        return std::all_of(node.children.begin(), node.children.end(),
+                           [](const Query::node &child)
+                           {
+                               return only_tags(child);
+                           });
+    }
+    default:
+    {
+        return false;
+    }
+    }
+}
+} // namespace
+
+Query::Query(const string &expression, const bool is_re)
+    : _root{parser(expression, is_re).parse()}
+    , _is_re{is_re}
+{}
+
+const Query::node &Query::root() const
+{
+    return _root;
+}
+
+bool Query::is_re() const
+{
+    return _is_re;
+}
+
+vector<string> Query::terms() const
+{
+    vector<string> terms;
+    collect_terms(_root, terms);
+
+    return terms;
+}
+
+bool Query::only_tags() const
+{
+    return remwharead::only_tags(_root);
+}
+
+Query Query::fuzzy(const Dictionary &words) const
+{
+    Query result = *this;
+    if (!_is_re)
+    {
+        result._root = make_fuzzy(_root, words);
+    }
+
+    return result;
+}
+
+string Query::normalized() const
+{
+    string text = _is_re ? "re:" : "";
+    normalize(_root, text);
+
+    return text;
+}
+} // namespace remwharead
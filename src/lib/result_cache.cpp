@@ -0,0 +1,129 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "result_cache.hpp"
+#include <iterator>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+namespace remwharead
+{
+using lock_guard = std::lock_guard<std::mutex>;
+
+namespace
+{
+//! The size of the text in the table, roughly.
+size_t text_size(const EntryTable &entries)
+{
+    size_t bytes = 0;
+    for (const EntryTable::row row : entries)
+    {
+        bytes += row.uri().size() + row.archive_uri().size()
+            + row.title().size() + row.description().size()
+            + row.fulltext().size();
+        for (const std::string_view tag : row.tags())
+        {
+            bytes += tag.size();
+        }
+    }
+
+    return bytes;
+}
+} // namespace
+
+ResultCache::ResultCache(const size_t max_bytes)
+    : _max_bytes{max_bytes}
+    , _bytes{0}
+{}
+
+std::shared_ptr<const EntryTable>
+ResultCache::find(const string &key, const Database::revision &revision,
+                  bool *archive_outdated)
+{
+    const lock_guard lock(_mutex);
+    const auto it = _index.find(key);
+    if (it == _index.end())
+    {
+        return nullptr;
+    }
+    const Database::revision &stored = it->second->revision;
+    if (!stored.same_entries(revision)
+        || (stored.archived != revision.archived
+            && archive_outdated == nullptr))
+    {   // The database has changed.
+        erase(it->second);
+        return nullptr;
+    }
+    if (archive_outdated != nullptr)
+    {
+        *archive_outdated = (stored.archived != revision.archived);
+    }
+
+    _results.splice(_results.begin(), _results, it->second);
+    return _results.front().entries;
+}
+
+std::shared_ptr<const EntryTable>
+ResultCache::insert(const string &key, const Database::revision &revision,
+                    const EntryTable &entries)
+{
+    // Copy outside of the lock, into memory that lives as long as needed.
+    auto copy = std::make_shared<EntryTable>(
+        std::pmr::get_default_resource());
+    copy->reserve(entries.size());
+    for (const EntryTable::row row : entries)
+    {
+        copy->push_back(row);
+    }
+    const size_t bytes = text_size(*copy);
+    std::shared_ptr<const EntryTable> result = std::move(copy);
+
+    const lock_guard lock(_mutex);
+    const auto it = _index.find(key);
+    if (it != _index.end())
+    {
+        erase(it->second);
+    }
+    if (bytes > _max_bytes)
+    {
+        return result;
+    }
+
+    while (_bytes + bytes > _max_bytes)
+    {
+        erase(std::prev(_results.end()));
+    }
+    _results.push_front({key, revision, result, bytes});
+    _index.emplace(key, _results.begin());
+    _bytes += bytes;
+
+    return result;
+}
+
+size_t ResultCache::size() const
+{
+    const lock_guard lock(_mutex);
+    return _results.size();
+}
+
+void ResultCache::erase(const std::list<cached>::iterator it)
+{
+    _bytes -= it->bytes;
+    _index.erase(it->key);
+    _results.erase(it);
+}
+} // namespace remwharead
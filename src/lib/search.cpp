@@ -15,198 +15,504 @@
  */
 
 #include "search.hpp"
+#include "term_matcher.hpp"
 #include <Poco/RegularExpression.h>
-#include <Poco/UTF8String.h>
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
 #include <iterator>
 #include <list>
 #include <locale>
+#include <optional>
+#include <queue>
+#include <stdexcept>
 #include <thread>
 #include <utility>
 
 namespace remwharead
 {
 using std::list;
-using std::find;
 using std::find_if;
 using std::thread;
 using std::move;
 using RegEx = Poco::RegularExpression;
 
-Search::Search(list<Database::entry> entries)
-    :_entries(move(entries))
-{}
+namespace
+{
+// Parameters of BM25, see <https://en.wikipedia.org/wiki/Okapi_BM25>.
+constexpr double k1 = 1.2;
+constexpr double b = 0.75;
+
+//! The fields that are scored by rank_all().
+enum scored_field : size_t
+{
+    tags,
+    title,
+    description,
+    fulltext
+};
+constexpr size_t n_scored = 4;
+constexpr std::array<double, n_scored> weights{{2.0, 3.0, 1.5, 1.0}};
+
+using kind = Query::node::kind;
+
+//! The text fields that plain terms are searched in, besides the tags.
+const vector<Query::field> text_fields{
+    Query::field::title, Query::field::description, Query::field::fulltext};
+
+//! Returns true if the table has a lowercase copy of the field.
+bool has_folded(const EntryTable &entries, const Query::field f)
+{
+    return entries.has_folded() && f != Query::field::uri;
+}
+
+//! Returns a text field of a row, the lowercase copy if folded is true.
+string_view field_text(const EntryTable::row &row, const Query::field f,
+                       const bool folded)
+{
+    switch (f)
+    {
+    case Query::field::title:
+    {
+        return folded ? row.folded_title() : row.title();
+    }
+    case Query::field::description:
+    {
+        return folded ? row.folded_description() : row.description();
+    }
+    case Query::field::fulltext:
+    {
+        return folded ? row.folded_fulltext() : row.fulltext();
+    }
+    case Query::field::uri:
+    {
+        return row.uri();
+    }
+    case Query::field::tags:
+    {
+        break;
+    }
+    }
 
-vector<vector<string>> Search::parse_expression(const string &expression)
+    return {};
+}
+
+//! Returns true if all terms were found. Empty terms are always found.
+template <typename Found>
+bool all_found(const vector<string> &terms, Found found)
 {
-    vector<vector<string>> searchlist;
-    const RegEx re_or("(.+?) (OR|\\|\\|) ");
-    const RegEx re_and("(.+?) (AND|&&) ");
-    RegEx::MatchVec matches;
-    string::size_type pos = 0;
-
-    vector<string> subexpressions;
-    {                           // Split expression at OR.
-        while (re_or.match(expression, pos, matches) != 0)
+    for (size_t t = 0; t < terms.size(); ++t)
+    {
+        if (!terms[t].empty() && !found(t))
         {
-            const string &subexpr = expression.substr(matches[1].offset,
-                                                      matches[1].length);
-            subexpressions.push_back(subexpr);
-            pos = matches[0].offset + matches[0].length;
+            return false;
         }
-        subexpressions.push_back(expression.substr(pos));
     }
 
-    {
-        for (const string &sub : subexpressions)
-        {                       // Split each OR-slice at AND.
-            vector<string> terms;
-            pos = 0;
+    return true;
+}
+
+/*!
+ *  Returns the candidates that have all terms in one of the fields.
+ */
+Bitmap find_in_fields(const EntryTable &entries, const vector<string> &terms,
+                      const vector<Query::field> &fields, const bool is_re,
+                      const Bitmap &candidates, const TrigramIndex &trigrams)
+{
+    Bitmap result;
+    if (!is_re)
+    {   // Find all terms in one pass over each field.
+        const TermMatcher matcher(terms);
+        vector<bool> found;
+        for (const size_t index : candidates.indices())
+        {
+            const EntryTable::row row = entries[index];
+            for (const Query::field f : fields)
+            {
+                const bool folded = has_folded(entries, f);
+                matcher.find(field_text(row, f, folded), found, folded);
+                if (all_found(terms,
+                              [&found](const size_t t) { return found[t]; }))
+                {
+                    result.set(index);
+                    break;
+                }
+            }
+        }
+
+        return result;
+    }
 
-            while (re_and.match(sub, pos, matches) != 0)
+    // Only rows with the trigrams of every term can match.
+    Bitmap possible = candidates;
+    std::deque<RegEx> regexes;
+    for (const string &term : terms)
+    {
+        regexes.emplace_back(term);
+        possible = trigrams.narrow(possible, term);
+    }
+    for (const size_t index : possible.indices())
+    {
+        const EntryTable::row row = entries[index];
+        for (const Query::field f : fields)
+        {
+            // Snapshots have lowercase copies of the fields.
+            const bool folded = has_folded(entries, f);
+            const string_view text = field_text(row, f, folded);
+            const string lowercase = folded ? string(text) : fold_case(text);
+            if (all_found(terms,
+                          [&](const size_t t)
+                          {
+                              return regexes[t] == lowercase;
+                          }))
             {
-                const string &term = sub.substr(matches[1].offset,
-                                                matches[1].length);
-                terms.push_back(to_lowercase(term));
-                pos = matches[0].offset + matches[0].length;
+                result.set(index);
+                break;
             }
-            terms.push_back(to_lowercase(sub.substr(pos)));
-            searchlist.push_back(terms);
         }
     }
 
-    return searchlist;
+    return result;
+}
+
+/*!
+ *  Rough cost of evaluating a node for one row.
+ *
+ *  Tags are looked up in the tag index, dates are compared quickly and text
+ *  fields have to be searched, long ones take longer.
+ */
+unsigned cost(const Query::node &node, const bool in_tags)
+{
+    switch (node.type)
+    {
+    case kind::text:
+    {
+        return in_tags ? 0 : 3;
+    }
+    case kind::field_term:
+    {
+        switch (node.in)
+        {
+        case Query::field::tags:
+        {
+            return 0;
+        }
+        case Query::field::fulltext:
+        {
+            return 3;
+        }
+        default:
+        {
+            return 2;
+        }
+        }
+    }
+    case kind::after:
+    case kind::before:
+    {
+        return 1;
+    }
+    default:
+    {
+        unsigned highest = 0;
+        for (const Query::node &child : node.children)
+        {
+            highest = std::max(highest, cost(child, in_tags));
+        }
+        return highest;
+    }
+    }
 }
 
-string Search::to_lowercase(const string &str)
+//! The children of node, the cheapest first.
+vector<const Query::node *> by_cost(const Query::node &node,
+                                    const bool in_tags)
 {
-    return Poco::UTF8::toLower(str);
+    vector<const Query::node *> children;
+    for (const Query::node &child : node.children)
+    {
+        children.push_back(&child);
+    }
+    std::stable_sort(children.begin(), children.end(),
+                     [in_tags](const Query::node *a, const Query::node *b)
+                     {
+                         return cost(*a, in_tags) < cost(*b, in_tags);
+                     });
+
+    return children;
 }
 
-list<Database::entry> Search::search_tags(const string &expression,
-                                          const bool is_re) const
+//! Throw invalid regular expressions here, not in threads.
+void check_regexes(const Query::node &node)
+{
+    for (const string &term : node.terms)
+    {
+        const RegEx re(term);
+    }
+    for (const Query::node &child : node.children)
+    {
+        check_regexes(child);
+    }
+}
+} // namespace
+
+struct Search::term_counts
+{
+    //! Indices of the matching rows.
+    vector<size_t> rows;
+    //! Occurrences of every term in every field, for every matching row.
+    vector<unsigned> counts;
+    //! Number of rows that contain every term, matching or not.
+    vector<size_t> document_frequency;
+    //! Sum of the lengths of every field.
+    std::array<double, n_scored> total_length{};
+};
+
+Search::Search(const list<Database::entry> &entries)
+    : _entries(entries)
+    , _tag_index(_entries)
+{}
+
+Search::Search(EntryTable entries)
+    : _entries(move(entries))
+    , _tag_index(_entries)
+{}
+
+Search::Search(EntryTable entries, TrigramIndex trigrams)
+    : _entries(move(entries))
+    , _tag_index(_entries)
+    , _trigrams(move(trigrams))
 {
-    vector<vector<string>> searchlist = parse_expression(expression);
-    list<Database::entry> result;
+    check_trigrams();
+}
 
-    for (const vector<string> &tags_or : searchlist)
+Search::Search(EntryTable entries, TrigramIndex trigrams, Dictionary words)
+    : _entries(move(entries))
+    , _tag_index(_entries)
+    , _trigrams(move(trigrams))
+    , _words(move(words))
+{
+    check_trigrams();
+}
+
+void Search::check_trigrams() const
+{
+    if (_trigrams.size() != _entries.size())
     {
-        for (const Database::entry &entry : _entries)
-        {               // Add entry to result if all tags in an OR-slice match.
-            bool matched = true;
+        throw std::invalid_argument("The trigrams are not of the entries.");
+    }
+}
 
-            for (const string &tag : tags_or)
+string Search::to_lowercase(const string_view str)
+{
+    return fold_case(str);
+}
+
+const EntryTable &Search::entries() const
+{
+    return _entries;
+}
+
+Bitmap Search::match_tags(const TagIndex &index, const Query::node &node,
+                          const bool is_re)
+{
+    switch (node.type)
+    {
+    case kind::text:
+    {
+        return index.match(node.terms, is_re);
+    }
+    case kind::field_term:
+    {
+        if (node.in == Query::field::tags)
+        {
+            return index.match(node.terms, is_re);
+        }
+        break;
+    }
+    case kind::all_of:
+    {
+        Bitmap result;
+        for (size_t i = 0; i < node.children.size(); ++i)
+        {
+            if (i == 0)
             {
-                const auto it = find_if(
-                    entry.tags.begin(), entry.tags.end(),
-                    [&, is_re](string s)
-                    {
-                        s = to_lowercase(s);
-                        if (is_re)
-                        {
-                            const RegEx re("^" + tag + "$");
-                            return (re == s);
-                        }
-
-                        return (s == tag);
-                    });
-                if (it == entry.tags.end())
-                {
-                    matched = false;
-                }
+                result = match_tags(index, node.children[i], is_re);
             }
-            if (matched)
+            else
             {
-                result.push_back(entry);
+                result &= match_tags(index, node.children[i], is_re);
             }
         }
+        return result;
+    }
+    case kind::any_of:
+    {
+        Bitmap result;
+        for (const Query::node &child : node.children)
+        {
+            result |= match_tags(index, child, is_re);
+        }
+        return result;
+    }
+    default:
+    {
+        break;
+    }
     }
 
-    return result;
+    throw std::invalid_argument("Only tags can be searched in a tag index.");
 }
 
-list<Database::entry> Search::search_all(const string &expression,
-                                         const bool is_re) const
+Bitmap Search::find_tags(const TagIndex &index, const string &expression,
+                         const bool is_re, const bool fuzzy)
+{
+    Query query(expression, is_re);
+    if (fuzzy)
+    {
+        query = query.fuzzy(tag_dictionary(index));
+    }
+
+    return match_tags(index, query.root(), is_re);
+}
+
+vector<size_t> Search::find_tags(const string &expression, const bool is_re,
+                                 const bool fuzzy) const
+{
+    return evaluate(parse(expression, is_re, fuzzy, true), 0,
+                    _entries.size(), true).indices();
+}
+
+vector<size_t> Search::find_all(const string &expression, const bool is_re,
+                                const bool fuzzy) const
 {
-    vector<vector<string>> searchlist = parse_expression(expression);
-    list<Database::entry> result = search_tags(expression, is_re);
+    return evaluate(parse(expression, is_re, fuzzy, false), 0,
+                    _entries.size(), false).indices();
+}
 
-    for (const vector<string> &terms_or : searchlist)
+Query Search::parse(const string &expression, const bool is_re,
+                    const bool fuzzy, const bool in_tags) const
+{
+    const Query query(expression, is_re);
+    if (!fuzzy || is_re)
     {
-        for (const Database::entry &entry : _entries)
-        {
-            // Add entry to result if all terms in an OR-slice match title,
-            // description or full text.
-            bool matched_title = true;
-            bool matched_description = true;
-            bool matched_fulltext = true;
-
-            const auto it = find(result.begin(), result.end(), entry);
-            if (it != result.end())
-            {                   // Skip if already in result list.
-                continue;
-            }
+        return query;
+    }
+    if (in_tags)
+    {
+        return query.fuzzy(tag_dictionary(_tag_index));
+    }
 
-            for (const string &term : terms_or)
-            {
-                const string title = to_lowercase(entry.title);
-                const string description = to_lowercase(entry.description);
-                const string fulltext = to_lowercase(entry.fulltext);
+    return query.fuzzy(_words ? *_words : Dictionary(_entries));
+}
 
-                // Set matched_* to false if term is not found.
-                if (is_re)
-                {
-                    const RegEx re(term);
+Dictionary Search::tag_dictionary(const TagIndex &index)
+{
+    vector<string> tags;
+    tags.reserve(index.tags().size());
+    for (const auto &tag : index.tags())
+    {
+        tags.push_back(fold_case(tag.first));
+    }
 
-                    if (!(re == title))
-                    {
-                        matched_title = false;
-                    }
+    return Dictionary(move(tags));
+}
 
-                    if (!(re == description))
-                    {
-                        matched_description = false;
-                    }
+Bitmap Search::evaluate(const Query &query, const size_t first,
+                        const size_t last, const bool in_tags) const
+{
+    Bitmap candidates;
+    candidates.set(first, last);
 
-                    if (!(re == fulltext))
-                    {
-                        matched_fulltext = false;
-                    }
-                }
-                else
-                {
-                    if (title.find(term) == string::npos)
-                    {
-                        matched_title = false;
-                    }
+    return evaluate(query.root(), query.is_re(), std::move(candidates),
+                    in_tags);
+}
 
-                    if (description.find(term) == string::npos)
-                    {
-                        matched_description = false;
-                    }
+Bitmap Search::evaluate(const Query::node &node, const bool is_re,
+                        Bitmap candidates, const bool in_tags) const
+{
+    if (candidates.none())
+    {
+        return candidates;
+    }
 
-                    if (fulltext.find(term) == string::npos)
-                    {
-                        matched_fulltext = false;
-                    }
-                }
+    switch (node.type)
+    {
+    case kind::text:
+    {
+        Bitmap result = match_tags(_tag_index, node, is_re);
+        result &= candidates;
+        if (!in_tags)
+        {   // The rest has to be searched.
+            candidates -= result;
+            result |= find_in_fields(_entries, node.terms, text_fields, is_re,
+                                     candidates, _trigrams);
+        }
+        return result;
+    }
+    case kind::field_term:
+    {
+        if (node.in == Query::field::tags)
+        {
+            Bitmap result = match_tags(_tag_index, node, is_re);
+            result &= candidates;
+            return result;
+        }
+        return find_in_fields(_entries, node.terms, {node.in}, is_re,
+                              candidates, _trigrams);
+    }
+    case kind::after:
+    case kind::before:
+    {
+        Bitmap result;
+        for (const size_t index : candidates.indices())
+        {
+            const bool after = _entries[index].datetime() >= node.time;
+            if (after == (node.type == kind::after))
+            {
+                result.set(index);
             }
-            if (matched_title || matched_description || matched_fulltext)
+        }
+        return result;
+    }
+    case kind::all_of:
+    {   // Every child only looks at the rows the cheaper ones left.
+        for (const Query::node *child : by_cost(node, in_tags))
+        {
+            candidates = evaluate(*child, is_re, std::move(candidates),
+                                  in_tags);
+            if (candidates.none())
             {
-                result.push_back(entry);
+                break;
             }
         }
+        return candidates;
+    }
+    case kind::any_of:
+    {   // Every child only looks at the rows that didn't match yet.
+        Bitmap result;
+        for (const Query::node *child : by_cost(node, in_tags))
+        {
+            Bitmap rest = candidates;
+            rest -= result;
+            result |= evaluate(*child, is_re, std::move(rest), in_tags);
+        }
+        return result;
+    }
+    case kind::negation:
+    {
+        candidates -= evaluate(node.children.front(), is_re, candidates,
+                               in_tags);
+        return candidates;
+    }
     }
 
-    return result;
+    return {};
 }
 
-list<Database::entry> Search::search_all_threaded(const string &expression,
-                                                  const bool is_re) const
+vector<size_t> Search::segments(const size_t len)
 {
-    list<Database::entry> entries = _entries;
-
-    const size_t len = entries.size();
     constexpr size_t min_len = 100;
     constexpr size_t min_per_thread = 50;
     const size_t n_threads = thread::hardware_concurrency() / 3 + 1;
@@ -222,47 +528,292 @@ list<Database::entry> Search::search_all_threaded(const string &expression,
         }
     }
 
-    list<list<Database::entry>> segments;
-
-    // Use threads if list is big.
-    while (entries.size() > cut_at)
+    vector<size_t> starts;
+    for (size_t start = 0; start < len; start += cut_at)
     {
-        list<Database::entry> segment;
+        starts.push_back(start);
+    }
+    starts.push_back(len);
 
-        auto it = entries.begin();
-        std::advance(it, cut_at);
+    return starts;
+}
 
-        // Move the first `cut_at` entries into `segments`.
-        segment.splice(segment.begin(), entries, entries.begin(), it);
-        segments.push_back(move(segment));
+vector<size_t> Search::find_all_threaded(const string &expression,
+                                         const bool is_re,
+                                         const bool fuzzy) const
+{
+    const Query query = parse(expression, is_re, fuzzy, false);
+    if (is_re)
+    {
+        check_regexes(query.root());
     }
-    // Move rest of `entries` into `segments`.
-    list<Database::entry> rest;
-    rest.splice(rest.begin(), entries);
-    segments.push_back(move(rest));
 
+    // Every thread searches a segment of the table.
+    const vector<size_t> starts = segments(_entries.size());
+    vector<Bitmap> results(starts.size() - 1);
     list<thread> threads;
-    for (auto &segment : segments)
+    for (size_t i = 0; i < results.size(); ++i)
     {
         thread t(
-            [&]
+            [&, i]
             {
-                Search search(segment);
-                // Replace `segment` with `result`.
-                segment = search.search_all(expression, is_re);
+                results[i] = evaluate(query, starts[i], starts[i + 1],
+                                      false);
             });
         threads.push_back(move(t));
     }
 
+    vector<size_t> result;
+    for (const Bitmap &segment : results)
+    {
+        threads.front().join();
+        threads.pop_front();
+        const vector<size_t> indices = segment.indices();
+        result.insert(result.end(), indices.begin(), indices.end());
+    }
+
+    return result;
+}
+
+void Search::count_terms(const Query &query, const vector<string> &terms,
+                         const size_t first, const size_t last,
+                         term_counts &result) const
+{
+    const bool is_re = query.is_re();
+    const Bitmap matches = evaluate(query, first, last, false);
+    std::deque<RegEx> regexes;
+    //! The rows that can contain each regular expression.
+    vector<Bitmap> possible;
+    std::optional<TermMatcher> matcher;
+    if (is_re)
+    {
+        Bitmap segment;
+        segment.set(first, last);
+        for (const string &term : terms)
+        {
+            regexes.emplace_back(term);
+            possible.push_back(_trigrams.narrow(segment, term));
+        }
+    }
+    else
+    {
+        matcher.emplace(terms);
+    }
+
+    result.document_frequency.assign(terms.size(), 0);
+    vector<unsigned> counts(terms.size() * n_scored);
+    vector<unsigned> in_text;
+    vector<string> tag_names;
+    std::array<string, n_scored> lowercase;
+    const bool folded = _entries.has_folded();
+    for (size_t index = first; index < last; ++index)
+    {
+        const EntryTable::row row = _entries[index];
+        tag_names.clear();
+        for (const string_view tag : row.tags())
+        {
+            tag_names.push_back(to_lowercase(tag));
+        }
+        const std::array<string_view, n_scored> texts{
+            {{}, row.title(), row.description(), row.fulltext()}};
+        // Snapshots have lowercase copies of the fields.
+        const std::array<string_view, n_scored> folded_texts
+            = folded ? std::array<string_view, n_scored>{
+                {{}, row.folded_title(), row.folded_description(),
+                 row.folded_fulltext()}}
+            : texts;
+        const bool search_texts = std::any_of(
+            possible.begin(), possible.end(),
+            [index](const Bitmap &rows) { return rows.test(index); });
+
+        result.total_length[tags] += static_cast<double>(tag_names.size());
+        for (size_t f = title; f < n_scored; ++f)
+        {
+            result.total_length[f] += static_cast<double>(texts[f].size());
+            if (is_re)
+            {   // Rows the trigram index excludes are not counted.
+                if (search_texts)
+                {
+                    lowercase[f] = folded ? string(folded_texts[f])
+                        : to_lowercase(texts[f]);
+                }
+            }
+            else
+            {   // Count all terms in one pass.
+                matcher->count(folded_texts[f], in_text, folded);
+                for (size_t t = 0; t < terms.size(); ++t)
+                {
+                    counts[t * n_scored + f] = in_text[t];
+                }
+            }
+        }
+
+        for (size_t t = 0; t < terms.size(); ++t)
+        {
+            unsigned *in_fields = &counts[t * n_scored];
+            in_fields[tags] = static_cast<unsigned>(std::count_if(
+                tag_names.begin(), tag_names.end(),
+                [&](const string &tag)
+                {
+                    return is_re ? regexes[t] == tag : tag == terms[t];
+                }));
+            for (size_t f = title; f < n_scored && is_re; ++f)
+            {
+                in_fields[f] = possible[t].test(index)
+                    && regexes[t] == lowercase[f] ? 1 : 0;
+            }
+            if (std::any_of(in_fields, in_fields + n_scored,
+                            [](const unsigned n) { return n != 0; }))
+            {
+                ++result.document_frequency[t];
+            }
+        }
+
+        if (matches.test(index))
+        {
+            result.rows.push_back(index);
+            result.counts.insert(result.counts.end(), counts.begin(),
+                                 counts.end());
+        }
+    }
+}
+
+vector<Search::ranked> Search::rank_all(const string &expression,
+                                        const bool is_re,
+                                        const size_t limit,
+                                        const bool fuzzy) const
+{
+    const Query query = parse(expression, is_re, fuzzy, false);
+    const vector<string> terms = query.terms();
+    if (is_re)
+    {
+        check_regexes(query.root());
+    }
+
+    const vector<size_t> starts = segments(_entries.size());
+    vector<term_counts> counted(starts.size() - 1);
+    list<thread> threads;
+    for (size_t i = 0; i < counted.size(); ++i)
+    {
+        thread t(
+            [&, i]
+            {
+                count_terms(query, terms, starts[i], starts[i + 1],
+                            counted[i]);
+            });
+        threads.push_back(move(t));
+    }
     for (thread &t : threads)
     {
         t.join();
-        // Move each of `segments` into `entries`.
-        entries.splice(entries.end(), segments.front());
-        segments.pop_front();
     }
+    if (_entries.empty())
+    {
+        return {};
+    }
+
+    // The statistics are about all entries, not only the matching ones.
+    const auto n_entries = static_cast<double>(_entries.size());
+    vector<double> idf(terms.size(), 0.0);
+    std::array<double, n_scored> average_length{};
+    for (const term_counts &segment : counted)
+    {
+        for (size_t t = 0; t < terms.size(); ++t)
+        {
+            idf[t] += static_cast<double>(segment.document_frequency[t]);
+        }
+        for (size_t f = 0; f < n_scored; ++f)
+        {
+            average_length[f] += segment.total_length[f] / n_entries;
+        }
+    }
+    for (double &value : idf)
+    {   // value is the document frequency until here.
+        value = std::log(1.0 + (n_entries - value + 0.5) / (value + 0.5));
+    }
+
+    // The worst of the best results is on top.
+    const auto better = [](const ranked &a, const ranked &b)
+    {
+        if (a.score != b.score)
+        {
+            return a.score > b.score;
+        }
+        return a.index < b.index;
+    };
+    std::priority_queue<ranked, vector<ranked>, decltype(better)>
+        best(better);
+
+    for (const term_counts &segment : counted)
+    {
+        for (size_t i = 0; i < segment.rows.size(); ++i)
+        {
+            const EntryTable::row row = _entries[segment.rows[i]];
+            const std::array<double, n_scored> length{
+                {static_cast<double>(row.tags().size()),
+                 static_cast<double>(row.title().size()),
+                 static_cast<double>(row.description().size()),
+                 static_cast<double>(row.fulltext().size())}};
+            const unsigned *counts
+                = &segment.counts[i * terms.size() * n_scored];
+
+            double score = 0.0;
+            for (size_t t = 0; t < terms.size(); ++t)
+            {
+                double frequency = 0.0;
+                for (size_t f = 0; f < n_scored; ++f)
+                {
+                    const unsigned n = counts[t * n_scored + f];
+                    if (n == 0)
+                    {
+                        continue;
+                    }
+                    const double norm = average_length[f] > 0.0
+                        ? 1.0 - b + b * length[f] / average_length[f]
+                        : 1.0;
+                    frequency += weights[f] * n / norm;
+                }
+                score += idf[t] * frequency * (k1 + 1.0) / (frequency + k1);
+            }
+
+            const ranked result{segment.rows[i], score};
+            if (limit == 0 || best.size() < limit)
+            {
+                best.push(result);
+            }
+            else if (better(result, best.top()))
+            {
+                best.pop();
+                best.push(result);
+            }
+        }
+    }
+
+    vector<ranked> results(best.size());
+    for (auto it = results.rbegin(); it != results.rend(); ++it)
+    {
+        *it = best.top();
+        best.pop();
+    }
+
+    return results;
+}
+
+list<Database::entry> Search::search_tags(const string &expression,
+                                          const bool is_re) const
+{
+    return _entries.select(find_tags(expression, is_re)).to_list();
+}
 
-    return entries;
+list<Database::entry> Search::search_all(const string &expression,
+                                         const bool is_re) const
+{
+    return _entries.select(find_all(expression, is_re)).to_list();
+}
 
+list<Database::entry> Search::search_all_threaded(const string &expression,
+                                                  const bool is_re) const
+{
+    return _entries.select(find_all_threaded(expression, is_re)).to_list();
 }
 } // namespace remwharead
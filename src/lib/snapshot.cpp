@@ -0,0 +1,757 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.hpp"
+#include "term_matcher.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace remwharead
+{
+using std::int64_t;
+using std::string;
+using std::string_view;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace
+{
+constexpr std::array<char, 8> magic{'R', 'W', 'R', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t format_version = 5;
+constexpr uint32_t byte_order = 0x01020304;
+constexpr size_t n_fields = 5;
+constexpr size_t n_folded = 3;
+//! The first field with a lowercase copy, the others follow.
+constexpr size_t first_folded = 2;
+
+/*!
+ *  The file starts with the header, followed by these sections, each padded
+ *  to 8 bytes:
+ *
+ *  - The offsets into every column, rows + 1 uint64_t per column.
+ *  - The date and time of every row, int64_t nanoseconds since the epoch.
+ *  - The offsets into the tag ids, rows + 1 uint64_t.
+ *  - The tag ids of all rows, tags_total uint32_t.
+ *  - The offsets into the tag names, n_tags + 1 uint64_t.
+ *  - The tag ids sorted by name, n_tags uint32_t.
+ *  - The offsets into every lowercase column, rows + 1 uint64_t per column.
+ *  - The sorted trigrams, n_trigrams uint32_t.
+ *  - The offsets into the rows of the trigrams, n_trigrams + 1 uint64_t.
+ *  - The offsets into the words, n_words + 1 uint64_t.
+ *  - The columns.
+ *  - The lowercase copies of title, description and full text.
+ *  - The tag names.
+ *  - The sorted words of the entries.
+ *  - The rows of the trigrams.
+ */
+struct header
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t modifications;
+    uint64_t last_row;
+    uint64_t archived;
+    uint64_t rows;
+    uint64_t n_tags;
+    uint64_t tags_total;
+    std::array<uint64_t, n_fields> column_sizes;
+    std::array<uint64_t, n_folded> folded_sizes;
+    uint64_t tag_names_size;
+    uint64_t n_trigrams;
+    uint64_t trigram_rows_size;
+    uint64_t n_words;
+    uint64_t words_size;
+};
+static_assert(sizeof(header) % 8 == 0, "Sections must stay aligned.");
+
+//! The position of every section in the file.
+struct layout
+{
+    std::array<size_t, n_fields> offsets;
+    size_t datetimes;
+    size_t tag_offsets;
+    size_t tags;
+    size_t tag_name_offsets;
+    size_t tags_by_name;
+    std::array<size_t, n_folded> folded_offsets;
+    size_t trigrams;
+    size_t trigram_offsets;
+    size_t word_offsets;
+    std::array<size_t, n_fields> columns;
+    std::array<size_t, n_folded> folded;
+    size_t tag_names;
+    size_t words;
+    size_t trigram_rows;
+    size_t total;
+
+    explicit layout(const header &head)
+    {
+        size_t pos = sizeof(header);
+        const auto section = [&pos](const size_t bytes)
+        {
+            const size_t start = pos;
+            pos += (bytes + 7) / 8 * 8;
+            return start;
+        };
+
+        for (size_t &offset : offsets)
+        {
+            offset = section((head.rows + 1) * sizeof(uint64_t));
+        }
+        datetimes = section(head.rows * sizeof(int64_t));
+        tag_offsets = section((head.rows + 1) * sizeof(uint64_t));
+        tags = section(head.tags_total * sizeof(uint32_t));
+        tag_name_offsets = section((head.n_tags + 1) * sizeof(uint64_t));
+        tags_by_name = section(head.n_tags * sizeof(uint32_t));
+        for (size_t &offset : folded_offsets)
+        {
+            offset = section((head.rows + 1) * sizeof(uint64_t));
+        }
+        trigrams = section(head.n_trigrams * sizeof(uint32_t));
+        trigram_offsets = section((head.n_trigrams + 1) * sizeof(uint64_t));
+        word_offsets = section((head.n_words + 1) * sizeof(uint64_t));
+        for (size_t f = 0; f < n_fields; ++f)
+        {
+            columns[f] = section(head.column_sizes[f]);
+        }
+        for (size_t f = 0; f < n_folded; ++f)
+        {
+            folded[f] = section(head.folded_sizes[f]);
+        }
+        tag_names = section(head.tag_names_size);
+        words = section(head.words_size);
+        trigram_rows = section(head.trigram_rows_size);
+        total = pos;
+    }
+};
+
+//! Writes a file and keeps track of the position.
+class writer
+{
+public:
+    explicit writer(const fs::path &path)
+        : _out(path, std::ios::binary | std::ios::trunc)
+        , _pos{0}
+    {
+        if (!_out.good())
+        {
+            throw std::runtime_error("Could not write snapshot: "
+                                     + path.string());
+        }
+    }
+
+    void put(const void *data, const size_t size)
+    {
+        _out.write(static_cast<const char *>(data),
+                   static_cast<std::streamsize>(size));
+        _pos += size;
+    }
+
+    template <typename T>
+    void put(const T value)
+    {
+        put(&value, sizeof(value));
+    }
+
+    //! Pad the section to 8 bytes.
+    void end_section()
+    {
+        constexpr std::array<char, 8> zeros{};
+        put(zeros.data(), (8 - _pos % 8) % 8);
+    }
+
+    void close()
+    {
+        _out.close();
+        if (_out.fail())
+        {
+            throw std::runtime_error("Could not write snapshot.");
+        }
+    }
+
+private:
+    std::ofstream _out;
+    size_t _pos;
+};
+
+//! Lowercase copies of the fields of a table that has none.
+struct folded_columns
+{
+    std::array<string, n_folded> text;
+    std::array<vector<size_t>, n_folded> offsets;
+};
+
+template <typename T>
+const T *at(const char *base, const size_t offset)
+{
+    return reinterpret_cast<const T *>(base + offset);
+}
+
+//! True if the n + 1 offsets start at 0, never decrease and end at size.
+bool valid_offsets(const uint64_t *offsets, const size_t n,
+                   const uint64_t size)
+{
+    if (offsets[0] != 0 || offsets[n] != size)
+    {
+        return false;
+    }
+
+    return std::is_sorted(offsets, offsets + n + 1);
+}
+
+//! True if all n ids are less than limit.
+bool valid_ids(const uint32_t *ids, const size_t n, const uint64_t limit)
+{
+    return std::all_of(ids, ids + n,
+                       [limit](const uint32_t id) { return id < limit; });
+}
+} // namespace
+
+Snapshot::Snapshot(const fs::path &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Could not open snapshot: " + path.string());
+    }
+    struct stat info{};
+    if (::fstat(fd, &info) != 0
+        || static_cast<size_t>(info.st_size) < sizeof(header))
+    {
+        ::close(fd);
+        throw std::runtime_error("Snapshot is damaged: " + path.string());
+    }
+    const auto size = static_cast<size_t>(info.st_size);
+    void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map snapshot: " + path.string());
+    }
+    const std::shared_ptr<const void> memory(
+        addr, [size](const void *p)
+        {
+            ::munmap(const_cast<void *>(p), size);
+        });
+
+    const char *base = static_cast<const char *>(addr);
+    header head{};
+    std::memcpy(&head, base, sizeof(head));
+    if (head.magic != magic || head.version != format_version
+        || head.byte_order != byte_order)
+    {
+        throw std::runtime_error("Not a snapshot of this version: "
+                                 + path.string());
+    }
+    // Check the counts first, so that the layout can't overflow.
+    bool plausible = head.rows < size && head.n_tags < size
+        && head.tags_total < size && head.tag_names_size < size
+        && head.n_trigrams < size && head.trigram_rows_size < size
+        && head.n_words < size && head.words_size < size;
+    for (const uint64_t column_size : head.column_sizes)
+    {
+        plausible = plausible && column_size < size;
+    }
+    for (const uint64_t folded_size : head.folded_sizes)
+    {
+        plausible = plausible && folded_size < size;
+    }
+    if (!plausible || layout(head).total != size)
+    {
+        throw std::runtime_error("Snapshot is damaged: " + path.string());
+    }
+
+    // Every offset and id is checked, so that nothing outside of the file
+    // is read later.
+    const layout sections(head);
+    auto mapped = std::make_shared<EntryTable::mapping>();
+    for (size_t f = 0; f < n_fields; ++f)
+    {
+        mapped->columns[f] = base + sections.columns[f];
+        mapped->offsets[f] = at<uint64_t>(base, sections.offsets[f]);
+        if (!valid_offsets(mapped->offsets[f], head.rows,
+                           head.column_sizes[f]))
+        {
+            throw std::runtime_error("Snapshot is damaged: " + path.string());
+        }
+    }
+    for (size_t f = 0; f < n_folded; ++f)
+    {
+        mapped->folded[f] = base + sections.folded[f];
+        mapped->folded_offsets[f] = at<uint64_t>(base,
+                                                 sections.folded_offsets[f]);
+        if (!valid_offsets(mapped->folded_offsets[f], head.rows,
+                           head.folded_sizes[f]))
+        {
+            throw std::runtime_error("Snapshot is damaged: " + path.string());
+        }
+    }
+    mapped->datetimes = at<int64_t>(base, sections.datetimes);
+    mapped->tags = at<EntryTable::tag_id>(base, sections.tags);
+    mapped->tag_offsets = at<uint64_t>(base, sections.tag_offsets);
+    mapped->tag_names = base + sections.tag_names;
+    mapped->tag_name_offsets = at<uint64_t>(base, sections.tag_name_offsets);
+    mapped->tags_by_name = at<EntryTable::tag_id>(base,
+                                                  sections.tags_by_name);
+    mapped->rows = head.rows;
+    mapped->n_tags = head.n_tags;
+    mapped->memory = memory;
+    if (!valid_offsets(mapped->tag_offsets, head.rows, head.tags_total)
+        || !valid_offsets(mapped->tag_name_offsets, head.n_tags,
+                          head.tag_names_size)
+        || !valid_ids(mapped->tags, head.tags_total, head.n_tags)
+        || !valid_ids(mapped->tags_by_name, head.n_tags, head.n_tags))
+    {
+        throw std::runtime_error("Snapshot is damaged: " + path.string());
+    }
+
+    _entries._mapped = std::move(mapped);
+
+    _trigrams._rows = head.rows;
+    _trigrams._n_trigrams = head.n_trigrams;
+    _trigrams._trigrams = at<uint32_t>(base, sections.trigrams);
+    _trigrams._offsets = at<uint64_t>(base, sections.trigram_offsets);
+    _trigrams._postings = base + sections.trigram_rows;
+    _trigrams._memory = memory;
+    if (!valid_offsets(_trigrams._offsets, head.n_trigrams,
+                       head.trigram_rows_size))
+    {
+        throw std::runtime_error("Snapshot is damaged: " + path.string());
+    }
+
+    _words._size = head.n_words;
+    _words._offsets = at<uint64_t>(base, sections.word_offsets);
+    _words._text = base + sections.words;
+    _words._memory = memory;
+    if (!valid_offsets(_words._offsets, head.n_words, head.words_size))
+    {
+        throw std::runtime_error("Snapshot is damaged: " + path.string());
+    }
+
+    _revision = {head.modifications, head.last_row, head.archived};
+}
+
+const EntryTable &Snapshot::entries() const
+{
+    return _entries;
+}
+
+const TrigramIndex &Snapshot::trigrams() const
+{
+    return _trigrams;
+}
+
+const Dictionary &Snapshot::words() const
+{
+    return _words;
+}
+
+const Database::revision &Snapshot::revision() const
+{
+    return _revision;
+}
+
+void Snapshot::write(const fs::path &path, const EntryTable &entries,
+                     const Database::revision &revision)
+{
+    write(path, {&entries}, revision);
+}
+
+size_t Snapshot::update(const Database &db, std::mutex &db_mutex,
+                        const fs::path &path)
+{
+    // Threads of one process would write the same temporary file.
+    static std::mutex write_mutex;
+    const std::lock_guard<std::mutex> write_lock(write_mutex);
+
+    std::optional<Snapshot> old;
+    if (fs::exists(path))
+    {
+        try
+        {
+            old.emplace(path);
+        }
+        catch (const std::runtime_error &)
+        {}                      // Damaged or old format, build a new one.
+    }
+
+    Database::revision current;
+    bool append = false;
+    EntryTable added;
+    list<Database::entry> archived;
+    {
+        const std::lock_guard<std::mutex> lock(db_mutex);
+        current = db.current_revision();
+        if (old && old->revision() == current)
+        {
+            return 0;
+        }
+
+        // If entries were only added or archived, keep the old ones.
+        append = old && old->revision().modifications == current.modifications
+            && old->revision().last_row <= current.last_row;
+        if (append && old->revision().archived != current.archived)
+        {
+            archived = db.retrieve_archive_uris(old->revision().last_row);
+            append = (archived.size() == old->entries().size());
+        }
+        const uint64_t after = append ? old->revision().last_row : 0;
+        added = db.retrieve_rows(after, current.last_row);
+    }
+
+    if (append)
+    {
+        vector<string_view> archive_uris;
+        archive_uris.reserve(archived.size());
+        for (const Database::entry &entry : archived)
+        {
+            archive_uris.emplace_back(entry.archive_uri);
+        }
+        write(path, {&old->entries(), &added}, current, &*old,
+              archived.empty() ? nullptr : &archive_uris);
+    }
+    else
+    {
+        write(path, {&added}, current);
+    }
+
+    return added.size();
+}
+
+fs::path Snapshot::default_path(const Database &db)
+{
+    return db.path().parent_path() / "snapshot";
+}
+
+void Snapshot::write(const fs::path &path,
+                     const vector<const EntryTable *> &parts,
+                     const Database::revision &revision,
+                     const Snapshot *base,
+                     const vector<string_view> *archive_uris)
+{
+    using field = EntryTable::field;
+    using tag_id = EntryTable::tag_id;
+
+    const auto get_field = [&parts, archive_uris](const size_t p,
+                                                  const size_t f,
+                                                  const size_t i)
+    {
+        if (p == 0 && f == field::archive_uri && archive_uris != nullptr)
+        {
+            return (*archive_uris)[i];
+        }
+        return parts[p]->get(field(f), i);
+    };
+
+    header head{};
+    head.magic = magic;
+    head.version = format_version;
+    head.byte_order = byte_order;
+    head.modifications = revision.modifications;
+    head.last_row = revision.last_row;
+    head.archived = revision.archived;
+
+    // Merge the tags of the parts and translate their ids.
+    vector<string_view> tag_names;
+    std::unordered_map<string_view, tag_id> tag_ids;
+    vector<vector<tag_id>> translated(parts.size());
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        const EntryTable &part = *parts[p];
+        for (size_t id = 0; id < part.tag_count(); ++id)
+        {
+            const string_view name = part.tag_name(static_cast<tag_id>(id));
+            const auto inserted = tag_ids.emplace(
+                name, static_cast<tag_id>(tag_names.size()));
+            if (inserted.second)
+            {
+                tag_names.push_back(name);
+                head.tag_names_size += name.size();
+            }
+            translated[p].push_back(inserted.first->second);
+        }
+
+        head.rows += part.size();
+        for (size_t i = 0; i < part.size(); ++i)
+        {
+            for (size_t f = 0; f < n_fields; ++f)
+            {
+                head.column_sizes[f] += get_field(p, f, i).size();
+            }
+            head.tags_total += part.get_tags(i).size();
+        }
+    }
+    head.n_tags = tag_names.size();
+
+    // Tables from older snapshots have the lowercase copies already.
+    vector<folded_columns> folded(parts.size());
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        if (parts[p]->has_folded())
+        {
+            continue;
+        }
+        for (size_t f = 0; f < n_folded; ++f)
+        {
+            folded[p].offsets[f].reserve(parts[p]->size() + 1);
+            folded[p].offsets[f].push_back(0);
+            for (size_t i = 0; i < parts[p]->size(); ++i)
+            {
+                folded[p].text[f] += fold_case(
+                    parts[p]->get(field(first_folded + f), i));
+                folded[p].offsets[f].push_back(folded[p].text[f].size());
+            }
+        }
+    }
+    const auto get_folded = [&parts, &folded](const size_t p, const size_t f,
+                                              const size_t i)
+    {
+        if (parts[p]->has_folded())
+        {
+            return parts[p]->get_folded(field(first_folded + f), i);
+        }
+        const vector<size_t> &offsets = folded[p].offsets[f];
+        return string_view(folded[p].text[f]).substr(offsets[i],
+                                                     offsets[i + 1]
+                                                         - offsets[i]);
+    };
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        for (size_t f = 0; f < n_folded; ++f)
+        {
+            for (size_t i = 0; i < parts[p]->size(); ++i)
+            {
+                head.folded_sizes[f] += get_folded(p, f, i).size();
+            }
+        }
+    }
+
+    TrigramIndex::builder builder;
+    std::unordered_set<string> distinct_words;
+    const auto add_words = [&distinct_words](const string_view text)
+    {
+        for_each_word(text, [&distinct_words](const string_view word)
+        {
+            distinct_words.emplace(word);
+        });
+    };
+    // Only the rows that are not in base are indexed.
+    size_t first_new = 0;
+    if (base != nullptr)
+    {
+        builder.add(base->_trigrams);
+        for (size_t i = 0; i < base->_words.size(); ++i)
+        {
+            distinct_words.emplace(base->_words[i]);
+        }
+        first_new = 1;
+    }
+    for (size_t p = first_new; p < parts.size(); ++p)
+    {
+        for (size_t i = 0; i < parts[p]->size(); ++i)
+        {
+            const string uri = fold_case(parts[p]->get(field::uri, i));
+            builder.add({uri, get_folded(p, 0, i), get_folded(p, 1, i),
+                         get_folded(p, 2, i)});
+
+            add_words(uri);
+            for (const string_view tag : (*parts[p])[i].tags())
+            {
+                add_words(fold_case(tag));
+            }
+            for (size_t f = 0; f < n_folded; ++f)
+            {
+                add_words(get_folded(p, f, i));
+            }
+        }
+    }
+    const TrigramIndex trigrams = builder.finish();
+    head.n_trigrams = trigrams._n_trigrams;
+    head.trigram_rows_size = trigrams._offsets[trigrams._n_trigrams];
+    const Dictionary words(vector<string>(distinct_words.begin(),
+                                          distinct_words.end()));
+    distinct_words.clear();
+    head.n_words = words._size;
+    head.words_size = words._offsets[words._size];
+
+    fs::path tmppath = path;
+    tmppath += ".tmp" + std::to_string(::getpid());
+    writer out(tmppath);
+    try
+    {
+        out.put(head);
+
+        for (size_t f = 0; f < n_fields; ++f)
+        {
+            uint64_t offset = 0;
+            out.put(offset);
+            for (size_t p = 0; p < parts.size(); ++p)
+            {
+                for (size_t i = 0; i < parts[p]->size(); ++i)
+                {
+                    offset += get_field(p, f, i).size();
+                    out.put(offset);
+                }
+            }
+            out.end_section();
+        }
+
+        for (const EntryTable *part : parts)
+        {
+            for (const EntryTable::row row : *part)
+            {
+                const auto ns = std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(row.datetime()
+                                              .time_since_epoch());
+                out.put(static_cast<int64_t>(ns.count()));
+            }
+        }
+        out.end_section();
+
+        uint64_t offset = 0;
+        out.put(offset);
+        for (const EntryTable *part : parts)
+        {
+            for (size_t i = 0; i < part->size(); ++i)
+            {
+                offset += part->get_tags(i).size();
+                out.put(offset);
+            }
+        }
+        out.end_section();
+
+        for (size_t p = 0; p < parts.size(); ++p)
+        {
+            for (size_t i = 0; i < parts[p]->size(); ++i)
+            {
+                const EntryTable::tag_list tags = parts[p]->get_tags(i);
+                for (const tag_id *id = tags.ids();
+                     id != tags.ids() + tags.size(); ++id)
+                {
+                    out.put(translated[p][*id]);
+                }
+            }
+        }
+        out.end_section();
+
+        offset = 0;
+        out.put(offset);
+        for (const string_view name : tag_names)
+        {
+            offset += name.size();
+            out.put(offset);
+        }
+        out.end_section();
+
+        vector<tag_id> by_name(tag_names.size());
+        std::iota(by_name.begin(), by_name.end(), 0);
+        std::sort(by_name.begin(), by_name.end(),
+                  [&tag_names](const tag_id a, const tag_id b)
+                  {
+                      return tag_names[a] < tag_names[b];
+                  });
+        out.put(by_name.data(), by_name.size() * sizeof(tag_id));
+        out.end_section();
+
+        for (size_t f = 0; f < n_folded; ++f)
+        {
+            offset = 0;
+            out.put(offset);
+            for (size_t p = 0; p < parts.size(); ++p)
+            {
+                for (size_t i = 0; i < parts[p]->size(); ++i)
+                {
+                    offset += get_folded(p, f, i).size();
+                    out.put(offset);
+                }
+            }
+            out.end_section();
+        }
+
+        out.put(trigrams._trigrams, trigrams._n_trigrams * sizeof(uint32_t));
+        out.end_section();
+        out.put(trigrams._offsets,
+                (trigrams._n_trigrams + 1) * sizeof(uint64_t));
+        out.end_section();
+        out.put(words._offsets, (words._size + 1) * sizeof(uint64_t));
+        out.end_section();
+
+        for (size_t f = 0; f < n_fields; ++f)
+        {
+            for (size_t p = 0; p < parts.size(); ++p)
+            {
+                for (size_t i = 0; i < parts[p]->size(); ++i)
+                {
+                    const string_view text = get_field(p, f, i);
+                    out.put(text.data(), text.size());
+                }
+            }
+            out.end_section();
+        }
+
+        for (size_t f = 0; f < n_folded; ++f)
+        {
+            for (size_t p = 0; p < parts.size(); ++p)
+            {
+                for (size_t i = 0; i < parts[p]->size(); ++i)
+                {
+                    const string_view text = get_folded(p, f, i);
+                    out.put(text.data(), text.size());
+                }
+            }
+            out.end_section();
+        }
+
+        for (const string_view name : tag_names)
+        {
+            out.put(name.data(), name.size());
+        }
+        out.end_section();
+
+        out.put(words._text, head.words_size);
+        out.end_section();
+
+        out.put(trigrams._postings, head.trigram_rows_size);
+        out.end_section();
+
+        out.close();
+        fs::rename(tmppath, path);
+    }
+    catch (...)
+    {
+        fs::remove(tmppath);
+        throw;
+    }
+}
+} // namespace remwharead
@@ -15,14 +15,23 @@
  */
 
 #include "sqlite.hpp"
+#include "compression.hpp"
+#include "entry_table.hpp"
+#include "hash.hpp"
+#include "tag_index.hpp"
 #include "time.hpp"
 #include <Poco/Data/SQLite/Connector.h>
+#include <Poco/Data/LOB.h>
 #include <Poco/Data/Session.h>
 #include <Poco/Version.h>
 #include <Poco/Environment.h>
 #include <algorithm>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
 
 namespace remwharead
 {
@@ -30,8 +39,89 @@ using std::cerr;
 using std::endl;
 using namespace Poco::Data::Keywords;
 using Poco::Data::Statement;
+using Poco::Data::BLOB;
 using Poco::Environment;
 
+namespace
+{
+/*!
+ *  The columns of Database::entry, in order, and the compressed full text.
+ *  The full text is read from the content table, entries that were not
+ *  migrated have it in the entry.
+ */
+const string select_entries =
+    "SELECT e.uri, e.archive_uri, e.datetime, e.tags, e.title, "
+    "e.description, coalesce(c.fulltext, e.fulltext), "
+    "coalesce(c.compressed, x'') FROM remwharead AS e "
+    "LEFT JOIN remwharead_content AS c ON e.content = c.hash ";
+
+/*!
+ *  The columns of the entry table. The row ids are used by the tag index,
+ *  the archive queue and snapshots. They have to be declared, or VACUUM
+ *  could change them.
+ */
+const string entry_columns =
+    "id INTEGER PRIMARY KEY, uri TEXT, archive_uri TEXT, datetime TEXT, "
+    "tags TEXT, title TEXT, description TEXT, fulltext TEXT, content TEXT";
+
+//! Returns the full text, decompressed into buffer if necessary.
+std::string_view fulltext_of(const string &fulltext, const BLOB &compressed,
+                             const Compressor *compressor, string &buffer)
+{
+    if (compressed.size() == 0)
+    {
+        return fulltext;
+    }
+    if (compressor == nullptr)
+    {
+        throw std::runtime_error("remwharead was compiled without zstd.");
+    }
+
+    return compressor->decompress(
+        {reinterpret_cast<const char *>(compressed.rawContent()),
+         compressed.size()},
+        buffer);
+}
+
+BLOB to_blob(const string &data)
+{
+    return BLOB(reinterpret_cast<const unsigned char *>(data.data()),
+                data.size());
+}
+
+//! Returns true if the table has this column.
+bool has_column(Session &session, const string &table, const string &column)
+{
+    vector<string> columns;
+    session << "SELECT name FROM pragma_table_info(?);",
+        useRef(table), into(columns), now;
+
+    return std::find(columns.begin(), columns.end(), column) != columns.end();
+}
+
+//! Split comma separated tags, skip empty ones.
+vector<string> split_tags(const string &strtags)
+{
+    vector<string> tags;
+    size_t pos = 0;
+    while (pos != string::npos)
+    {
+        const size_t newpos = strtags.find(',', pos);
+        if (newpos != pos && pos != strtags.size())
+        {
+            tags.push_back(strtags.substr(pos, newpos - pos));
+        }
+        pos = newpos;
+        if (pos != string::npos)
+        {
+            ++pos;
+        }
+    }
+
+    return tags;
+}
+} // namespace
+
 Database::Database()
     : _connected{false}
 {
@@ -47,8 +137,102 @@ Database::Database()
         Poco::Data::SQLite::Connector::registerConnector();
         _session = std::make_unique<Session>("SQLite", _dbpath);
         *_session << "CREATE TABLE IF NOT EXISTS remwharead("
-            "uri TEXT, archive_uri TEXT, datetime TEXT, "
-            "tags TEXT, title TEXT, description TEXT, fulltext TEXT);", now;
+            + entry_columns + ");", now;
+        if (!has_column(*_session, "remwharead", "id"))
+        {   // Database was created by a version with implicit row ids.
+            migrate_row_ids();
+        }
+        // Speeds up retrieve() with a time span and/or a limit.
+        *_session << "CREATE INDEX IF NOT EXISTS remwharead_datetime "
+            "ON remwharead(datetime);", now;
+        // The row ids of the entries of every tag, see tag_index().
+        *_session << "CREATE TABLE IF NOT EXISTS remwharead_tags("
+            "tag TEXT PRIMARY KEY, entries BLOB);", now;
+        // Full texts, identified by their hash. Entries with the same text
+        // share one row. Different texts with the same hash get a suffix,
+        // see content_key().
+        *_session << "CREATE TABLE IF NOT EXISTS remwharead_content("
+            "hash TEXT PRIMARY KEY, fulltext TEXT, compressed BLOB, "
+            "page BLOB);", now;
+        if (!has_column(*_session, "remwharead_content", "compressed"))
+        {
+            *_session << "ALTER TABLE remwharead_content "
+                "ADD COLUMN compressed BLOB;", now;
+        }
+        // The compressed text of the whole page, if the full text is only
+        // the main content.
+        if (!has_column(*_session, "remwharead_content", "page"))
+        {
+            *_session << "ALTER TABLE remwharead_content "
+                "ADD COLUMN page BLOB;", now;
+        }
+        // Dictionaries for the compression, only the last one is used.
+        *_session << "CREATE TABLE IF NOT EXISTS remwharead_dictionaries("
+            "dictionary BLOB);", now;
+        if (!has_column(*_session, "remwharead", "content"))
+        {   // Database was created by a version without content table.
+            *_session << "ALTER TABLE remwharead ADD COLUMN content TEXT;",
+                now;
+        }
+        *_session << "CREATE INDEX IF NOT EXISTS remwharead_content_hash "
+            "ON remwharead(content);", now;
+        size_t n_unmigrated = 0;
+        *_session << "SELECT count(*) FROM remwharead WHERE content IS NULL;",
+            into(n_unmigrated), now;
+        if (n_unmigrated != 0)
+        {
+            migrate_content();
+        }
+        // Entries waiting to be archived. An empty next_attempt means that
+        // the job was given up.
+        *_session << "CREATE TABLE IF NOT EXISTS remwharead_archive_queue("
+            "entry INTEGER PRIMARY KEY, uri TEXT, attempts INTEGER, "
+            "next_attempt TEXT, error TEXT);", now;
+        // Counts changes that are not appends, see current_revision().
+        *_session << "CREATE TABLE IF NOT EXISTS remwharead_meta("
+            "key TEXT PRIMARY KEY, value INTEGER);", now;
+        *_session << "INSERT OR IGNORE INTO remwharead_meta "
+            "VALUES('modifications', 0), ('archived', 0);", now;
+        // Older versions counted every update as modification.
+        *_session << "DROP TRIGGER IF EXISTS remwharead_update;", now;
+        *_session << "CREATE TRIGGER remwharead_update "
+            "AFTER UPDATE OF uri, datetime, tags, title, description, "
+            "fulltext, content ON remwharead BEGIN UPDATE remwharead_meta "
+            "SET value = value + 1 WHERE key = 'modifications'; END;", now;
+        // Archive URIs are not searched, entries stay the same otherwise.
+        *_session << "CREATE TRIGGER IF NOT EXISTS remwharead_archive "
+            "AFTER UPDATE OF archive_uri ON remwharead BEGIN "
+            "UPDATE remwharead_meta SET value = value + 1 "
+            "WHERE key = 'archived'; END;", now;
+        *_session << "CREATE TRIGGER IF NOT EXISTS remwharead_delete "
+            "AFTER DELETE ON remwharead BEGIN UPDATE remwharead_meta "
+            "SET value = value + 1 WHERE key = 'modifications'; END;", now;
+
+        size_t n_tags = 0;
+        size_t n_tagged = 0;
+        *_session << "SELECT count(*) FROM remwharead_tags;",
+            into(n_tags), now;
+        *_session << "SELECT count(*) FROM remwharead WHERE tags != '';",
+            into(n_tagged), now;
+        if (n_tags == 0 && n_tagged != 0)
+        {   // Database was created by a version without tag index.
+            rebuild_tag_index();
+        }
+
+        if (Compressor::available())
+        {
+            vector<BLOB> dictionaries;
+            *_session << "SELECT dictionary FROM remwharead_dictionaries "
+                "ORDER BY rowid DESC LIMIT 1;", into(dictionaries), now;
+            string dictionary;
+            if (!dictionaries.empty())
+            {
+                dictionary.assign(reinterpret_cast<const char *>(
+                                      dictionaries.front().rawContent()),
+                                  dictionaries.front().size());
+            }
+            _compressor = std::make_unique<Compressor>(std::move(dictionary));
+        }
 
         _connected = true;
     }
@@ -58,6 +242,10 @@ Database::Database()
     }
 }
 
+Database::~Database() = default;
+Database::Database(Database &&other) noexcept = default;
+Database &Database::operator=(Database &&other) noexcept = default;
+
 Database::operator bool() const
 {
     return _connected;
@@ -79,91 +267,628 @@ string Database::entry::fulltext_oneline() const
     return oneline;
 }
 
-void Database::store(const Database::entry &data) const
+void Database::store(const Database::entry &data, const bool archive,
+                     const string &page_text) const
 {
     try
     {
         const string strdatetime = timepoint_to_string(data.datetime, true);
         string strtags = tags_to_string(data.tags);
+        string hash;
+        bool stored = false;
         Statement insert(*_session);
 
         // useRef() uses the const reference.
-        insert << "INSERT INTO remwharead "
-            "VALUES(?, ?, ?, ?, ?, ?, ?);",
+        insert << "INSERT INTO remwharead(uri, archive_uri, datetime, "
+            "tags, title, description, fulltext, content) "
+            "VALUES(?, ?, ?, ?, ?, ?, '', ?);",
             useRef(data.uri), useRef(data.archive_uri),
             useRef(strdatetime), useRef(strtags), useRef(data.title),
-            useRef(data.description), useRef(data.fulltext);
+            useRef(data.description), useRef(hash);
+
+        _session->begin();
+        std::tie(hash, stored) = content_key(data.fulltext);
         insert.execute();
+        // Read it before other rows are inserted.
+        size_t rowid = 0;
+        *_session << "SELECT last_insert_rowid();", into(rowid), now;
+
+        if (!stored)
+        {
+            if (_compressor)
+            {
+                const BLOB compressed = to_blob(
+                    _compressor->compress(data.fulltext));
+                const BLOB page = to_blob(
+                    page_text.empty() ? string()
+                    : _compressor->compress(page_text));
+                *_session << "INSERT INTO remwharead_content"
+                    "(hash, fulltext, compressed, page) "
+                    "VALUES(?, '', ?, nullif(?, x''));",
+                    useRef(hash), useRef(compressed), useRef(page), now;
+            }
+            else
+            {
+                *_session << "INSERT INTO remwharead_content"
+                    "(hash, fulltext) VALUES(?, ?);",
+                    useRef(hash), useRef(data.fulltext), now;
+            }
+        }
+        else if (_compressor && !page_text.empty())
+        {   // The text was stored before without the page.
+            const BLOB page = to_blob(_compressor->compress(page_text));
+            *_session << "UPDATE remwharead_content SET page = ? "
+                "WHERE hash = ? AND page IS NULL;",
+                useRef(page), useRef(hash), now;
+        }
+
+        for (const string &tag : split_tags(strtags))
+        {
+            Bitmap rowids = load_tag(tag);
+            rowids.set(rowid);
+            save_tag(tag, rowids);
+        }
+        if (archive)
+        {
+            *_session << "INSERT INTO remwharead_archive_queue "
+                "VALUES(?, ?, 0, ?, '');",
+                use(rowid), useRef(data.uri), useRef(strdatetime), now;
+        }
+        _session->commit();
     }
     catch (std::exception &e)
     {
+        if (_session->isTransaction())
+        {
+            _session->rollback();
+        }
         cerr << "Error in " << __func__ << ": " << e.what() << endl;
     }
 }
 
 list<Database::entry> Database::retrieve(const time_point &start,
-                                         const time_point &end) const
+                                         const time_point &end,
+                                         const size_t limit) const
+{
+    return retrieve_table(start, end, limit).to_list();
+}
+
+EntryTable Database::retrieve_table(const time_point &start,
+                                    const time_point &end,
+                                    const size_t limit,
+                                    std::pmr::memory_resource *resource) const
 {
+    EntryTable entries(resource);
+
     try
     {
-        Database::entry entrybuf;
+        // The buffers are reused for every row.
+        string uri;
+        string archive_uri;
         string datetime;
         string strtags;
+        string title;
+        string description;
+        string fulltext;
+        BLOB compressed;
+        string buffer;
         Statement select(*_session);
 
-        // bind() copies the value.
-        select << "SELECT * FROM remwharead WHERE datetime "
-            "BETWEEN ? AND ? ORDER BY datetime DESC;",
-            bind(timepoint_to_string(start, true)),
-            bind(timepoint_to_string(end, true)),
-            into(entrybuf.uri), into(entrybuf.archive_uri), into(datetime),
-            into(strtags), into(entrybuf.title), into(entrybuf.description),
-            into(entrybuf.fulltext), range(0, 1);
+        string query = select_entries
+            + "WHERE e.datetime BETWEEN ? AND ? ORDER BY e.datetime DESC";
+        if (limit != 0)
+        {
+            query += " LIMIT " + std::to_string(limit);
+        }
+        query += ';';
 
-        list<entry> entries;
+        const string strstart = timepoint_to_string(start, true);
+        const string strend = timepoint_to_string(end, true);
+        select << query, useRef(strstart), useRef(strend),
+            into(uri), into(archive_uri), into(datetime), into(strtags),
+            into(title), into(description), into(fulltext), into(compressed),
+            range(0, 1);
 
         while(!select.done() && select.execute() != 0)
         {
-            entrybuf.datetime = string_to_timepoint(datetime, true);
+            entries.push_back(uri, archive_uri,
+                              string_to_timepoint(datetime, true), strtags,
+                              title, description,
+                              fulltext_of(fulltext, compressed,
+                                          _compressor.get(), buffer));
+        }
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+
+    return entries;
+}
+
+EntryTable Database::retrieve_table(const Bitmap &rowids,
+                                    const time_point &start,
+                                    const time_point &end,
+                                    const size_t limit,
+                                    std::pmr::memory_resource *resource) const
+{
+    EntryTable entries(resource);
 
-            vector<string> tags;
-            size_t pos = 0;
-            while (pos != string::npos)
+    try
+    {
+        // Find the rows in the right order without reading the text.
+        const string strstart = timepoint_to_string(start, true);
+        const string strend = timepoint_to_string(end, true);
+        vector<size_t> ordered;
+        *_session << "SELECT rowid FROM remwharead WHERE datetime "
+            "BETWEEN ? AND ? ORDER BY datetime DESC;",
+            useRef(strstart), useRef(strend), into(ordered), now;
+
+        vector<size_t> selected;
+        for (const size_t rowid : ordered)
+        {
+            if (rowids.test(rowid))
             {
-                const size_t newpos = strtags.find(',', pos);
-                const string tag = strtags.substr(pos, newpos - pos);
-                if (!tag.empty())
+                selected.push_back(rowid);
+                if (selected.size() == limit)
                 {
-                    tags.push_back(tag);
-                }
-                pos = newpos;
-                if (pos != string::npos)
-                {
-                    ++pos;
+                    break;
                 }
             }
-            entrybuf.tags = tags;
+        }
+        entries.reserve(selected.size());
+
+        size_t rowid = 0;
+        string uri;
+        string archive_uri;
+        string datetime;
+        string strtags;
+        string title;
+        string description;
+        string fulltext;
+        BLOB compressed;
+        string buffer;
+        Statement select(*_session);
+        select << select_entries + "WHERE e.rowid = ?;", use(rowid),
+            into(uri), into(archive_uri), into(datetime), into(strtags),
+            into(title), into(description), into(fulltext), into(compressed);
 
-            entries.push_back(entrybuf);
+        for (const size_t id : selected)
+        {
+            rowid = id;
+            select.execute();
+            entries.push_back(uri, archive_uri,
+                              string_to_timepoint(datetime, true), strtags,
+                              title, description,
+                              fulltext_of(fulltext, compressed,
+                                          _compressor.get(), buffer));
         }
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+
+    return entries;
+}
 
-        return entries;
+EntryTable Database::retrieve_rows(const std::uint64_t after,
+                                   const std::uint64_t last,
+                                   std::pmr::memory_resource *resource) const
+{
+    EntryTable entries(resource);
+
+    string uri;
+    string archive_uri;
+    string datetime;
+    string strtags;
+    string title;
+    string description;
+    string fulltext;
+    BLOB compressed;
+    string buffer;
+    Statement select(*_session);
+    select << select_entries
+        + "WHERE e.rowid > ? AND e.rowid <= ? ORDER BY e.rowid;",
+        useRef(after), useRef(last),
+        into(uri), into(archive_uri), into(datetime), into(strtags),
+        into(title), into(description), into(fulltext), into(compressed),
+        range(0, 1);
+
+    while(!select.done() && select.execute() != 0)
+    {
+        entries.push_back(uri, archive_uri,
+                          string_to_timepoint(datetime, true), strtags,
+                          title, description,
+                          fulltext_of(fulltext, compressed,
+                                      _compressor.get(), buffer));
+    }
+
+    return entries;
+}
+
+list<Database::entry>
+Database::retrieve_archive_uris(const std::uint64_t last) const
+{
+    list<entry> entries;
+
+    string uri;
+    string archive_uri;
+    string datetime;
+    Statement select(*_session);
+    select << "SELECT uri, archive_uri, datetime FROM remwharead "
+        "WHERE rowid <= ? ORDER BY rowid;",
+        useRef(last), into(uri), into(archive_uri), into(datetime),
+        range(0, 1);
+
+    while(!select.done() && select.execute() != 0)
+    {
+        entry &added = entries.emplace_back();
+        added.uri = uri;
+        added.archive_uri = archive_uri;
+        added.datetime = string_to_timepoint(datetime, true);
+    }
+
+    return entries;
+}
+
+Database::revision Database::current_revision() const
+{
+    revision current;
+    *_session << "SELECT value FROM remwharead_meta "
+        "WHERE key = 'modifications';", into(current.modifications), now;
+    *_session << "SELECT coalesce(max(rowid), 0) FROM remwharead;",
+        into(current.last_row), now;
+    *_session << "SELECT value FROM remwharead_meta "
+        "WHERE key = 'archived';", into(current.archived), now;
+
+    return current;
+}
+
+const fs::path &Database::path() const
+{
+    return _dbpath;
+}
+
+TagIndex Database::tag_index() const
+{
+    TagIndex index;
+
+    try
+    {
+        string tag;
+        BLOB entries;
+        Statement select(*_session);
+        select << "SELECT tag, entries FROM remwharead_tags;",
+            into(tag), into(entries), range(0, 1);
+
+        while(!select.done() && select.execute() != 0)
+        {
+            index.add(Bitmap::deserialize(
+                          {reinterpret_cast<const char *>(entries.rawContent()),
+                           entries.size()}),
+                      tag);
+        }
     }
     catch (std::exception &e)
     {
         cerr << "Error in " << __func__ << ": " << e.what() << endl;
     }
 
-    return {};
+    return index;
+}
+
+string Database::page_text(const string &uri) const
+{
+    vector<BLOB> pages;
+    *_session << "SELECT coalesce(c.page, x'') FROM remwharead AS e "
+        "JOIN remwharead_content AS c ON e.content = c.hash "
+        "WHERE e.uri = ? ORDER BY e.rowid DESC LIMIT 1;",
+        useRef(uri), into(pages), now;
+    if (pages.empty() || pages.front().size() == 0)
+    {
+        return {};
+    }
+
+    string buffer;
+    return string(fulltext_of({}, pages.front(), _compressor.get(), buffer));
 }
 
 size_t Database::remove(const string &uri)
 {
+    vector<size_t> rowids;
+    vector<string> strtags;
+    vector<string> hashes;
+    *_session << "SELECT rowid, tags, coalesce(content, '') FROM remwharead "
+        "WHERE uri = ?;",
+        useRef(uri), into(rowids), into(strtags), into(hashes), now;
+
     Statement del(*_session);
+    del << "DELETE FROM remwharead WHERE uri = ?;", useRef(uri);
+    size_t rowid = 0;
+    Statement unqueue(*_session);
+    unqueue << "DELETE FROM remwharead_archive_queue WHERE entry = ?;",
+        use(rowid);
+
+    _session->begin();
+    try
+    {
+        for (size_t i = 0; i < rowids.size(); ++i)
+        {
+            for (const string &tag : split_tags(strtags[i]))
+            {
+                Bitmap tag_rowids = load_tag(tag);
+                tag_rowids.reset(rowids[i]);
+                save_tag(tag, tag_rowids);
+            }
+            rowid = rowids[i];
+            unqueue.execute();
+        }
+        const size_t removed = del.execute();
 
-    del << "DELETE FROM remwharead WHERE uri = ?;", bind(uri);
+        // Remove full texts that are not used anymore.
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        for (const string &hash : hashes)
+        {
+            *_session << "DELETE FROM remwharead_content WHERE hash = ? AND "
+                "NOT EXISTS (SELECT 1 FROM remwharead WHERE content = ?);",
+                useRef(hash), useRef(hash), now;
+        }
+        _session->commit();
 
-    return del.execute();
+        return removed;
+    }
+    catch (...)
+    {
+        _session->rollback();
+        throw;
+    }
+}
+
+size_t Database::compress_fulltexts()
+{
+    if (!_compressor)
+    {
+        throw std::runtime_error("remwharead was compiled without zstd.");
+    }
+
+    if (_compressor->dictionary().empty())
+    {   // A dictionary helps most with the many small texts.
+        vector<string> samples;
+        *_session << "SELECT fulltext FROM remwharead_content "
+            "WHERE fulltext != '' ORDER BY random() LIMIT 4000;",
+            into(samples), now;
+        string dictionary = Compressor::train(samples);
+        if (!dictionary.empty())
+        {
+            const BLOB data(
+                reinterpret_cast<const unsigned char *>(dictionary.data()),
+                dictionary.size());
+            *_session << "INSERT INTO remwharead_dictionaries VALUES(?);",
+                useRef(data), now;
+            _compressor = std::make_unique<Compressor>(std::move(dictionary));
+        }
+    }
+
+    vector<string> hashes;
+    *_session << "SELECT hash FROM remwharead_content WHERE fulltext != '';",
+        into(hashes), now;
+
+    string hash;
+    string fulltext;
+    BLOB compressed;
+    Statement select(*_session);
+    select << "SELECT fulltext FROM remwharead_content WHERE hash = ?;",
+        use(hash), into(fulltext);
+    Statement update(*_session);
+    update << "UPDATE remwharead_content SET fulltext = '', compressed = ? "
+        "WHERE hash = ?;", use(compressed), use(hash);
+
+    _session->begin();
+    try
+    {
+        for (const string &id : hashes)
+        {
+            hash = id;
+            select.execute();
+            const string data = _compressor->compress(fulltext);
+            compressed.assignRaw(
+                reinterpret_cast<const unsigned char *>(data.data()),
+                data.size());
+            update.execute();
+        }
+        _session->commit();
+    }
+    catch (...)
+    {
+        _session->rollback();
+        throw;
+    }
+
+    // Keeps the row ids of the entries, they are declared.
+    *_session << "VACUUM;", now;
+
+    return hashes.size();
+}
+
+vector<Database::archive_job> Database::archive_queue(const size_t limit) const
+{
+    vector<archive_job> jobs;
+
+    try
+    {
+        string query = "SELECT entry, uri, attempts "
+            "FROM remwharead_archive_queue "
+            "WHERE next_attempt != '' AND next_attempt <= ? "
+            "ORDER BY next_attempt";
+        if (limit != 0)
+        {
+            query += " LIMIT " + std::to_string(limit);
+        }
+        query += ';';
+
+        const string strnow = timepoint_to_string(system_clock::now(), true);
+        vector<size_t> rowids;
+        vector<string> uris;
+        vector<unsigned> attempts;
+        *_session << query, useRef(strnow),
+            into(rowids), into(uris), into(attempts), now;
+
+        jobs.reserve(rowids.size());
+        for (size_t i = 0; i < rowids.size(); ++i)
+        {
+            jobs.push_back({rowids[i], uris[i], attempts[i]});
+        }
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+
+    return jobs;
+}
+
+vector<Database::archive_job> Database::claim_archive_jobs(
+    const size_t limit, const std::chrono::seconds lease,
+    const string &uri) const
+{
+    vector<archive_job> jobs;
+
+    try
+    {
+        string query = "SELECT entry, uri, attempts, next_attempt "
+            "FROM remwharead_archive_queue "
+            "WHERE next_attempt != '' AND next_attempt <= ? "
+            "AND (? = '' OR uri = ?) ORDER BY next_attempt";
+        if (limit != 0)
+        {
+            query += " LIMIT " + std::to_string(limit);
+        }
+        query += ';';
+
+        const time_point claimed = system_clock::now();
+        const string strnow = timepoint_to_string(claimed, true);
+        const string strlease = timepoint_to_string(claimed + lease, true);
+        vector<size_t> rowids;
+        vector<string> uris;
+        vector<unsigned> attempts;
+        vector<string> due;
+        *_session << query, useRef(strnow), useRef(uri), useRef(uri),
+            into(rowids), into(uris), into(attempts), into(due), now;
+
+        // Only take the jobs that no other process took in the meantime.
+        size_t rowid = 0;
+        string strdue;
+        Statement claim(*_session);
+        claim << "UPDATE remwharead_archive_queue SET next_attempt = ? "
+            "WHERE entry = ? AND next_attempt = ?;",
+            useRef(strlease), use(rowid), use(strdue);
+        for (size_t i = 0; i < rowids.size(); ++i)
+        {
+            rowid = rowids[i];
+            strdue = due[i];
+            if (claim.execute() == 1)
+            {
+                jobs.push_back({rowids[i], uris[i], attempts[i]});
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+
+    return jobs;
+}
+
+void Database::release_archive_job(const archive_job &job) const
+{
+    try
+    {
+        const string strnow = timepoint_to_string(system_clock::now(), true);
+        *_session << "UPDATE remwharead_archive_queue SET next_attempt = ? "
+            "WHERE entry = ?;", useRef(strnow), useRef(job.rowid), now;
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+}
+
+std::optional<time_point> Database::next_archive_job() const
+{
+    try
+    {
+        vector<string> next;
+        *_session << "SELECT min(next_attempt) FROM remwharead_archive_queue "
+            "WHERE next_attempt != '' HAVING count(*) > 0;",
+            into(next), now;
+        if (!next.empty())
+        {
+            return string_to_timepoint(next.front(), true);
+        }
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+
+    return {};
+}
+
+void Database::archive_done(
+    const vector<std::pair<size_t, string>> &archived) const
+{
+    try
+    {
+        size_t rowid = 0;
+        string archive_uri;
+        Statement update(*_session);
+        update << "UPDATE remwharead SET archive_uri = ? WHERE rowid = ?;",
+            use(archive_uri), use(rowid);
+        Statement unqueue(*_session);
+        unqueue << "DELETE FROM remwharead_archive_queue WHERE entry = ?;",
+            use(rowid);
+
+        _session->begin();
+        for (const auto &job : archived)
+        {
+            rowid = job.first;
+            archive_uri = job.second;
+            update.execute();
+            unqueue.execute();
+        }
+        _session->commit();
+    }
+    catch (std::exception &e)
+    {
+        if (_session->isTransaction())
+        {
+            _session->rollback();
+        }
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
+}
+
+void Database::archive_failed(const archive_job &job, const string &error,
+                              const std::optional<time_point> &next_attempt)
+    const
+{
+    try
+    {
+        const string strnext =
+            next_attempt ? timepoint_to_string(*next_attempt, true) : "";
+        const unsigned attempts = job.attempts + 1;
+        *_session << "UPDATE remwharead_archive_queue "
+            "SET attempts = ?, next_attempt = ?, error = ? WHERE entry = ?;",
+            useRef(attempts), useRef(strnext), useRef(error), useRef(job.rowid),
+            now;
+    }
+    catch (std::exception &e)
+    {
+        cerr << "Error in " << __func__ << ": " << e.what() << endl;
+    }
 }
 
 string Database::tags_to_string(const vector<string> &tags)
@@ -182,6 +907,163 @@ string Database::tags_to_string(const vector<string> &tags)
     return strtags;
 }
 
+Bitmap Database::load_tag(const string &tag) const
+{
+    vector<BLOB> entries;
+    *_session << "SELECT entries FROM remwharead_tags WHERE tag = ?;",
+        useRef(tag), into(entries), now;
+    if (entries.empty())
+    {
+        return {};
+    }
+
+    return Bitmap::deserialize(
+        {reinterpret_cast<const char *>(entries.front().rawContent()),
+         entries.front().size()});
+}
+
+void Database::save_tag(const string &tag, const Bitmap &rowids) const
+{
+    if (rowids.none())
+    {
+        *_session << "DELETE FROM remwharead_tags WHERE tag = ?;",
+            useRef(tag), now;
+        return;
+    }
+
+    const string data = rowids.serialize();
+    const BLOB entries(reinterpret_cast<const unsigned char *>(data.data()),
+                       data.size());
+    *_session << "INSERT OR REPLACE INTO remwharead_tags VALUES(?, ?);",
+        useRef(tag), useRef(entries), now;
+}
+
+void Database::rebuild_tag_index() const
+{
+    TagIndex index;
+    size_t rowid = 0;
+    string strtags;
+    Statement select(*_session);
+    select << "SELECT rowid, tags FROM remwharead;",
+        into(rowid), into(strtags), range(0, 1);
+    while(!select.done() && select.execute() != 0)
+    {
+        for (const string &tag : split_tags(strtags))
+        {
+            index.add(rowid, tag);
+        }
+    }
+
+    _session->begin();
+    *_session << "DELETE FROM remwharead_tags;", now;
+    for (const auto &[tag, rowids] : index.tags())
+    {
+        save_tag(tag, rowids);
+    }
+    _session->commit();
+}
+
+void Database::migrate_content() const
+{
+    vector<size_t> rowids;
+    *_session << "SELECT rowid FROM remwharead WHERE content IS NULL;",
+        into(rowids), now;
+
+    size_t rowid = 0;
+    string fulltext;
+    string hash;
+    Statement select(*_session);
+    select << "SELECT fulltext FROM remwharead WHERE rowid = ?;",
+        use(rowid), into(fulltext);
+    bool stored = false;
+    Statement insert(*_session);
+    insert << "INSERT INTO remwharead_content(hash, fulltext) "
+        "VALUES(?, ?);",
+        use(hash), use(fulltext);
+    Statement update(*_session);
+    update << "UPDATE remwharead SET fulltext = '', content = ? "
+        "WHERE rowid = ?;", use(hash), use(rowid);
+
+    _session->begin();
+    try
+    {
+        for (const size_t id : rowids)
+        {
+            rowid = id;
+            select.execute();
+            std::tie(hash, stored) = content_key(fulltext);
+            if (!stored)
+            {
+                insert.execute();
+            }
+            update.execute();
+        }
+        _session->commit();
+    }
+    catch (...)
+    {
+        _session->rollback();
+        throw;
+    }
+
+    // Give the space of the duplicates back to the file system.
+    *_session << "VACUUM;", now;
+}
+
+std::pair<string, bool> Database::content_key(const string &fulltext) const
+{
+    const string hash = content_hash(fulltext);
+    string key = hash;
+    string buffer;
+    for (size_t n = 1;; ++n)
+    {
+        vector<string> texts;
+        vector<BLOB> compressed;
+        *_session << "SELECT fulltext, coalesce(compressed, x'') "
+            "FROM remwharead_content WHERE hash = ?;",
+            useRef(key), into(texts), into(compressed), now;
+        if (texts.empty())
+        {
+            return {key, false};
+        }
+        if (fulltext_of(texts.front(), compressed.front(), _compressor.get(),
+                        buffer)
+            == fulltext)
+        {
+            return {key, true};
+        }
+        // Another text has the same hash.
+        key = hash + '-' + std::to_string(n);
+    }
+}
+
+void Database::migrate_row_ids() const
+{
+    const string content =
+        has_column(*_session, "remwharead", "content") ? "content" : "NULL";
+
+    _session->begin();
+    try
+    {
+        // Indexes and triggers are dropped with the old table and created
+        // again in the constructor.
+        *_session << "CREATE TABLE remwharead_migration("
+            + entry_columns + ");", now;
+        *_session << "INSERT INTO remwharead_migration SELECT rowid, uri, "
+            "archive_uri, datetime, tags, title, description, fulltext, "
+            + content + " FROM remwharead;", now;
+        *_session << "DROP TABLE remwharead;", now;
+        *_session << "ALTER TABLE remwharead_migration "
+            "RENAME TO remwharead;", now;
+        _session->commit();
+    }
+    catch (...)
+    {
+        _session->rollback();
+        throw;
+    }
+}
+
 fs::path Database::get_data_home()
 {
     fs::path path;
@@ -0,0 +1,353 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tag_index.hpp"
+#include "entry_table.hpp"
+#include "term_matcher.hpp"
+#include <Poco/RegularExpression.h>
+#include <algorithm>
+
+namespace remwharead
+{
+using RegEx = Poco::RegularExpression;
+
+namespace
+{
+constexpr size_t word_bits = 64;
+} // namespace
+
+void Bitmap::set(const size_t bit)
+{
+    const size_t word = bit / word_bits;
+    if (word >= _words.size())
+    {
+        _words.resize(word + 1, 0);
+    }
+    _words[word] |= std::uint64_t{1} << (bit % word_bits);
+}
+
+void Bitmap::set(const size_t first, const size_t last)
+{
+    if (first >= last)
+    {
+        return;
+    }
+    const size_t last_word = (last - 1) / word_bits;
+    if (last_word >= _words.size())
+    {
+        _words.resize(last_word + 1, 0);
+    }
+    for (size_t word = first / word_bits; word <= last_word; ++word)
+    {
+        std::uint64_t mask = ~std::uint64_t{0};
+        if (word == first / word_bits)
+        {
+            mask &= ~std::uint64_t{0} << (first % word_bits);
+        }
+        if (word == last_word && last % word_bits != 0)
+        {
+            mask &= ~std::uint64_t{0} >> (word_bits - last % word_bits);
+        }
+        _words[word] |= mask;
+    }
+}
+
+void Bitmap::reset(const size_t bit)
+{
+    const size_t word = bit / word_bits;
+    if (word < _words.size())
+    {
+        _words[word] &= ~(std::uint64_t{1} << (bit % word_bits));
+        trim();
+    }
+}
+
+bool Bitmap::test(const size_t bit) const
+{
+    const size_t word = bit / word_bits;
+    if (word >= _words.size())
+    {
+        return false;
+    }
+
+    return ((_words[word] >> (bit % word_bits)) & 1U) != 0;
+}
+
+size_t Bitmap::count() const
+{
+    size_t n = 0;
+    for (const std::uint64_t word : _words)
+    {
+        n += static_cast<size_t>(__builtin_popcountll(word));
+    }
+
+    return n;
+}
+
+bool Bitmap::none() const
+{
+    return _words.empty();
+}
+
+Bitmap &Bitmap::operator&=(const Bitmap &other)
+{
+    if (_words.size() > other._words.size())
+    {
+        _words.resize(other._words.size());
+    }
+    for (size_t i = 0; i < _words.size(); ++i)
+    {
+        _words[i] &= other._words[i];
+    }
+    trim();
+
+    return *this;
+}
+
+Bitmap &Bitmap::operator|=(const Bitmap &other)
+{
+    if (_words.size() < other._words.size())
+    {
+        _words.resize(other._words.size(), 0);
+    }
+    for (size_t i = 0; i < other._words.size(); ++i)
+    {
+        _words[i] |= other._words[i];
+    }
+
+    return *this;
+}
+
+Bitmap &Bitmap::operator-=(const Bitmap &other)
+{
+    const size_t n = std::min(_words.size(), other._words.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+        _words[i] &= ~other._words[i];
+    }
+    trim();
+
+    return *this;
+}
+
+bool Bitmap::operator==(const Bitmap &other) const
+{
+    return _words == other._words;
+}
+
+vector<size_t> Bitmap::indices() const
+{
+    vector<size_t> result;
+    result.reserve(count());
+    for (size_t i = 0; i < _words.size(); ++i)
+    {
+        std::uint64_t word = _words[i];
+        while (word != 0)
+        {
+            result.push_back(i * word_bits
+                             + static_cast<size_t>(__builtin_ctzll(word)));
+            word &= word - 1;   // Clear lowest set bit.
+        }
+    }
+
+    return result;
+}
+
+string Bitmap::serialize() const
+{
+    string data;
+    size_t last = 0;
+    for (const size_t bit : indices())
+    {
+        size_t delta = bit - last;
+        last = bit;
+        while (delta >= 0x80)
+        {
+            data += static_cast<char>((delta & 0x7FU) | 0x80U);
+            delta >>= 7U;
+        }
+        data += static_cast<char>(delta);
+    }
+
+    return data;
+}
+
+Bitmap Bitmap::deserialize(const string_view data)
+{
+    Bitmap bitmap;
+    size_t bit = 0;
+    size_t delta = 0;
+    unsigned int shift = 0;
+    for (const char c : data)
+    {
+        const auto byte = static_cast<unsigned char>(c);
+        delta |= static_cast<size_t>(byte & 0x7FU) << shift;
+        if ((byte & 0x80U) != 0)
+        {
+            shift += 7;
+            continue;
+        }
+        bit += delta;
+        bitmap.set(bit);
+        delta = 0;
+        shift = 0;
+    }
+
+    return bitmap;
+}
+
+void Bitmap::trim()
+{
+    while (!_words.empty() && _words.back() == 0)
+    {
+        _words.pop_back();
+    }
+}
+
+TagIndex::TagIndex(const EntryTable &entries)
+{
+    // Collect the rows per tag id first, to look up every name only once.
+    vector<Bitmap> bitmaps(entries.tag_count());
+    for (const EntryTable::row row : entries)
+    {
+        const EntryTable::tag_list tags = row.tags();
+        for (size_t i = 0; i < tags.size(); ++i)
+        {
+            bitmaps[tags.ids()[i]].set(row.index());
+        }
+    }
+
+    for (EntryTable::tag_id id = 0; id < bitmaps.size(); ++id)
+    {
+        add(bitmaps[id], entries.tag_name(id));
+    }
+}
+
+void TagIndex::add(const size_t id, const string_view tag)
+{
+    auto it = _tags.find(tag);
+    if (it == _tags.end())
+    {
+        it = _tags.emplace(tag, Bitmap()).first;
+        _folded[fold_case(tag)].emplace_back(tag);
+    }
+    it->second.set(id);
+}
+
+void TagIndex::add(const Bitmap &ids, const string_view tag)
+{
+    if (ids.none())
+    {
+        return;
+    }
+
+    auto it = _tags.find(tag);
+    if (it == _tags.end())
+    {
+        it = _tags.emplace(tag, Bitmap()).first;
+        _folded[fold_case(tag)].emplace_back(tag);
+    }
+    it->second |= ids;
+}
+
+void TagIndex::remove(const size_t id, const string_view tag)
+{
+    const auto it = _tags.find(tag);
+    if (it != _tags.end())
+    {
+        it->second.reset(id);
+        if (it->second.none())
+        {
+            const auto folded = _folded.find(fold_case(tag));
+            vector<string> &names = folded->second;
+            names.erase(std::find(names.begin(), names.end(), tag));
+            if (names.empty())
+            {
+                _folded.erase(folded);
+            }
+            _tags.erase(it);
+        }
+    }
+}
+
+const Bitmap *TagIndex::find(const string_view tag) const
+{
+    const auto it = _tags.find(tag);
+    if (it == _tags.end())
+    {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+Bitmap TagIndex::match(const vector<string> &tags_and, const bool is_re) const
+{
+    Bitmap result;
+    bool first = true;
+    for (const string &tag : tags_and)
+    {
+        Bitmap matches;
+        const auto add_matches = [this, &matches](const vector<string> &names)
+        {
+            for (const string &name : names)
+            {
+                matches |= _tags.find(name)->second;
+            }
+        };
+        if (is_re)
+        {
+            const RegEx re("^" + tag + "$");
+            for (const auto &[folded, names] : _folded)
+            {
+                if (re == folded)
+                {
+                    add_matches(names);
+                }
+            }
+        }
+        else
+        {
+            const auto it = _folded.find(tag);
+            if (it != _folded.end())
+            {
+                add_matches(it->second);
+            }
+        }
+
+        if (first)
+        {
+            result = matches;
+            first = false;
+        }
+        else
+        {
+            result &= matches;
+        }
+        if (result.none())
+        {
+            break;
+        }
+    }
+
+    return result;
+}
+
+const TagIndex::tagmap &TagIndex::tags() const
+{
+    return _tags;
+}
+} // namespace remwharead
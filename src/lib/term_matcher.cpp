@@ -0,0 +1,382 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "term_matcher.hpp"
+#include <Poco/Unicode.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace remwharead
+{
+using std::uint32_t;
+
+namespace
+{
+constexpr std::array<unsigned char, 128> make_ascii_lower()
+{
+    std::array<unsigned char, 128> table{};
+    for (size_t c = 0; c < table.size(); ++c)
+    {
+        table[c] = static_cast<unsigned char>(
+            c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+    return table;
+}
+constexpr std::array<unsigned char, 128> ascii_lower = make_ascii_lower();
+
+/*!
+ *  Decode the UTF-8 sequence at p.
+ *
+ *  @return Length of the sequence, 0 if it is invalid.
+ */
+size_t decode(const char *p, const char *end, int &codepoint)
+{
+    const auto lead = static_cast<unsigned char>(*p);
+    size_t len;
+    if ((lead & 0xE0U) == 0xC0U)
+    {
+        len = 2;
+        codepoint = lead & 0x1FU;
+    }
+    else if ((lead & 0xF0U) == 0xE0U)
+    {
+        len = 3;
+        codepoint = lead & 0x0FU;
+    }
+    else if ((lead & 0xF8U) == 0xF0U)
+    {
+        len = 4;
+        codepoint = lead & 0x07U;
+    }
+    else
+    {
+        return 0;
+    }
+    if (static_cast<size_t>(end - p) < len)
+    {
+        return 0;
+    }
+    for (size_t i = 1; i < len; ++i)
+    {
+        const auto byte = static_cast<unsigned char>(p[i]);
+        if ((byte & 0xC0U) != 0x80U)
+        {
+            return 0;
+        }
+        codepoint = (codepoint << 6) | (byte & 0x3F);
+    }
+
+    return len;
+}
+
+//! Encode codepoint as UTF-8, returns the length.
+size_t encode(const int codepoint, std::array<unsigned char, 4> &out)
+{
+    const auto cp = static_cast<uint32_t>(codepoint);
+    if (cp < 0x80)
+    {
+        out[0] = static_cast<unsigned char>(cp);
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        out[0] = static_cast<unsigned char>(0xC0U | (cp >> 6));
+        out[1] = static_cast<unsigned char>(0x80U | (cp & 0x3FU));
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        out[0] = static_cast<unsigned char>(0xE0U | (cp >> 12));
+        out[1] = static_cast<unsigned char>(0x80U | ((cp >> 6) & 0x3FU));
+        out[2] = static_cast<unsigned char>(0x80U | (cp & 0x3FU));
+        return 3;
+    }
+    out[0] = static_cast<unsigned char>(0xF0U | (cp >> 18));
+    out[1] = static_cast<unsigned char>(0x80U | ((cp >> 12) & 0x3FU));
+    out[2] = static_cast<unsigned char>(0x80U | ((cp >> 6) & 0x3FU));
+    out[3] = static_cast<unsigned char>(0x80U | (cp & 0x3FU));
+    return 4;
+}
+
+/*!
+ *  Convert the character at p to lowercase and advance p to the next one.
+ *
+ *  Bytes that are not UTF-8 are not changed.
+ *
+ *  @return The number of bytes written to out.
+ */
+size_t fold_char(const char *&p, const char *end,
+                 std::array<unsigned char, 4> &out)
+{
+    const auto byte = static_cast<unsigned char>(*p);
+    if (byte < 0x80)
+    {
+        out[0] = ascii_lower[byte];
+        ++p;
+        return 1;
+    }
+
+    int codepoint = 0;
+    const size_t len = decode(p, end, codepoint);
+    if (len == 0)
+    {
+        out[0] = byte;
+        ++p;
+        return 1;
+    }
+    p += len;
+
+    return encode(Poco::Unicode::toLower(codepoint), out);
+}
+} // namespace
+
+string fold_case(const string_view text)
+{
+    string folded(text);
+    size_t pos = 0;
+    for (; pos < folded.size(); ++pos)
+    {   // Most texts are mostly ASCII.
+        const auto byte = static_cast<unsigned char>(folded[pos]);
+        if (byte >= 0x80)
+        {
+            break;
+        }
+        folded[pos] = static_cast<char>(ascii_lower[byte]);
+    }
+    if (pos == folded.size())
+    {
+        return folded;
+    }
+
+    folded.resize(pos);
+    const char *p = text.data() + pos;
+    const char *const end = text.data() + text.size();
+    std::array<unsigned char, 4> buffer{};
+    while (p < end)
+    {
+        const size_t n = fold_char(p, end, buffer);
+        folded.append(reinterpret_cast<const char *>(buffer.data()), n);
+    }
+
+    return folded;
+}
+
+TermMatcher::TermMatcher(const vector<string> &terms)
+    : _n_terms{terms.size()}
+    , _skip{}
+{
+    std::fill(_skip.begin(), _skip.begin() + 0x80, true);
+
+    // Build the trie. State 0 is the root, 0 in _next means no edge.
+    _next.assign(256, 0);
+    vector<vector<uint32_t>> outputs(1);
+    for (size_t t = 0; t < terms.size(); ++t)
+    {
+        _lengths.push_back(terms[t].size());
+        if (terms[t].empty())
+        {
+            continue;
+        }
+
+        state current = 0;
+        for (const char c : terms[t])
+        {
+            const size_t edge = current * 256 + static_cast<unsigned char>(c);
+            if (_next[edge] == 0)
+            {
+                _next[edge] = static_cast<state>(outputs.size());
+                _next.resize(_next.size() + 256, 0);
+                outputs.emplace_back();
+            }
+            current = _next[edge];
+        }
+        outputs[current].push_back(static_cast<uint32_t>(t));
+
+        const auto first = static_cast<unsigned char>(terms[t].front());
+        for (size_t c = 0; c < ascii_lower.size(); ++c)
+        {
+            if (ascii_lower[c] == first)
+            {
+                _skip[c] = false;
+            }
+        }
+    }
+
+    // Add the failure transitions, breadth first, so that every byte leads
+    // to a state.
+    vector<state> fail(outputs.size(), 0);
+    vector<state> queue;
+    for (size_t c = 0; c < 256; ++c)
+    {
+        if (_next[c] != 0)
+        {
+            queue.push_back(_next[c]);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        const state current = queue[i];
+        for (size_t c = 0; c < 256; ++c)
+        {
+            state &next = _next[current * 256 + c];
+            const state fallback = _next[fail[current] * 256 + c];
+            if (next != 0)
+            {
+                fail[next] = fallback;
+                outputs[next].insert(outputs[next].end(),
+                                     outputs[fallback].begin(),
+                                     outputs[fallback].end());
+                queue.push_back(next);
+            }
+            else
+            {
+                next = fallback;
+            }
+        }
+    }
+
+    _output_offsets.reserve(outputs.size() + 1);
+    _output_offsets.push_back(0);
+    for (const vector<uint32_t> &output : outputs)
+    {
+        _outputs.insert(_outputs.end(), output.begin(), output.end());
+        _output_offsets.push_back(static_cast<uint32_t>(_outputs.size()));
+    }
+}
+
+template <bool lowercase, typename Function>
+void TermMatcher::scan(const string_view text, Function on_match) const
+{
+    state current = 0;
+    size_t pos = 0;
+    const auto feed = [&](const unsigned char byte)
+    {
+        current = _next[current * 256 + byte];
+        ++pos;
+        for (uint32_t i = _output_offsets[current];
+             i < _output_offsets[current + 1]; ++i)
+        {
+            if (!on_match(_outputs[i], pos))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const char *p = text.data();
+    const char *const end = p + text.size();
+    std::array<unsigned char, 4> folded{};
+    while (p < end)
+    {
+        if (current == 0)
+        {   // Nothing can start here, no need to look at the tables.
+            const char *const skipped = p;
+            while (p < end && _skip[static_cast<unsigned char>(*p)])
+            {
+                ++p;
+            }
+            pos += static_cast<size_t>(p - skipped);
+            if (p == end)
+            {
+                break;
+            }
+        }
+
+        if constexpr (lowercase)
+        {
+            if (!feed(static_cast<unsigned char>(*p++)))
+            {
+                return;
+            }
+        }
+        else
+        {
+            const size_t n = fold_char(p, end, folded);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!feed(folded[i]))
+                {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void TermMatcher::count(const string_view text, vector<unsigned> &counts,
+                        const bool lowercase) const
+{
+    counts.assign(_n_terms, 0);
+    // Where the next occurrence of every term may start.
+    thread_local vector<size_t> next_start;
+    next_start.assign(_n_terms, 0);
+
+    const auto on_match = [&](const uint32_t term, const size_t end)
+    {
+        if (end - _lengths[term] >= next_start[term])
+        {
+            ++counts[term];
+            next_start[term] = end;
+        }
+        return true;
+    };
+    if (lowercase)
+    {
+        scan<true>(text, on_match);
+    }
+    else
+    {
+        scan<false>(text, on_match);
+    }
+}
+
+void TermMatcher::find(const string_view text, vector<bool> &found,
+                       const bool lowercase) const
+{
+    found.assign(_n_terms, false);
+    auto missing = static_cast<size_t>(
+        std::count_if(_lengths.begin(), _lengths.end(),
+                      [](const size_t length) { return length != 0; }));
+    if (missing == 0)
+    {
+        return;
+    }
+
+    const auto on_match = [&](const uint32_t term, const size_t)
+    {
+        if (!found[term])
+        {
+            found[term] = true;
+            --missing;
+        }
+        return missing != 0;
+    };
+    if (lowercase)
+    {
+        scan<true>(text, on_match);
+    }
+    else
+    {
+        scan<false>(text, on_match);
+    }
+}
+
+size_t TermMatcher::size() const
+{
+    return _n_terms;
+}
+} // namespace remwharead
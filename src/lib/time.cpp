@@ -15,52 +15,230 @@
  */
 
 #include "time.hpp"
-#include "sqlite.hpp"
 #include <array>
 #include <cstdint>
 #include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <limits>
+#include <optional>
 
 namespace remwharead
 {
 using std::array;
+using std::int64_t;
+using std::optional;
+using std::time_t;
 
-time_point string_to_timepoint(const string &strtime, bool sqlite)
+namespace
 {
-    std::stringstream sstime(strtime);
-    struct std::tm tm = {};
-    tm.tm_isdst = -1;           // Don't convert to/from daylight saving time.
-    if (sqlite)
+constexpr int64_t seconds_per_day = 86400;
+
+//! Division that rounds towards negative infinity.
+constexpr int64_t floor_div(const int64_t a, const int64_t b)
+{
+    return (a >= 0 ? a : a - b + 1) / b;
+}
+
+//! Days since 1970-01-01 from year, month and day. (Howard Hinnant)
+constexpr int64_t days_from_civil(int64_t y, const unsigned m, const unsigned d)
+{
+    y -= static_cast<int64_t>(m <= 2);
+    const int64_t era = floor_div(y, 400);
+    const auto yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+//! Year, month and day from days since 1970-01-01. (Howard Hinnant)
+struct civil_date
+{
+    int64_t year;
+    unsigned month;
+    unsigned day;
+};
+constexpr civil_date civil_from_days(int64_t z)
+{
+    z += 719468;
+    const int64_t era = floor_div(z, 146097);
+    const auto doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return {static_cast<int64_t>(yoe) + era * 400 + (m <= 2 ? 1 : 0), m, d};
+}
+
+/*!
+ *  @brief  Returns the offset of local time to UTC in seconds for the day of
+ *          time, if it is the same during the whole day.
+ *
+ *  The result is cached per thread, so that localtime_r() has to be called
+ *  only twice per day.
+ */
+optional<int64_t> day_utc_offset(const time_t time)
+{
+    struct cache
     {
-        sstime >> std::get_time(&tm, "%Y-%m-%d %T");
+        int64_t day = std::numeric_limits<int64_t>::min();
+        optional<int64_t> offset;
+    };
+    thread_local cache cached;
+    // Read the time zone once, localtime_r() is not required to do it.
+    static const bool tz_initialized = (tzset(), true);
+    static_cast<void>(tz_initialized);
+
+    const int64_t day = floor_div(time, seconds_per_day);
+    if (day != cached.day)
+    {
+        const time_t day_start = day * seconds_per_day;
+        const time_t day_end = day_start + seconds_per_day - 1;
+        std::tm tm_start = {};
+        std::tm tm_end = {};
+        localtime_r(&day_start, &tm_start);
+        localtime_r(&day_end, &tm_end);
+
+        cached.day = day;
+        cached.offset.reset();
+        if (tm_start.tm_gmtoff == tm_end.tm_gmtoff)
+        {
+            cached.offset = tm_start.tm_gmtoff;
+        }
     }
-    else
+
+    return cached.offset;
+}
+
+//! Parses exactly n digits at pos and advances pos. Returns -1 on failure.
+int parse_digits(const string_view str, size_t &pos, const size_t n)
+{
+    if (pos + n > str.size())
     {
-        sstime >> std::get_time(&tm, "%Y-%m-%dT%T");
+        return -1;
     }
-    std::time_t time = mktime(&tm);
-    return system_clock::from_time_t(time);
+
+    int value = 0;
+    for (size_t i = pos; i < pos + n; ++i)
+    {
+        const char c = str[i];
+        if (c < '0' || c > '9')
+        {
+            return -1;
+        }
+        value = value * 10 + (c - '0');
+    }
+    pos += n;
+
+    return value;
 }
 
-string timepoint_to_string(const time_point &tp, bool sqlite)
+//! Writes value as 2 digits to buffer at pos.
+void put_digits(timestring_buffer &buffer, const size_t pos, const int value)
 {
-    constexpr std::uint16_t bufsize = 32;
-    std::time_t time = system_clock::to_time_t(tp);
-    std::tm *tm;
-    tm = std::localtime(&time);
+    buffer[pos] = static_cast<char>('0' + value / 10);
+    buffer[pos + 1] = static_cast<char>('0' + value % 10);
+}
+} // namespace
 
-    array<char, bufsize> buffer = {};
+time_point string_to_timepoint(const string_view strtime, bool /*sqlite*/)
+{
+    // YYYY-MM-DD[Thh:mm[:ss]] or YYYY-MM-DD[ hh:mm[:ss]].
+    array<int, 6> fields = {0, 1, 1, 0, 0, 0};
+    constexpr array<size_t, 6> widths = {4, 2, 2, 2, 2, 2};
+    constexpr array<char, 6> separators = {'\0', '-', '-', 'T', ':', ':'};
+    size_t pos = 0;
+    for (size_t i = 0; i < fields.size(); ++i)
+    {
+        if (i != 0)
+        {
+            if (pos >= strtime.size()
+                || (strtime[pos] != separators[i]
+                    && !(i == 3 && strtime[pos] == ' ')))
+            {
+                break;
+            }
+            ++pos;
+        }
+
+        const int value = parse_digits(strtime, pos, widths[i]);
+        if (value < 0)
+        {
+            break;
+        }
+        fields[i] = value;
+    }
 
-    if (sqlite)
+    const time_t local = days_from_civil(fields[0],
+                                          static_cast<unsigned>(fields[1]),
+                                          static_cast<unsigned>(fields[2]))
+        * seconds_per_day
+        + fields[3] * 3600 + fields[4] * 60 + fields[5];
+
+    // The offset of the local day is a good guess for the offset of the UTC
+    // day. If they are the same, the guess was right.
+    const optional<int64_t> offset = day_utc_offset(local);
+    if (offset && day_utc_offset(local - *offset) == offset)
     {
-        std::strftime(buffer.begin(), bufsize, "%F %T", tm);
+        return system_clock::from_time_t(local - *offset);
     }
-    else
+
+    // Daylight saving time changes around this time, let mktime() decide.
+    std::tm tm = {};
+    tm.tm_year = fields[0] - 1900;
+    tm.tm_mon = fields[1] - 1;
+    tm.tm_mday = fields[2];
+    tm.tm_hour = fields[3];
+    tm.tm_min = fields[4];
+    tm.tm_sec = fields[5];
+    tm.tm_isdst = -1;
+    return system_clock::from_time_t(mktime(&tm));
+}
+
+string_view timepoint_to_chars(const time_point &tp, timestring_buffer &buffer,
+                               const bool sqlite)
+{
+    const time_t time = system_clock::to_time_t(tp);
+    std::tm tm = {};
+    optional<int64_t> offset = day_utc_offset(time);
+    if (!offset)
     {
-        std::strftime(buffer.begin(), bufsize, "%FT%T", tm);
+        localtime_r(&time, &tm);
+        offset = tm.tm_gmtoff;
+    }
+    const int64_t local = time + *offset;
+    const int64_t days = floor_div(local, seconds_per_day);
+    const auto seconds = static_cast<int>(local - days * seconds_per_day);
+    const civil_date date = civil_from_days(days);
+
+    if (date.year < 0 || date.year > 9999)
+    {   // Not representable with 4 digits, let strftime() handle it.
+        localtime_r(&time, &tm);
+        const size_t len = std::strftime(buffer.data(), buffer.size(),
+                                         sqlite ? "%F %T" : "%FT%T", &tm);
+        return {buffer.data(), len};
     }
 
-    return buffer.begin();
+    const auto year = static_cast<int>(date.year);
+    put_digits(buffer, 0, year / 100);
+    put_digits(buffer, 2, year % 100);
+    buffer[4] = '-';
+    put_digits(buffer, 5, static_cast<int>(date.month));
+    buffer[7] = '-';
+    put_digits(buffer, 8, static_cast<int>(date.day));
+    buffer[10] = sqlite ? ' ' : 'T';
+    put_digits(buffer, 11, seconds / 3600);
+    buffer[13] = ':';
+    put_digits(buffer, 14, seconds / 60 % 60);
+    buffer[16] = ':';
+    put_digits(buffer, 17, seconds % 60);
+    buffer[19] = '\0';
+
+    return {buffer.data(), 19};
+}
+
+string timepoint_to_string(const time_point &tp, bool sqlite)
+{
+    timestring_buffer buffer;
+    return string(timepoint_to_chars(tp, buffer, sqlite));
 }
 } // namespace remwharead
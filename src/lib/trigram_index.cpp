@@ -0,0 +1,551 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trigram_index.hpp"
+#include "term_matcher.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace remwharead
+{
+using std::uint32_t;
+using std::uint64_t;
+
+namespace
+{
+//! The memory of an index that was built, not mapped.
+struct storage
+{
+    vector<uint32_t> trigrams;
+    vector<uint64_t> offsets;
+    string postings;
+};
+
+//! Call f with every trigram of text.
+template <typename F>
+void for_each_trigram(const string_view text, const F &f)
+{
+    for (size_t i = 0; i + 2 < text.size(); ++i)
+    {
+        f(static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16U
+          | static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1]))
+          << 8U
+          | static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+}
+
+//! What a text has to contain to match a regular expression.
+struct requirement
+{
+    //! All of these trigrams.
+    vector<uint32_t> trigrams;
+    //! At least one alternative of every element.
+    vector<vector<requirement>> either;
+
+    [[nodiscard]] bool empty() const
+    {
+        return trigrams.empty() && either.empty();
+    }
+
+    void add(requirement other)
+    {
+        trigrams.insert(trigrams.end(), other.trigrams.begin(),
+                        other.trigrams.end());
+        for (vector<requirement> &alternatives : other.either)
+        {
+            either.push_back(std::move(alternatives));
+        }
+    }
+};
+
+/*!
+ *  Finds the literal text in a regular expression that every match
+ *  contains.
+ *
+ *  Everything that is not understood ends the current literal text. Optional
+ *  parts are ignored. If the regular expression uses features that change
+ *  the meaning of literal text, nothing is required.
+ */
+class analyzer
+{
+public:
+    explicit analyzer(const string_view regex)
+        : _re{regex}
+    {}
+
+    requirement analyze()
+    {
+        requirement result = alternation();
+        if (_give_up || _pos != _re.size())
+        {
+            return {};
+        }
+
+        return result;
+    }
+
+private:
+    enum class repeat
+    {
+        once,
+        optional,
+        many
+    };
+
+    const string_view _re;
+    size_t _pos{0};
+    bool _give_up{false};
+
+    [[nodiscard]] bool at(const char c) const
+    {
+        return _pos < _re.size() && _re[_pos] == c;
+    }
+
+    requirement alternation()
+    {
+        vector<requirement> alternatives;
+        alternatives.push_back(sequence());
+        while (at('|') && !_give_up)
+        {
+            ++_pos;
+            alternatives.push_back(sequence());
+        }
+
+        if (alternatives.size() == 1)
+        {
+            return std::move(alternatives.front());
+        }
+        if (std::any_of(alternatives.begin(), alternatives.end(),
+                        [](const requirement &r) { return r.empty(); }))
+        {
+            return {};
+        }
+        requirement result;
+        result.either.push_back(std::move(alternatives));
+        return result;
+    }
+
+    requirement sequence()
+    {
+        requirement result;
+        string literal;
+        const auto end_literal = [&result, &literal]
+        {
+            for_each_trigram(literal, [&result](const uint32_t trigram)
+            {
+                result.trigrams.push_back(trigram);
+            });
+            literal.clear();
+        };
+
+        while (_pos < _re.size() && !at('|') && !at(')') && !_give_up)
+        {
+            const char c = _re[_pos];
+            switch (c)
+            {
+            case '(':
+            {
+                end_literal();
+                ++_pos;
+                if (_re.compare(_pos, 2, "?:") == 0)
+                {
+                    _pos += 2;
+                }
+                else if (at('?') || at('*'))
+                {   // Options, lookarounds and verbs.
+                    _give_up = true;
+                    break;
+                }
+                requirement group = alternation();
+                if (!at(')'))
+                {
+                    _give_up = true;
+                    break;
+                }
+                ++_pos;
+                if (quantifier() != repeat::optional)
+                {
+                    result.add(std::move(group));
+                }
+                break;
+            }
+            case '[':
+            {
+                end_literal();
+                skip_class();
+                quantifier();
+                break;
+            }
+            case '\\':
+            {
+                if (_pos + 1 == _re.size())
+                {
+                    _give_up = true;
+                    break;
+                }
+                const char next = _re[_pos + 1];
+                if (is_alnum(next))
+                {   // Classes, anchors and special characters.
+                    if (string_view("QEcxopPNgk0123456789").find(next)
+                        != string_view::npos)
+                    {   // Longer than 2 characters.
+                        _give_up = true;
+                        break;
+                    }
+                    end_literal();
+                    _pos += 2;
+                    quantifier();
+                    break;
+                }
+                ++_pos;
+                add_char(literal, end_literal);
+                break;
+            }
+            case '.':
+            case '^':
+            case '$':
+            case '{':
+            {
+                end_literal();
+                ++_pos;
+                quantifier();
+                break;
+            }
+            case '*':
+            case '+':
+            case '?':
+            {   // Nothing to repeat.
+                _give_up = true;
+                break;
+            }
+            default:
+            {
+                add_char(literal, end_literal);
+                break;
+            }
+            }
+        }
+        end_literal();
+
+        return result;
+    }
+
+    static bool is_alnum(const char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9');
+    }
+
+    //! Add the character at _pos to literal, if it is not optional.
+    template <typename F>
+    void add_char(string &literal, const F &end_literal)
+    {
+        // A multibyte character is repeated as a whole.
+        size_t len = 1;
+        while (_pos + len < _re.size()
+               && (static_cast<unsigned char>(_re[_pos + len]) & 0xC0U)
+               == 0x80U)
+        {
+            ++len;
+        }
+        const string_view character = _re.substr(_pos, len);
+        _pos += len;
+
+        switch (quantifier())
+        {
+        case repeat::once:
+        {
+            literal += character;
+            break;
+        }
+        case repeat::optional:
+        {
+            end_literal();
+            break;
+        }
+        case repeat::many:
+        {   // "ab+c" contains "ab" and "bc".
+            literal += character;
+            end_literal();
+            literal = character;
+            break;
+        }
+        }
+    }
+
+    //! Skip a quantifier and return how often the atom before is repeated.
+    repeat quantifier()
+    {
+        repeat result = repeat::once;
+        if (at('*') || at('?'))
+        {
+            result = repeat::optional;
+            ++_pos;
+        }
+        else if (at('+'))
+        {
+            result = repeat::many;
+            ++_pos;
+        }
+        else if (at('{'))
+        {   // {n}, {n,} or {n,m}, anything else is literal text.
+            size_t end = _pos + 1;
+            while (end < _re.size() && _re[end] >= '0' && _re[end] <= '9')
+            {
+                ++end;
+            }
+            if (end == _pos + 1)
+            {
+                return result;
+            }
+            const bool zero = _re.find_first_not_of('0', _pos + 1) == end;
+            if (end < _re.size() && _re[end] == ',')
+            {
+                ++end;
+                while (end < _re.size() && _re[end] >= '0' && _re[end] <= '9')
+                {
+                    ++end;
+                }
+            }
+            if (end == _re.size() || _re[end] != '}')
+            {
+                return result;
+            }
+            _pos = end + 1;
+            result = zero ? repeat::optional : repeat::many;
+        }
+        else
+        {
+            return result;
+        }
+
+        if (at('?') || at('+'))
+        {   // Lazy or possessive.
+            ++_pos;
+        }
+        return result;
+    }
+
+    void skip_class()
+    {
+        ++_pos;
+        if (at('^'))
+        {
+            ++_pos;
+        }
+        if (at(']'))
+        {   // A ] at the start is literal.
+            ++_pos;
+        }
+        while (_pos < _re.size() && !at(']'))
+        {
+            if (at('\\'))
+            {
+                ++_pos;
+            }
+            else if (_re.compare(_pos, 2, "[:") == 0)
+            {
+                const size_t end = _re.find(":]", _pos + 2);
+                if (end != string_view::npos)
+                {
+                    _pos = end + 1;
+                }
+            }
+            ++_pos;
+        }
+        if (!at(']'))
+        {
+            _give_up = true;
+            return;
+        }
+        ++_pos;
+    }
+};
+} // namespace
+
+void TrigramIndex::builder::add(const vector<string_view> &texts)
+{
+    _row.clear();
+    for (const string_view text : texts)
+    {
+        for_each_trigram(text, [this](const uint32_t trigram)
+        {
+            _row.push_back(trigram);
+        });
+    }
+    std::sort(_row.begin(), _row.end());
+    _row.erase(std::unique(_row.begin(), _row.end()), _row.end());
+
+    for (const uint32_t trigram : _row)
+    {
+        postings &rows = _postings[trigram];
+        uint32_t delta = _rows - rows.last;
+        rows.last = _rows;
+        while (delta >= 0x80)
+        {
+            rows.data += static_cast<char>((delta & 0x7FU) | 0x80U);
+            delta >>= 7U;
+        }
+        rows.data += static_cast<char>(delta);
+    }
+    ++_rows;
+}
+
+void TrigramIndex::builder::add(const TrigramIndex &index)
+{
+    if (_rows != 0)
+    {
+        throw std::logic_error("Index has to be added first.");
+    }
+
+    for (size_t i = 0; i < index._n_trigrams; ++i)
+    {
+        postings &rows = _postings[index._trigrams[i]];
+        rows.data.assign(index._postings + index._offsets[i],
+                         index._offsets[i + 1] - index._offsets[i]);
+
+        // The deltas add up to the last row.
+        uint32_t delta = 0;
+        unsigned int shift = 0;
+        for (const char c : rows.data)
+        {
+            const auto byte = static_cast<unsigned char>(c);
+            delta |= static_cast<uint32_t>(byte & 0x7FU) << shift;
+            if ((byte & 0x80U) != 0)
+            {
+                shift += 7;
+                continue;
+            }
+            rows.last += delta;
+            delta = 0;
+            shift = 0;
+        }
+    }
+    _rows = static_cast<uint32_t>(index._rows);
+}
+
+TrigramIndex TrigramIndex::builder::finish()
+{
+    auto memory = std::make_shared<storage>();
+    memory->trigrams.reserve(_postings.size());
+    for (const auto &trigram : _postings)
+    {
+        memory->trigrams.push_back(trigram.first);
+    }
+    std::sort(memory->trigrams.begin(), memory->trigrams.end());
+
+    memory->offsets.reserve(_postings.size() + 1);
+    memory->offsets.push_back(0);
+    for (const uint32_t trigram : memory->trigrams)
+    {
+        memory->postings += _postings[trigram].data;
+        memory->offsets.push_back(memory->postings.size());
+    }
+
+    TrigramIndex index;
+    index._rows = _rows;
+    index._n_trigrams = memory->trigrams.size();
+    index._trigrams = memory->trigrams.data();
+    index._offsets = memory->offsets.data();
+    index._postings = memory->postings.data();
+    index._memory = std::move(memory);
+    _postings.clear();
+    _rows = 0;
+
+    return index;
+}
+
+TrigramIndex::TrigramIndex(const EntryTable &entries)
+{
+    builder trigrams;
+    for (const EntryTable::row row : entries)
+    {
+        const string uri = fold_case(row.uri());
+        if (entries.has_folded())
+        {
+            trigrams.add({uri, row.folded_title(), row.folded_description(),
+                          row.folded_fulltext()});
+        }
+        else
+        {
+            trigrams.add({uri, fold_case(row.title()),
+                          fold_case(row.description()),
+                          fold_case(row.fulltext())});
+        }
+    }
+    *this = trigrams.finish();
+}
+
+Bitmap TrigramIndex::narrow(const Bitmap &candidates,
+                            const string_view regex) const
+{
+    if (!_memory)
+    {
+        return candidates;
+    }
+
+    const std::function<Bitmap(const requirement &, Bitmap)> apply
+        = [this, &apply](const requirement &needed, Bitmap result)
+    {
+        for (const uint32_t trigram : needed.trigrams)
+        {
+            if (result.none())
+            {
+                return result;
+            }
+            result &= find(trigram);
+        }
+        for (const vector<requirement> &alternatives : needed.either)
+        {
+            Bitmap any;
+            for (const requirement &alternative : alternatives)
+            {
+                any |= apply(alternative, result);
+            }
+            result = std::move(any);
+        }
+        return result;
+    };
+
+    return apply(analyzer(regex).analyze(), candidates);
+}
+
+size_t TrigramIndex::size() const
+{
+    return _rows;
+}
+
+size_t TrigramIndex::trigram_count() const
+{
+    return _n_trigrams;
+}
+
+Bitmap TrigramIndex::find(const uint32_t trigram) const
+{
+    const uint32_t *end = _trigrams + _n_trigrams;
+    const uint32_t *it = std::lower_bound(_trigrams, end, trigram);
+    if (it == end || *it != trigram)
+    {
+        return {};
+    }
+
+    const auto i = static_cast<size_t>(it - _trigrams);
+    return Bitmap::deserialize(string_view(_postings + _offsets[i],
+                                           _offsets[i + 1] - _offsets[i]));
+}
+} // namespace remwharead
@@ -17,20 +17,31 @@
 #include "uri.hpp"
 
 #include "curl_wrapper.hpp"
+#include "main_content.hpp"
 #include "version.hpp"
 
 #include <Poco/RegularExpression.h>
 #include <boost/locale.hpp>
 
+#ifdef REMWHAREAD_WITH_POPPLER
+#include <poppler-document.h>
+#include <poppler-page.h>
+#endif
+
+#include <algorithm>
 #include <atomic>
+#include <cctype>
 #include <codecvt>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <iostream>
 #include <iterator>
 #include <locale>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -39,11 +50,28 @@ namespace remwharead
 using std::array;
 using std::exception;
 using std::move;
+using std::string_view;
 using std::to_string;
 using std::uint32_t;
 using std::vector;
 using RegEx = Poco::RegularExpression;
 
+namespace
+{
+/*!
+ *  @brief  Returns the user's locale with the Boost.Locale facets.
+ *
+ *  Generating it is expensive, so it is done once. The global locale is left
+ *  alone.
+ */
+const std::locale &boost_locale()
+{
+    // Initialization of static local variables is thread-safe.
+    static const std::locale loc{boost::locale::generator{}("")};
+    return loc;
+}
+} // namespace
+
 html_extract::operator bool() const
 {
     return successful;
@@ -56,37 +84,374 @@ archive_answer::operator bool() const
 
 URI::URI(string uri)
     : _uri(move(uri))
-{
-    // FIXME: Only call locale-stuff once after getting rid of POCO.
-    // Set global locale with Boost extras. Needed for Boost functions.
-    // Uhm… I don't remember what I meant with the above. 🤦
-    const boost::locale::generator locgen;
-    const std::locale loc = locgen("");
-    std::locale::global(loc);
-}
+{}
 
-html_extract URI::get()
+html_extract URI::get(const bool main_content)
 {
     using namespace curl_wrapper;
 
     try
     {
         CURLWrapper curl;
-        _document = to_utf8(
-            curl.make_http_request(http_method::GET, _uri).body);
+        CURL *handle{curl.get_curl_easy_handle()};
+        download state{this, handle, {}};
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_document);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &state);
+        _document.clear();
+
+        string type_header;
+        try
+        {
+            const auto response{
+                curl.make_http_request(http_method::GET, _uri)};
+            type_header = content_type(response.headers);
+        }
+        catch (const CURLException &e)
+        {
+            if (!(state.stopped && e.error_code == CURLE_WRITE_ERROR))
+            {
+                throw;
+            }
+            type_header = state.content_type;
+        }
+        if (_document.empty())
+        {
+            return {false, "Unknown error.", "", "", "", ""};
+        }
+
+        const document_type type{detect_type(type_header)};
+        if (type != document_type::pdf && type != document_type::binary)
+        {
+            detect_encoding(type_header);
+            _document = to_utf8(move(_document));
+        }
 
-        if (!_document.empty())
+        html_extract page;
+        switch (type)
         {
-            return {true, "", extract_title(), extract_description(),
-                    strip_html()};
+        case document_type::html:
+        {
+            page = extract_html(main_content);
+            break;
+        }
+        case document_type::text:
+        {
+            page = extract_text();
+            break;
         }
+        case document_type::xml:
+        {
+            page = extract_xml();
+            break;
+        }
+        case document_type::pdf:
+        {
+            page = extract_pdf();
+            break;
+        }
+        case document_type::binary:
+        {   // Nothing to extract, only the URI is stored.
+            page.successful = true;
+            break;
+        }
+        }
+
+        cut_bytes(page.fulltext, max_text_size);
+        cut_bytes(page.page_text, max_text_size);
+        return page;
     }
     catch (const exception &e)
     {
-        return {false, e.what(), "", "", ""};
+        return {false, e.what(), "", "", "", ""};
+    }
+}
+
+size_t URI::write_document(char *data, const size_t size, const size_t nmemb,
+                           void *state)
+{
+    auto &download_state{*static_cast<download *>(state)};
+    URI &uri{*download_state.uri};
+    uri._document.append(data, size * nmemb);
+
+    if (uri._document.size() > max_document_size)
+    {   // Cut the document, the text would be cut anyway. A split UTF-8
+        // sequence would make detect_encoding() guess windows-1252.
+        cut_bytes(uri._document, max_document_size);
+        download_state.stopped = true;
+        return 0;
+    }
+    if (!download_state.type_known)
+    {
+        if (download_state.content_type.empty()
+            && download_state.curl != nullptr)
+        {
+            char *type{nullptr};
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+            curl_easy_getinfo(download_state.curl, CURLINFO_CONTENT_TYPE,
+                              &type);
+            download_state.content_type = (type != nullptr ? type : "");
+        }
+        // Without Content-Type, the type is guessed from the first 1024
+        // bytes, a 0 byte in them means binary.
+        if (uri.detect_type(download_state.content_type)
+            == document_type::binary)
+        {
+            download_state.stopped = true;
+            return 0;
+        }
+        download_state.type_known = (uri._document.size() >= 1024);
+    }
+
+    return size * nmemb;
+}
+
+URI::document_type URI::detect_type(const string_view content_type) const
+{
+    string media_type{content_type.substr(0, content_type.find(';'))};
+    media_type.erase(media_type.find_last_not_of(" \t") + 1);
+    media_type = boost::locale::to_lower(media_type, boost_locale());
+    const auto ends_with = [&media_type](const string_view suffix)
+    {
+        return (media_type.size() >= suffix.size()
+                && media_type.compare(media_type.size() - suffix.size(),
+                                      suffix.size(), suffix) == 0);
+    };
+
+    if (media_type == "text/html" || media_type == "application/xhtml+xml")
+    {
+        return document_type::html;
+    }
+    if (media_type == "application/pdf")
+    {
+        return document_type::pdf;
+    }
+    if (media_type == "application/xml" || media_type == "text/xml"
+        || ends_with("+xml"))
+    {
+        return document_type::xml;
+    }
+    if (media_type.compare(0, 5, "text/") == 0
+        || media_type == "application/json" || ends_with("+json")
+        || media_type == "application/javascript")
+    {
+        return document_type::text;
+    }
+    if (!media_type.empty() && media_type != "application/octet-stream")
+    {   // Images, videos, archives and the like.
+        return document_type::binary;
+    }
+
+    // The server doesn't know, look at the beginning of the document.
+    string start{_document.substr(0, 1024)};
+    if (start.compare(0, 5, "%PDF-") == 0)
+    {
+        return document_type::pdf;
+    }
+    if (start.find('\0') != string::npos)
+    {
+        return document_type::binary;
+    }
+    start = boost::locale::to_lower(start, boost_locale());
+    for (const string_view tag : {"<!doctype html", "<html", "<head", "<body"})
+    {
+        if (start.find(tag) != string::npos)
+        {
+            return document_type::html;
+        }
+    }
+    for (const string_view tag : {"<?xml", "<rss", "<feed"})
+    {
+        if (start.find(tag) != string::npos)
+        {
+            return document_type::xml;
+        }
+    }
+
+    return document_type::text;
+}
+
+html_extract URI::extract_html(const bool main_content) const
+{
+    string fulltext{strip_html()};
+    string page_text;
+    if (main_content)
+    {
+        string content{unescape_html(extract_main_content(_document))};
+        if (!content.empty())
+        {
+            page_text = move(fulltext);
+            fulltext = move(content);
+        }
+    }
+
+    return {true, "", extract_title(), extract_description(),
+            move(fulltext), move(page_text)};
+}
+
+html_extract URI::extract_text() const
+{
+    string fulltext{_document};
+    normalize_whitespace(fulltext);
+
+    // The first line is the title, if there is one.
+    const size_t start{fulltext.find_first_not_of(" \t\n\v\f")};
+    string title;
+    if (start != string::npos)
+    {
+        title = cut_text(fulltext.substr(start, fulltext.find('\n', start)
+                                         - start),
+                         100);
+    }
+
+    return {true, "", move(title), "", move(fulltext), ""};
+}
+
+html_extract URI::extract_xml() const
+{
+    // Atom feeds use subtitle or summary instead of description.
+    string description{xml_element_text(_document, "description")};
+    for (const string_view name : {"subtitle", "summary"})
+    {
+        if (description.empty())
+        {
+            description = xml_element_text(_document, name);
+        }
+    }
+
+    return {true, "", remove_newlines(xml_element_text(_document, "title")),
+            cut_text(remove_newlines(description), 500),
+            xml_to_text(_document), ""};
+}
+
+html_extract URI::extract_pdf() const
+{
+    html_extract page;
+    page.successful = true;
+
+#ifdef REMWHAREAD_WITH_POPPLER
+    const auto to_string = [](const poppler::ustring &text)
+    {
+        const poppler::byte_array utf8{text.to_utf8()};
+        return string(utf8.begin(), utf8.end());
+    };
+
+    const std::unique_ptr<poppler::document> document{
+        poppler::document::load_from_raw_data(
+            _document.data(), static_cast<int>(_document.size()))};
+    if (!document || document->is_locked())
+    {
+        return page;
+    }
+
+    page.title = remove_newlines(to_string(document->info_key("Title")));
+    page.description = cut_text(
+        remove_newlines(to_string(document->info_key("Subject"))), 500);
+    for (int number = 0; number < document->pages(); ++number)
+    {
+        const std::unique_ptr<poppler::page> pdf_page{
+            document->create_page(number)};
+        if (pdf_page)
+        {
+            page.fulltext += to_string(pdf_page->text());
+            page.fulltext += '\n';
+        }
+        if (page.fulltext.size() > max_text_size)
+        {
+            break;
+        }
     }
+    normalize_whitespace(page.fulltext);
+#endif
 
-    return {false, "Unknown error.", "", "", ""};
+    return page;
+}
+
+string URI::xml_element_text(const string_view xml, const string_view name)
+{
+    const string opening{"<" + string(name)};
+    const string closing{"</" + string(name) + ">"};
+    size_t pos{0};
+    while ((pos = xml.find(opening, pos)) != string_view::npos)
+    {
+        pos += opening.size();
+        if (pos < xml.size() && (xml[pos] == '>' || xml[pos] == ' '))
+        {
+            break;
+        }
+    }
+    if (pos == string_view::npos || (pos = xml.find('>', pos)) == string::npos)
+    {
+        return "";
+    }
+    ++pos;
+    const size_t end{xml.find(closing, pos)};
+    if (end == string_view::npos)
+    {
+        return "";
+    }
+
+    return xml_to_text(xml.substr(pos, end - pos));
+}
+
+string URI::xml_to_text(const string_view xml)
+{
+    // Elements are replaced with line breaks. CDATA sections contain text
+    // that is not escaped, usually HTML.
+    constexpr string_view cdata_start{"<![CDATA["};
+    constexpr string_view cdata_end{"]]>"};
+    string text;
+    text.reserve(xml.size());
+    size_t pos{0};
+    while (pos < xml.size())
+    {
+        const size_t start{std::min(xml.find('<', pos), xml.size())};
+        text.append(xml.substr(pos, start - pos));
+        if (start == xml.size())
+        {
+            break;
+        }
+
+        if (xml.compare(start, cdata_start.size(), cdata_start) == 0)
+        {
+            pos = start + cdata_start.size();
+            const size_t end{std::min(xml.find(cdata_end, pos), xml.size())};
+            text.append(xml.substr(pos, end - pos));
+            pos = std::min(end + cdata_end.size(), xml.size());
+        }
+        else
+        {
+            text += '\n';
+            pos = std::min(xml.find('>', start), xml.size() - 1) + 1;
+        }
+    }
+
+    // Escaped HTML is unescaped first and then removed.
+    text = unescape_html(text);
+    text = remove_html_tags(remove_html_tags(text, "script"), "style");
+    text = unescape_html(remove_html_tags(text));
+    normalize_whitespace(text);
+    text.erase(0, text.find_first_not_of(" \t\n"));
+    text.erase(text.find_last_not_of(" \t\n") + 1);
+
+    return text;
+}
+
+void URI::cut_bytes(string &text, size_t n_bytes)
+{
+    if (text.size() <= n_bytes)
+    {
+        return;
+    }
+
+    // Don't cut UTF-8 sequences.
+    while (n_bytes > 0
+           && (static_cast<unsigned char>(text[n_bytes]) & 0xC0U) == 0x80)
+    {
+        --n_bytes;
+    }
+    text.resize(n_bytes);
 }
 
 string URI::extract_title() const
@@ -129,16 +494,7 @@ string URI::strip_html() const
     out = remove_html_tags(_document, "script"); // Remove JavaScript.
     out = remove_html_tags(out, "style");        // Remove CSS.
     out = remove_html_tags(out);                 // Remove tags.
-
-    size_t pos = 0;
-    while ((pos = out.find('\r', pos)) != std::string::npos) // Remove CR.
-    {
-        out.replace(pos, 1, "");
-    }
-
-    // Remove whitespace at eol.
-    RegEx("\\s+\n").subst(out, "\n", RegEx::RE_GLOBAL);
-    RegEx("\n{2,}").subst(out, "\n", RegEx::RE_GLOBAL); // Reduce newlines.
+    normalize_whitespace(out);
 
     return unescape_html(out);
 }
@@ -147,6 +503,7 @@ string URI::remove_html_tags(const string &html, const string &tag)
 {
     // NOTE: I did this with regex_replace before, but libstdc++ segfaulted.
     string out;
+    out.reserve(html.size());
     if (tag.empty())
     {
         size_t pos = 0;
@@ -154,7 +511,7 @@ string URI::remove_html_tags(const string &html, const string &tag)
         {
             size_t startpos = html.find('<', pos);
             size_t endpos = html.find('>', startpos);
-            out += html.substr(pos, startpos - pos);
+            out.append(html, pos, startpos - pos);
             pos = endpos;
             if (pos != std::string::npos)
             {
@@ -164,23 +521,101 @@ string URI::remove_html_tags(const string &html, const string &tag)
     }
     else
     {
+        const string opening{"<" + tag};
+        const string closing{"</" + tag};
         size_t pos = 0;
-        out = html;
-        while ((pos = out.find("<" + tag)) != std::string::npos)
+        size_t startpos;
+        while ((startpos = html.find(opening, pos)) != std::string::npos)
         {
-            size_t endpos = out.find("</" + tag, pos);
+            const size_t endpos = html.find(closing, startpos);
             if (endpos == std::string::npos)
             {
                 break;
             }
-            endpos += 3 + tag.length(); // tag + </ + >
-            out.replace(pos, endpos - pos, "");
+
+            out.append(html, pos, startpos - pos);
+            // tag + </ + >
+            pos = std::min(endpos + 3 + tag.length(), html.size());
         }
+        out.append(html, pos);
     }
 
     return out;
 }
 
+void URI::normalize_whitespace(string &text)
+{
+    const auto is_space = [](const char c)
+    {
+        return (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v'
+                || c == '\f');
+    };
+
+    // Has a byte of word that is lower than 0x21? Spaces are.
+    constexpr std::uint64_t ones{0x0101010101010101};
+    constexpr std::uint64_t highs{0x8080808080808080};
+    const auto maybe_space = [](const std::uint64_t word)
+    {
+        return ((word - ones * 0x21) & ~word & highs) != 0;
+    };
+
+    char *const data = text.data();
+    const size_t size = text.size();
+    size_t read = 0;
+    size_t written = 0;
+    while (read < size)
+    {
+        // Copy everything up to the next space, 8 bytes at a time.
+        size_t end = read;
+        std::uint64_t word;
+        while (end < size && !is_space(data[end]))
+        {
+            if (end + sizeof(word) <= size)
+            {
+                std::memcpy(&word, data + end, sizeof(word));
+                if (!maybe_space(word))
+                {
+                    end += sizeof(word);
+                    continue;
+                }
+            }
+            ++end;
+        }
+        if (written != read)
+        {
+            std::memmove(data + written, data + read, end - read);
+        }
+        written += end - read;
+        read = end;
+
+        // Replace the spaces up to the last newline with one newline and
+        // remove carriage returns.
+        size_t last_newline = size;
+        while (end < size && is_space(data[end]))
+        {
+            if (data[end] == '\n')
+            {
+                last_newline = end;
+            }
+            ++end;
+        }
+        if (last_newline != size)
+        {
+            data[written++] = '\n';
+            read = last_newline + 1;
+        }
+        for (; read < end; ++read)
+        {
+            if (data[read] != '\r')
+            {
+                data[written++] = data[read];
+            }
+        }
+    }
+
+    text.resize(written);
+}
+
 string URI::unescape_html(string html)
 {
     // Used to convert int to utf-8 char.
@@ -307,6 +742,11 @@ string URI::unescape_html(string html)
 }
 
 archive_answer URI::archive() const
+{
+    return archive("https://web.archive.org/save/");
+}
+
+archive_answer URI::archive(const string &service) const
 {
     using namespace curl_wrapper;
 
@@ -319,8 +759,7 @@ archive_answer URI::archive() const
     {
         CURLWrapper curl;
         const auto answer =
-            curl.make_http_request(http_method::HEAD,
-                                   "https://web.archive.org/save/" + _uri);
+            curl.make_http_request(http_method::HEAD, service + _uri);
 
         if (answer)
         {
@@ -347,17 +786,16 @@ archive_answer URI::archive() const
 
 string URI::remove_newlines(string text)
 {
-    size_t posn = 0;
-    while ((posn = text.find('\n', posn)) != std::string::npos)
+    for (size_t pos = 0; pos < text.size(); ++pos)
     {
-        text.replace(posn, 1, " ");
-
-        size_t posr = posn - 1;
-        if (text[posr] == '\r')
+        if (text[pos] == '\n')
         {
-            text.replace(posr, 1, " ");
+            text[pos] = ' ';
+            if (pos > 0 && text[pos - 1] == '\r')
+            {
+                text[pos - 1] = ' ';
+            }
         }
-        ++posn;
     }
 
     return text;
@@ -384,30 +822,180 @@ string URI::cut_text(const string &text, const uint16_t n_chars)
     return text;
 }
 
-string URI::to_utf8(const string &str)
+string URI::to_utf8(string str)
 {
-    if (_encoding.empty())
-    {
-        detect_encoding();
-    }
-
     if (_encoding == "utf-8")
     {
+        if (str.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        {
+            str.erase(0, 3);    // Remove byte order mark.
+        }
         return str;
     }
 
-    return boost::locale::conv::to_utf<char>(str, _encoding);
+    try
+    {
+        return boost::locale::conv::to_utf<char>(str, _encoding);
+    }
+    catch (const boost::locale::conv::invalid_charset_error &)
+    {   // Unknown labels, like “none” or typos. Guess like without label.
+        _encoding = (is_utf8(str) ? "utf-8" : "windows-1252");
+        return to_utf8(move(str));
+    }
 }
 
-void URI::detect_encoding()
+void URI::detect_encoding(const std::string_view content_type)
 {
-    const RegEx re_encoding(R"(<meta.+charset="([^";]+))", RegEx::RE_CASELESS);
+    // The byte order mark is the most reliable, then the header, then the
+    // <meta> tags at the beginning of the document.
+    _encoding.clear();
+    if (_document.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    {
+        _encoding = "utf-8";
+    }
+    else if (_document.compare(0, 2, "\xFF\xFE") == 0)
+    {
+        _encoding = "utf-16le";
+    }
+    else if (_document.compare(0, 2, "\xFE\xFF") == 0)
+    {
+        _encoding = "utf-16be";
+    }
+    if (!_encoding.empty())
+    {
+        return;
+    }
+
+    const RegEx re_charset(R"(;\s*charset\s*=\s*["']?([-_.:[:alnum:]]+))",
+                           RegEx::RE_CASELESS);
     vector<string> matches;
-    re_encoding.split(_document, matches);
+    re_charset.split(string(content_type), matches);
+    const bool from_header{matches.size() >= 2};
+    if (!from_header)
+    {
+        // <?xml encoding="…"?> in XML documents.
+        const RegEx re_meta(R"((?:<meta[^>]+charset|<\?xml[^>]+encoding))"
+                            R"(\s*=\s*["']?([-_.:[:alnum:]]+))",
+                            RegEx::RE_CASELESS);
+        re_meta.split(_document.substr(0, 4096), matches);
+    }
     if (matches.size() >= 2)
     {
-        _encoding = boost::locale::to_lower(matches[1]);
+        _encoding = boost::locale::to_lower(matches[1], boost_locale());
+    }
+
+    // Aliases that browsers use, see
+    // <https://encoding.spec.whatwg.org/#names-and-labels>.
+    if (_encoding == "utf8" || _encoding == "unicode-1-1-utf-8")
+    {
+        _encoding = "utf-8";
+    }
+    else if (_encoding == "utf-16" || _encoding == "utf-16le"
+             || _encoding == "utf-16be")
+    {
+        if (!from_header)
+        {   // A <meta> tag we could read is not in UTF-16.
+            _encoding = "utf-8";
+        }
+        else if (_encoding == "utf-16")
+        {
+            _encoding = "utf-16le";
+        }
+    }
+    else if (_encoding == "iso-8859-1" || _encoding == "latin1"
+             || _encoding == "us-ascii" || _encoding == "ascii")
+    {
+        _encoding = "windows-1252";
+    }
+    else if (_encoding.empty())
+    {
+        _encoding = (is_utf8(_document) ? "utf-8" : "windows-1252");
+    }
+}
+
+string_view URI::content_type(const string_view headers)
+{
+    // If we were redirected, there are multiple responses.
+    size_t pos{headers.rfind("HTTP/")};
+    if (pos == string_view::npos)
+    {
+        pos = 0;
     }
+
+    constexpr string_view field{"content-type:"};
+    while ((pos = headers.find('\n', pos)) != string_view::npos)
+    {
+        ++pos;
+        const string_view line{headers.substr(pos, field.size())};
+        if (std::equal(line.begin(), line.end(), field.begin(), field.end(),
+                       [](const unsigned char a, const unsigned char b)
+                       { return std::tolower(a) == b; }))
+        {
+            pos = std::min(headers.find_first_not_of(" \t",
+                                                     pos + field.size()),
+                           headers.size());
+            return headers.substr(pos, headers.find_first_of("\r\n", pos)
+                                  - pos);
+        }
+    }
+
+    return {};
+}
+
+bool URI::is_utf8(const string_view text)
+{
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        const auto byte{static_cast<unsigned char>(text[pos])};
+        size_t length = 1;
+        char32_t lowest = 0;
+        if (byte >= 0xF0 && byte <= 0xF4)
+        {
+            length = 4;
+            lowest = 0x10000;
+        }
+        else if (byte >= 0xE0)
+        {
+            length = 3;
+            lowest = 0x800;
+        }
+        else if (byte >= 0xC2)
+        {
+            length = 2;
+            lowest = 0x80;
+        }
+        else if (byte >= 0x80)
+        {
+            return false;
+        }
+
+        if (length > 1)
+        {
+            if (byte > 0xF4 || pos + length > text.size())
+            {
+                return false;
+            }
+            char32_t codepoint = byte & (0x7FU >> length);
+            for (size_t i = 1; i < length; ++i)
+            {
+                const auto next{static_cast<unsigned char>(text[pos + i])};
+                if ((next & 0xC0U) != 0x80)
+                {
+                    return false;
+                }
+                codepoint = (codepoint << 6U) | (next & 0x3FU);
+            }
+            if (codepoint < lowest || codepoint > 0x10FFFF
+                || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+            {
+                return false;
+            }
+        }
+        pos += length;
+    }
+
+    return true;
 }
 
 bool URI::is_html() const
@@ -0,0 +1,261 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "archive_queue.hpp"
+#include "uri.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+using std::chrono::seconds;
+using std::chrono::system_clock;
+
+namespace
+{
+/*!
+ *  @brief  Answers one HTTP request like the Wayback Machine.
+ *
+ *  Listens on a random port on localhost.
+ */
+class StubArchive
+{
+public:
+    StubArchive()
+        : _fd{::socket(AF_INET, SOCK_STREAM, 0)}
+        , _port{0}
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        auto *sa = reinterpret_cast<sockaddr *>(&addr);
+        if (::bind(_fd, sa, len) != 0 || ::listen(_fd, 1) != 0
+            || ::getsockname(_fd, sa, &len) != 0)
+        {
+            throw std::runtime_error("Could not start stub archive.");
+        }
+        _port = ntohs(addr.sin_port);
+
+        _thread = std::thread(&StubArchive::answer, this);
+    }
+
+    ~StubArchive()
+    {
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+        ::close(_fd);
+    }
+
+    StubArchive(const StubArchive &other) = delete;
+    StubArchive &operator=(const StubArchive &other) = delete;
+    StubArchive(StubArchive &&other) = delete;
+    StubArchive &operator=(StubArchive &&other) = delete;
+
+    [[nodiscard]] string service() const
+    {
+        return "http://127.0.0.1:" + std::to_string(_port) + "/save/";
+    }
+
+    //! Waits for the request and returns its path.
+    [[nodiscard]] string path()
+    {
+        _thread.join();
+        return _path;
+    }
+
+private:
+    int _fd;
+    unsigned short _port;
+    std::thread _thread;
+    string _path;
+
+    void answer()
+    {
+        const int client = ::accept(_fd, nullptr, nullptr);
+        if (client == -1)
+        {
+            return;
+        }
+
+        string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == string::npos)
+        {
+            const ssize_t got = ::recv(client, buffer, sizeof(buffer), 0);
+            if (got <= 0)
+            {
+                break;
+            }
+            request.append(buffer, static_cast<size_t>(got));
+        }
+        const size_t start = request.find(' ') + 1;
+        _path = request.substr(start, request.find(' ', start) - start);
+
+        const string reply = "HTTP/1.1 200 OK\r\n"
+            "Content-Location: /web/20200101000000" + _path.substr(5) + "\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n\r\n";
+        ::send(client, reply.data(), reply.size(), 0);
+        ::close(client);
+    }
+};
+} // namespace
+
+SCENARIO ("The archive queue works correctly")
+{
+    bool exception = false;
+
+    GIVEN ("Settings with a backoff of 1 minute and 4 attempts")
+    {
+        ArchiveQueue::settings config;
+        config.backoff = seconds(60);
+        config.max_backoff = seconds(150);
+        config.max_attempts = 4;
+        std::optional<seconds> first;
+        std::optional<seconds> second;
+        std::optional<seconds> third;
+        std::optional<seconds> fourth;
+
+        try
+        {
+            first = ArchiveQueue::backoff(1, config);
+            second = ArchiveQueue::backoff(2, config);
+            third = ArchiveQueue::backoff(3, config);
+            fourth = ArchiveQueue::backoff(4, config);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The wait time doubles up to the maximum")
+            AND_THEN ("The job is given up after the last attempt")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(first == seconds(60));
+            REQUIRE(second == seconds(120));
+            REQUIRE(third == seconds(150));
+            REQUIRE_FALSE(fourth);
+        }
+    }
+
+    GIVEN ("A local stub archive service")
+    {
+        archive_answer answer;
+        string path;
+
+        try
+        {
+            StubArchive stub;
+            answer = URI("https://example.com/").archive(stub.service());
+            path = stub.path();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The URI is sent to the service")
+            AND_THEN ("The archive URI is extracted")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(path == "/save/https://example.com/");
+            REQUIRE(answer);
+            REQUIRE(answer.uri
+                    == "/web/20200101000000/https://example.com/");
+        }
+    }
+
+    GIVEN ("A database with 2 queued entries and a stub archive service")
+    {
+        const fs::path home = fs::temp_directory_path()
+            / "remwharead_test_archive_queue";
+        fs::remove_all(home);
+        ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+        size_t processed = 0;
+        string path;
+        vector<Database::archive_job> left;
+        size_t claimed_first = 0;
+        size_t claimed_again = 0;
+        size_t claimed_released = 0;
+
+        try
+        {
+            const Database db;
+            Database::entry entry;
+            entry.datetime = system_clock::now();
+            entry.uri = "https://example.com/1";
+            db.store(entry, true);
+            entry.uri = "https://example.com/2";
+            db.store(entry, true);
+
+            StubArchive stub;
+            ArchiveQueue::settings config;
+            config.service = stub.service();
+            std::mutex db_mutex;
+            ArchiveQueue queue(db, db_mutex, config);
+            processed = queue.run_once("https://example.com/1");
+            path = stub.path();
+            left = db.archive_queue();
+
+            const auto claimed = db.claim_archive_jobs(0, seconds(60));
+            claimed_first = claimed.size();
+            claimed_again = db.claim_archive_jobs(0, seconds(60)).size();
+            for (const auto &job : claimed)
+            {
+                db.release_archive_job(job);
+            }
+            claimed_released = db.claim_archive_jobs(0, seconds(60)).size();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Only the job of the given URI is processed")
+            AND_THEN ("Claimed jobs are skipped until they are released")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(processed == 1);
+            REQUIRE(path == "/save/https://example.com/1");
+            REQUIRE(left.size() == 1);
+            REQUIRE(left.front().uri == "https://example.com/2");
+            REQUIRE(claimed_first == 1);
+            REQUIRE(claimed_again == 0);
+            REQUIRE(claimed_released == 1);
+        }
+    }
+}
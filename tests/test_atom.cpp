@@ -0,0 +1,88 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2019 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <sstream>
+#include <regex>
+#include <chrono>
+#include <catch.hpp>
+#include "sqlite.hpp"
+#include "export/atom.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::chrono::system_clock;
+using std::regex;
+using std::regex_search;
+
+SCENARIO ("The Atom export works correctly")
+{
+    bool exception = false;
+    bool atom_ok = true;
+
+    GIVEN ("One database entry")
+    {
+        Database::entry entry;
+        entry.uri = "https://example.com/page.html";
+        entry.tags = { "tag1", "tag2" };
+        entry.title = "Nice title";
+        entry.datetime = system_clock::time_point();
+        entry.fulltext = "Full text.";
+        entry.description = "Good description.";
+
+        try
+        {
+            std::ostringstream output;
+            Export::Atom({ entry }, output).print();
+            const string atom = output.str();
+
+            const regex re(
+                R"(^<feed xmlns="http://www\.w3\.org/2005/Atom">)"
+                R"(<title>Visited things</title>)"
+                R"(<subtitle>Export from remwharead\.</subtitle>)"
+                R"(<id>urn:remwharead:visited-things</id>)"
+                R"(<updated>\d{4}(-\d{2}){2}T(\d{2}:){2}\d{2}Z</updated>)"
+                R"(<author><name>remwharead</name></author>)"
+                R"(<generator version="\d+\.\d+\.\d+">remwharead</generator>)"
+                R"(<entry><title>Nice title</title>)"
+                R"(<link href="https://example\.com/page\.html"/>)"
+                R"(<id>https://example\.com/page\.html)"
+                R"(#1970-01-01T00:00:00Z</id>)"
+                R"(<updated>1970-01-01T00:00:00Z</updated>)"
+                R"(<summary type="html">&lt;p&gt;Good description\.&lt;/p&gt;)"
+                R"(&lt;p&gt;&lt;strong&gt;Tags:&lt;/strong&gt; )"
+                R"(tag1, tag2&lt;/p&gt;</summary>)"
+                R"(</entry></feed>\n$)");
+
+            if (!regex_search(atom, re))
+            {
+                atom_ok = false;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Output looks okay")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(atom_ok);
+        }
+    }
+}
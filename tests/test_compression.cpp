@@ -0,0 +1,123 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "compression.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("Compression works correctly")
+{
+    bool exception = false;
+
+    GIVEN ("Some texts")
+    {
+        vector<string> samples;
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            samples.push_back("Article number " + std::to_string(i)
+                              + ". Lorem ipsum dolor sit amet, consectetur "
+                              "adipiscing elit. Share on social media. "
+                              "Subscribe to our newsletter. © "
+                              + std::to_string(i % 20 + 2000));
+        }
+        const string text(samples[42]);
+
+        if (!Compressor::available())
+        {
+            WHEN ("remwharead was compiled without zstd")
+            {
+                try
+                {
+                    Compressor compressor;
+                }
+                catch (const std::exception &e)
+                {
+                    exception = true;
+                }
+
+                THEN ("An exception is thrown")
+                {
+                    REQUIRE(exception);
+                }
+            }
+            return;
+        }
+
+        WHEN ("The text is compressed without dictionary")
+        {
+            string compressed;
+            string buffer;
+            string decompressed;
+            try
+            {
+                const Compressor compressor;
+                compressed = compressor.compress(text);
+                decompressed = string(compressor.decompress(compressed,
+                                                            buffer));
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The text survives the round trip")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(decompressed == text);
+            }
+        }
+
+        WHEN ("The text is compressed with a trained dictionary")
+        {
+            string compressed;
+            string compressed_plain;
+            string buffer;
+            string decompressed;
+            bool trained = false;
+            try
+            {
+                const string dictionary = Compressor::train(samples, 4096);
+                trained = !dictionary.empty();
+                const Compressor compressor(dictionary);
+                compressed = compressor.compress(text);
+                decompressed = string(compressor.decompress(compressed,
+                                                            buffer));
+                compressed_plain = Compressor().compress(text);
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The text survives the round trip")
+                AND_THEN ("The dictionary makes it smaller")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(trained);
+                REQUIRE(decompressed == text);
+                REQUIRE(compressed.size() < compressed_plain.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "dictionary.hpp"
+#include "entry_table.hpp"
+#include "search.hpp"
+#include "sqlite.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("The dictionary works correctly")
+{
+    bool exception = false;
+
+    GIVEN ("A dictionary")
+    {
+        vector<string> close;
+        vector<string> closer;
+        vector<string> exact;
+        vector<string> none;
+        size_t distance = 0;
+        size_t size = 0;
+        try
+        {
+            const Dictionary words({ "linux", "lint", "lunix", "linus",
+                                     "linux", "unix", "minix", "xyz" });
+            size = words.size();
+            close = words.find("linx", 1);
+            closer = words.find("linux", 2);
+            exact = words.find("xyz", 0);
+            none = words.find("abcdefg", 2);
+            distance = edit_distance("kitten", "sitting");
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Duplicates are removed")
+            AND_THEN ("Similar words are found, the most similar first")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(size == 7);
+            REQUIRE(close == vector<string>{ "lint", "linux" });
+            REQUIRE(closer
+                    == vector<string>{ "linux", "linus", "lint", "lunix",
+                                       "minix" });
+            REQUIRE(exact == vector<string>{ "xyz" });
+            REQUIRE(none.empty());
+            REQUIRE(distance == 3);
+        }
+    }
+
+    GIVEN ("A fuzzy search")
+    {
+        Database::entry entry1;
+        entry1.uri = "https://example.com/page.html";
+        entry1.title = "Kernel news";
+        entry1.tags = { "Linux", "free software" };
+
+        Database::entry entry2;
+        entry2.uri = "https://example.org/";
+        entry2.title = "Cheese recipes";
+        entry2.tags = { "food" };
+
+        const EntryTable entries({ entry1, entry2 });
+
+        vector<size_t> tags;
+        vector<size_t> tags_exact;
+        vector<size_t> all;
+        vector<size_t> ranked;
+        Bitmap rowids;
+        try
+        {
+            const Search search(entries);
+            tags = search.find_tags("linx OR free softwre", false, true);
+            tags_exact = search.find_tags("linx", false);
+            all = search.find_all("kernal && nevs OR chese", false, true);
+            ranked = { search.rank_all("recipies", false, 0, true)
+                       .at(0).index };
+            rowids = Search::find_tags(TagIndex(entries), "fod", false, true);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Tags and words with typos are found")
+            AND_THEN ("Typos are not found without fuzzy")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(tags == vector<size_t>{ 0 });
+            REQUIRE(tags_exact.empty());
+            REQUIRE(all == vector<size_t>{ 0, 1 });
+            REQUIRE(ranked == vector<size_t>{ 1 });
+            REQUIRE(rowids.indices() == vector<size_t>{ 1 });
+        }
+    }
+}
@@ -0,0 +1,215 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory_resource>
+#include <utility>
+#include <catch.hpp>
+#include "sqlite.hpp"
+#include "entry_table.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::chrono::system_clock;
+using std::chrono::hours;
+
+// Counts the allocations that reach the upstream resource.
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    size_t allocations = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+SCENARIO ("EntryTable works correctly")
+{
+    bool exception = false;
+
+    Database::entry entry1;
+    entry1.uri = "https://example.com/page.html";
+    entry1.tags = { "tag1", "tag2" };
+    entry1.title = "Nice title";
+    entry1.datetime = system_clock::time_point();
+    entry1.fulltext = "Full text.\nSecond line.";
+    entry1.description = "Good description.";
+
+    Database::entry entry2;
+    entry2.uri = "https://example.com/other.html";
+    entry2.tags = { "tag2" };
+    entry2.datetime = system_clock::time_point() + hours(1);
+
+    GIVEN ("An EntryTable with 2 entries")
+    {
+        EntryTable table;
+        try
+        {
+            table = EntryTable({ entry1, entry2 });
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The fields are stored correctly")
+            AND_THEN ("Tags are interned")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(table.size() == 2);
+            REQUIRE(table[0].uri() == entry1.uri);
+            REQUIRE(table[0].title() == entry1.title);
+            REQUIRE(table[0].fulltext() == entry1.fulltext);
+            REQUIRE(table[0].tags_to_string() == "tag1,tag2");
+            REQUIRE(table[0].fulltext_oneline()
+                    == "Full text.\\nSecond line.");
+            REQUIRE(table[1].title().empty());
+            REQUIRE(table[1].datetime() == entry2.datetime);
+            REQUIRE(table.tag_count() == 2);
+            REQUIRE(table[0].tags().ids()[1] == table[1].tags().ids()[0]);
+        }
+
+        WHEN ("Sorted by date and converted back to a list")
+        {
+            std::list<Database::entry> entries;
+            try
+            {
+                entries = table.select(table.order_by_datetime()).to_list();
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The newest entry is first")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(entries.size() == 2);
+                REQUIRE(entries.front().uri == entry2.uri);
+                REQUIRE(entries.back().tags == entry1.tags);
+                REQUIRE(entries.back().fulltext == entry1.fulltext);
+            }
+        }
+    }
+
+    GIVEN ("An EntryTable with 1000 entries in an arena")
+    {
+        counting_resource counter;
+        std::pmr::monotonic_buffer_resource arena(&counter);
+        size_t allocations_before_select = 0;
+        size_t selected = 0;
+        try
+        {
+            EntryTable table(&arena);
+            table.reserve(1000);
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                entry2.datetime += hours(1);
+                table.push_back(entry2);
+            }
+            allocations_before_select = counter.allocations;
+
+            const EntryTable newest = table.select(table.order_by_datetime());
+            REQUIRE(newest.resource() == &arena);
+            selected = newest.size();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Everything is allocated in a few blocks")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(selected == 1000);
+            REQUIRE(allocations_before_select > 0);
+            REQUIRE(allocations_before_select < 20);
+            REQUIRE(counter.allocations < 40);
+        }
+    }
+
+    GIVEN ("An EntryTable in an arena that is copied and moved")
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        bool copied_to_arena = false;
+        bool assigned_kept_resource = false;
+        bool data_moved = false;
+        bool data_copied = false;
+        try
+        {
+            EntryTable table(&arena);
+            table.push_back(entry1);
+            const char *data = table[0].uri().data();
+
+            const EntryTable copy(table);
+            copied_to_arena = (copy.resource() == &arena
+                               && copy[0].uri() == entry1.uri);
+
+            EntryTable assigned;
+            assigned = copy;
+            assigned_kept_resource
+                = (assigned.resource() == std::pmr::get_default_resource()
+                   && assigned[0].uri() == entry1.uri);
+
+            EntryTable moved_elsewhere;
+            moved_elsewhere = EntryTable(copy);
+            data_copied = (moved_elsewhere.resource()
+                           == std::pmr::get_default_resource()
+                           && moved_elsewhere[0].uri() == entry1.uri);
+
+            EntryTable moved(&arena);
+            moved = std::move(table);
+            data_moved = (moved[0].uri().data() == data);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Copies allocate from the arena")
+            AND_THEN ("Assigned tables keep their memory resource")
+            AND_THEN ("The data is only moved between equal resources")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(copied_to_arena);
+            REQUIRE(assigned_kept_resource);
+            REQUIRE(data_copied);
+            REQUIRE(data_moved);
+        }
+    }
+}
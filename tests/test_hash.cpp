@@ -0,0 +1,68 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <catch.hpp>
+#include "hash.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::uint64_t;
+
+SCENARIO ("The hash function works correctly")
+{
+    bool exception = false;
+
+    GIVEN ("Strings of different lengths")
+    {
+        uint64_t empty = 0;
+        uint64_t shorter = 0;
+        uint64_t longer = 0;
+        uint64_t bytes = 0;
+        string hex;
+
+        try
+        {
+            empty = xxh64("");
+            shorter = xxh64("abc");
+            longer = xxh64("Nobody inspects the spammish repetition");
+            string data;
+            for (char c = 0; c < 100; ++c)
+            {
+                data += c;
+            }
+            bytes = xxh64(data);
+            hex = content_hash("abc");
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The hashes match the reference implementation")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(empty == 0xEF46DB3751D8E999ULL);
+            REQUIRE(shorter == 0x44BC2CF5AD770999ULL);
+            REQUIRE(longer == 0xFBCEA83C8A378BF1ULL);
+            REQUIRE(bytes == 0x6AC1E58032166597ULL);
+            REQUIRE(hex == "44bc2cf5ad770999");
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <catch.hpp>
+#include "main_content.hpp"
+
+using namespace remwharead;
+using std::string;
+
+SCENARIO ("The main content of pages is extracted")
+{
+    bool exception = false;
+
+    WHEN ("The page has navigation, an article, comments and a footer")
+    {
+        const string html{
+            "<!DOCTYPE html><html><head><title>Cheese</title>"
+            "<script>var x = '<p>Not text</p>';</script></head><body>"
+            "<div id=\"cookie-banner\">We use cookies, of course. "
+            "<button>Accept</button></div>"
+            "<nav><ul><li><a href=\"/\">Home</a></li>"
+            "<li><a href=\"/news\">News about everything</a></li></ul></nav>"
+            "<div class=\"main-content\"><h1>All about cheese</h1>"
+            "<p>Cheese is a dairy product, made from milk, in a wide range of "
+            "flavors, textures and forms.</p>"
+            "<p>It is made by coagulation of the milk protein casein. "
+            "Typically, the milk is acidified and the enzymes of rennet are "
+            "added.</p>"
+            "<p>Hundreds of types of cheese, from various countries, are "
+            "produced &amp; eaten.\n    Some are <a href=\"x\">famous</a>."
+            "</div>"
+            "<div class=\"comments\"><p>Great article, very informative, "
+            "thank you!</p></div>"
+            "<footer><p>Copyright, all rights reserved, 2020, "
+            "by nobody at all.</p></footer></body></html>"};
+        string content;
+        try
+        {
+            content = extract_main_content(html);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Only the article is returned, one line per paragraph")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(content
+                    == "All about cheese\n"
+                    "Cheese is a dairy product, made from milk, in a wide "
+                    "range of flavors, textures and forms.\n"
+                    "It is made by coagulation of the milk protein casein. "
+                    "Typically, the milk is acidified and the enzymes of "
+                    "rennet are added.\n"
+                    "Hundreds of types of cheese, from various countries, "
+                    "are produced &amp; eaten. Some are famous.");
+        }
+    }
+
+    WHEN ("The page has no paragraphs")
+    {
+        string content{"x"};
+        try
+        {
+            content = extract_main_content(
+                "<html><body><a href=\"/\">Home</a> <p>Short.</p> < 3"
+                "</body></html>");
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Nothing is returned")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(content.empty());
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "entry_table.hpp"
+#include "prefix_index.hpp"
+#include "sqlite.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("The prefix index works correctly")
+{
+    bool exception = false;
+
+    Database::entry entry1;
+    entry1.uri = "https://example.com/page.html";
+    entry1.title = "Free Software";
+    entry1.tags = { "Linux" };
+
+    Database::entry entry2;
+    entry2.uri = "https://example.org/";
+    entry2.title = "Freedom of Speech";
+    entry2.fulltext = "Software patents are bad.";
+
+    Database::entry entry3;
+    entry3.uri = "https://example.net/";
+    entry3.description = "Über Käse";
+
+    const EntryTable entries({ entry1, entry2, entry3 });
+
+    GIVEN ("A prefix index")
+    {
+        Bitmap free;
+        Bitmap narrowed;
+        Bitmap example;
+        Bitmap umlaut;
+        try
+        {
+            const PrefixIndex index(entries);
+            free = index.find("free");
+            Bitmap candidates;
+            candidates.set(1);
+            narrowed = index.narrow(candidates, "soft");
+            example = index.find("example");
+            umlaut = index.find("üb");
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Words are found by their start")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(free.indices() == vector<size_t>{ 0, 1 });
+            REQUIRE(narrowed.indices() == vector<size_t>{ 1 });
+            REQUIRE(example.count() == 3);
+            REQUIRE(umlaut.indices() == vector<size_t>{ 2 });
+        }
+    }
+
+    GIVEN ("An incremental search")
+    {
+        vector<vector<size_t>> results;
+        try
+        {
+            IncrementalSearch search(entries);
+            for (const string input : { "", "f", "free", "free s", "free so",
+                                        "free soft", "free", "FREEDOM",
+                                        "linux exa", "käse", "xyz" })
+            {
+                results.push_back(search.update(input).indices());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The results follow the input")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(results
+                    == vector<vector<size_t>>{
+                        { 0, 1, 2 }, { 0, 1 }, { 0, 1 }, { 0, 1 }, { 0, 1 },
+                        { 0, 1 }, { 0, 1 }, { 1 }, { 0 }, { 2 }, {} });
+        }
+    }
+}
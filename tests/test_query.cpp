@@ -0,0 +1,172 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "query.hpp"
+#include "time.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+using kind = Query::node::kind;
+
+SCENARIO ("Search expressions are parsed correctly")
+{
+    bool exception = false;
+
+    WHEN ("Parsing an expression in the old format")
+    {
+        Query::node root;
+        try
+        {
+            root = Query("Big  Mountain && Cheese OR Vegetable", false).root();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Words next to each other form one term")
+            AND_THEN ("Terms combined with AND are in one node")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(root.type == kind::any_of);
+            REQUIRE(root.children.size() == 2);
+            REQUIRE(root.children[0].type == kind::text);
+            REQUIRE(root.children[0].terms
+                    == vector<string>{ "big  mountain", "cheese" });
+            REQUIRE(root.children[1].terms == vector<string>{ "vegetable" });
+        }
+    }
+
+    WHEN ("Parsing an expression with NOT, parentheses, fields and dates")
+    {
+        Query::node root;
+        vector<string> terms;
+        bool only_tags = true;
+        try
+        {
+            const Query query("(tag:Linux OR title:\"Free Software\") "
+                              "NOT kernel after:2020-01-01", false);
+            root = query.root();
+            terms = query.terms();
+            only_tags = query.only_tags();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The tree is correct")
+            AND_THEN ("Terms after NOT are not in terms()")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(root.type == kind::all_of);
+            REQUIRE(root.children.size() == 3);
+            const Query::node &either = root.children[0];
+            REQUIRE(either.type == kind::any_of);
+            REQUIRE(either.children[0].type == kind::field_term);
+            REQUIRE(either.children[0].in == Query::field::tags);
+            REQUIRE(either.children[0].terms == vector<string>{ "linux" });
+            REQUIRE(either.children[1].in == Query::field::title);
+            REQUIRE(either.children[1].terms
+                    == vector<string>{ "free software" });
+            REQUIRE(root.children[1].type == kind::negation);
+            REQUIRE(root.children[2].type == kind::after);
+            REQUIRE(root.children[2].time
+                    == string_to_timepoint("2020-01-01"));
+            REQUIRE(terms == vector<string>{ "linux", "free software" });
+            REQUIRE_FALSE(only_tags);
+        }
+    }
+
+    WHEN ("Parsing a regular expression")
+    {
+        Query::node root;
+        try
+        {
+            root = Query("(ab|c)d \"x\" OR e", true).root();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Parentheses and quotes are part of the terms")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(root.children[0].terms
+                    == vector<string>{ "(ab|c)d \"x\"" });
+        }
+    }
+
+    WHEN ("Normalizing expressions")
+    {
+        string spelled_out;
+        string short_form;
+        string different;
+        try
+        {
+            spelled_out = Query("(Big Cheese AND tag:x) OR NOT y", false)
+                .normalized();
+            short_form = Query("big cheese  && tag:X || NOT y", false)
+                .normalized();
+            different = Query("big cheese && tag:x || y", false).normalized();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Equal expressions have the same text")
+            AND_THEN ("Different expressions have different texts")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(spelled_out == short_form);
+            REQUIRE(spelled_out != different);
+        }
+    }
+
+    WHEN ("Parsing malformed expressions")
+    {
+        size_t errors = 0;
+        for (const string expression : { "(a OR b", "a OR", "a)", "NOT",
+                                         "\"a", "title: a", "after:soon" })
+        {
+            try
+            {
+                const Query query(expression, false);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                ++errors;
+            }
+        }
+
+        THEN ("std::invalid_argument is thrown for all of them")
+        {
+            REQUIRE(errors == 7);
+        }
+    }
+}
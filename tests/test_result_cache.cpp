@@ -0,0 +1,136 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <catch.hpp>
+#include "entry_table.hpp"
+#include "result_cache.hpp"
+#include "sqlite.hpp"
+
+using namespace remwharead;
+using std::string;
+
+SCENARIO ("The result cache works correctly")
+{
+    bool exception = false;
+
+    Database::entry entry;
+    entry.uri = "https://example.com/page.html";
+    entry.title = "Nice title";
+    entry.fulltext = "Full text.";
+
+    Database::revision first;
+    first.modifications = 1;
+    first.last_row = 1;
+    Database::revision second;
+    second.modifications = 1;
+    second.last_row = 2;
+
+    GIVEN ("A cache with one result")
+    {
+        std::shared_ptr<const EntryTable> same;
+        std::shared_ptr<const EntryTable> changed;
+        std::shared_ptr<const EntryTable> other;
+        size_t size = 0;
+        try
+        {
+            ResultCache cache;
+            {   // The table is gone before the result is used.
+                std::pmr::monotonic_buffer_resource arena;
+                cache.insert("key", first, EntryTable({ entry }, &arena));
+            }
+            same = cache.find("key", first);
+            other = cache.find("other", first);
+            changed = cache.find("key", second);
+            size = cache.size();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The result is found for the same revision")
+            AND_THEN ("The result is not found for other revisions or keys")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(same);
+            REQUIRE(same->size() == 1);
+            REQUIRE((*same)[0].title() == entry.title);
+            REQUIRE_FALSE(other);
+            REQUIRE_FALSE(changed);
+            REQUIRE(size == 0);
+        }
+    }
+
+    GIVEN ("A cache with a result of entries that were archived since")
+    {
+        Database::revision archived = first;
+        archived.archived = 1;
+        std::shared_ptr<const EntryTable> strict;
+        std::shared_ptr<const EntryTable> outdated;
+        bool archive_outdated = false;
+        try
+        {
+            ResultCache cache;
+            cache.insert("key", first, EntryTable({ entry }));
+            outdated = cache.find("key", archived, &archive_outdated);
+            strict = cache.find("key", archived);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The result is found if the caller updates it")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(outdated);
+            REQUIRE(archive_outdated);
+            REQUIRE_FALSE(strict);
+        }
+    }
+
+    GIVEN ("A cache that is too small for 2 results")
+    {
+        std::shared_ptr<const EntryTable> older;
+        std::shared_ptr<const EntryTable> newer;
+        try
+        {
+            ResultCache cache(60);
+            cache.insert("older", first, EntryTable({ entry }));
+            cache.insert("newer", first, EntryTable({ entry }));
+            older = cache.find("older", first);
+            newer = cache.find("newer", first);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The least recently used result is dropped")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE_FALSE(older);
+            REQUIRE(newer);
+        }
+    }
+}
@@ -92,4 +92,92 @@ SCENARIO ("Searching works correctly")
             REQUIRE(search_ok);
         }
     }
+
+    WHEN ("Searching with NOT, parentheses, fields and dates")
+    {
+        Database::entry other;
+        other.uri = "https://example.org/other.html";
+        other.tags = { "tag2" };
+        other.title = "Other title";
+        other.datetime = system_clock::time_point() + std::chrono::hours(48);
+        other.fulltext = "Other text.";
+        std::vector<size_t> without;
+        std::vector<size_t> grouped;
+        std::vector<size_t> in_uri;
+        std::vector<size_t> later;
+        std::vector<size_t> same_field;
+        std::vector<size_t> tags_without;
+
+        try
+        {
+            const Search both({ entry, other });
+            without = both.find_all("title NOT nice", false);
+            grouped = both.find_all("(nice OR other) AND title:\"title\"",
+                                    false);
+            in_uri = both.find_all("uri:example.org", false);
+            later = both.find_all("tag:tag2 after:1970-01-02", false);
+            same_field = both.find_all("nice AND full", false);
+            tags_without = both.find_tags("tag2 NOT tag1_ö", false);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Results look okay")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(without == std::vector<size_t>{ 1 });
+            REQUIRE(grouped == std::vector<size_t>{ 0, 1 });
+            REQUIRE(in_uri == std::vector<size_t>{ 1 });
+            REQUIRE(later == std::vector<size_t>{ 1 });
+            REQUIRE(same_field.empty());
+            REQUIRE(tags_without == std::vector<size_t>{ 1 });
+        }
+    }
+
+    WHEN ("Ranking by relevance")
+    {
+        Database::entry mentioned;
+        mentioned.title = "Birds";
+        mentioned.fulltext = "A long text about birds, where dogs are "
+            "mentioned only once, somewhere in the middle of it.";
+        Database::entry about;
+        about.title = "Dogs";
+        about.fulltext = "Dogs, dogs, dogs.";
+        Database::entry unrelated;
+        unrelated.title = "Cats";
+        unrelated.fulltext = "Cats.";
+        std::vector<Search::ranked> dogs;
+        std::vector<Search::ranked> best;
+        std::vector<Search::ranked> pets;
+
+        try
+        {
+            const Search pet_search({ mentioned, about, unrelated });
+            dogs = pet_search.rank_all("DOGS", false);
+            best = pet_search.rank_all("dogs OR cats", false, 1);
+            pets = pet_search.rank_all("dogs OR cats", false);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Only matches are returned")
+            AND_THEN ("The most relevant entry is first")
+            AND_THEN ("The limit is respected")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(dogs.size() == 2);
+            REQUIRE(dogs[0].index == 1);
+            REQUIRE(dogs[1].index == 0);
+            REQUIRE(dogs[0].score > dogs[1].score);
+            REQUIRE(pets.size() == 3);
+            REQUIRE(best.size() == 1);
+            REQUIRE(best[0].index == pets[0].index);
+        }
+    }
 }
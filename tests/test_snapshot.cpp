@@ -0,0 +1,334 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <catch.hpp>
+#include "entry_table.hpp"
+#include "search.hpp"
+#include "snapshot.hpp"
+#include "sqlite.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::chrono::system_clock;
+using std::chrono::hours;
+
+SCENARIO ("Snapshots work correctly")
+{
+    bool exception = false;
+    const fs::path path = fs::temp_directory_path()
+        / "remwharead_test_snapshot";
+
+    Database::entry entry1;
+    entry1.uri = "https://example.com/page.html";
+    entry1.archive_uri = "https://web.archive.org/web/page.html";
+    entry1.tags = { "tag1", "tag2" };
+    entry1.title = "Nice title";
+    entry1.datetime = system_clock::time_point() + hours(2);
+    entry1.fulltext = "Full text.\nSecond line.";
+    entry1.description = "Good description.";
+
+    Database::entry entry2;
+    entry2.uri = "https://example.com/other.html";
+    entry2.tags = { "tag2", "tag3" };
+    entry2.datetime = system_clock::time_point() + hours(1);
+
+    GIVEN ("A snapshot of an EntryTable with 2 entries")
+    {
+        Database::revision revision;
+        revision.modifications = 3;
+        revision.last_row = 2;
+        EntryTable table;
+        std::vector<size_t> tagged;
+        std::vector<size_t> found;
+        std::vector<size_t> found_re;
+        size_t trigram_rows = 0;
+        std::vector<string> similar;
+        bool read_only = false;
+
+        try
+        {
+            Snapshot::write(path, EntryTable({ entry1, entry2 }), revision);
+            const Snapshot snapshot(path);
+            revision = snapshot.revision();
+            table = snapshot.entries();
+            tagged = Search(table).find_tags("tag3", false);
+            found = Search(table).find_all("SECOND line", false);
+            trigram_rows = snapshot.trigrams().size();
+            similar = snapshot.words().find("secnod", 2);
+            found_re = Search(table, snapshot.trigrams())
+                .find_all("n.ce t(i|a)tle", true);
+            try
+            {
+                table.push_back(entry1);
+            }
+            catch (const std::logic_error &)
+            {
+                read_only = true;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The entries are unchanged")
+            AND_THEN ("The revision is unchanged")
+            AND_THEN ("The table is read-only")
+            AND_THEN ("The table has lowercase copies")
+            AND_THEN ("The table stays valid after the snapshot is gone")
+            AND_THEN ("The trigrams are usable")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(table.read_only());
+            REQUIRE(read_only);
+            REQUIRE(revision.modifications == 3);
+            REQUIRE(revision.last_row == 2);
+            REQUIRE(table.size() == 2);
+            REQUIRE(table[0].to_entry().uri == entry1.uri);
+            REQUIRE(table[0].archive_uri() == entry1.archive_uri);
+            REQUIRE(table[0].tags_to_string() == "tag1,tag2");
+            REQUIRE(table[0].title() == entry1.title);
+            REQUIRE(table[0].datetime() == entry1.datetime);
+            REQUIRE(table[0].fulltext() == entry1.fulltext);
+            REQUIRE(table[0].description() == entry1.description);
+            REQUIRE(table.has_folded());
+            REQUIRE(table[0].folded_title() == "nice title");
+            REQUIRE(table[0].folded_description() == "good description.");
+            REQUIRE(table[0].folded_fulltext() == "full text.\nsecond line.");
+            REQUIRE(table[1].uri() == entry2.uri);
+            REQUIRE(table[1].tags_to_string() == "tag2,tag3");
+            REQUIRE(table[1].fulltext().empty());
+            REQUIRE(table.tag_count() == 3);
+            REQUIRE(table.find_tag("tag2"));
+            REQUIRE(table.tag_name(*table.find_tag("tag2")) == "tag2");
+            REQUIRE_FALSE(table.find_tag("tag4"));
+            REQUIRE(tagged == std::vector<size_t>{ 1 });
+            REQUIRE(found == std::vector<size_t>{ 0 });
+            REQUIRE(trigram_rows == 2);
+            REQUIRE(similar == std::vector<string>{ "second" });
+            REQUIRE(found_re == std::vector<size_t>{ 0 });
+            REQUIRE(table.order_by_datetime() == std::vector<size_t>{ 0, 1 });
+            REQUIRE(table.select({ 1 })[0].tags_to_string() == "tag2,tag3");
+        }
+    }
+
+    GIVEN ("A snapshot with an offset that points outside of the file")
+    {
+        try
+        {
+            Snapshot::write(path, EntryTable({ entry1, entry2 }),
+                            Database::revision());
+            // The end of the first URI is the first offset with this value.
+            std::fstream file(path, std::ios::in | std::ios::out
+                              | std::ios::binary);
+            std::uint64_t value = 0;
+            while (file.read(reinterpret_cast<char *>(&value), sizeof(value))
+                   && value != entry1.uri.size())
+            {}
+            file.seekp(-static_cast<std::streamoff>(sizeof(value)),
+                       std::ios::cur);
+            value = std::uint64_t(1) << 40U;
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+            file.close();
+
+            const Snapshot snapshot(path);
+        }
+        catch (const std::runtime_error &e)
+        {
+            exception = true;
+        }
+
+        THEN ("std::runtime_error is thrown")
+        {
+            REQUIRE(exception);
+        }
+    }
+
+    GIVEN ("A file that is not a snapshot")
+    {
+        try
+        {
+            std::ofstream(path) << "Not a snapshot.";
+            const Snapshot snapshot(path);
+        }
+        catch (const std::runtime_error &e)
+        {
+            exception = true;
+        }
+
+        THEN ("std::runtime_error is thrown")
+        {
+            REQUIRE(exception);
+        }
+    }
+
+    fs::remove(path);
+}
+
+SCENARIO ("Snapshots are updated incrementally")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path()
+        / "remwharead_test_snapshot_update";
+    fs::remove_all(home);
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    GIVEN ("A database that only got new entries since the snapshot")
+    {
+        size_t first_read = 0;
+        size_t appended = 0;
+        size_t unchanged = 0;
+        size_t rebuilt = 0;
+        size_t rows = 0;
+        std::vector<size_t> alpha;
+        std::vector<size_t> bravo;
+        std::vector<string> words;
+        size_t trigrams_appended = 0;
+        size_t trigrams_rebuilt = 0;
+        size_t words_appended = 0;
+        size_t words_rebuilt = 0;
+
+        try
+        {
+            const Database db;
+            std::mutex db_mutex;
+            const fs::path path = Snapshot::default_path(db);
+            Database::entry entry;
+            entry.uri = "https://example.com/alpha";
+            entry.datetime = system_clock::now() - hours(1);
+            entry.fulltext = "Alpha words.";
+            db.store(entry, false);
+            first_read = Snapshot::update(db, db_mutex, path);
+
+            entry.uri = "https://example.com/bravo";
+            entry.datetime = system_clock::now();
+            entry.fulltext = "Bravo text.";
+            db.store(entry, false);
+            appended = Snapshot::update(db, db_mutex, path);
+            unchanged = Snapshot::update(db, db_mutex, path);
+            {
+                const Snapshot snapshot(path);
+                rows = snapshot.entries().size();
+                Bitmap all;
+                all.set(0, rows);
+                alpha = snapshot.trigrams().narrow(all, "alpha").indices();
+                bravo = snapshot.trigrams().narrow(all, "bravo").indices();
+                words = snapshot.words().find("wrods", 2);
+                trigrams_appended = snapshot.trigrams().trigram_count();
+                words_appended = snapshot.words().size();
+            }
+
+            fs::remove(path);
+            rebuilt = Snapshot::update(db, db_mutex, path);
+            const Snapshot snapshot(path);
+            trigrams_rebuilt = snapshot.trigrams().trigram_count();
+            words_rebuilt = snapshot.words().size();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Only the new entries are read")
+            AND_THEN ("Old and new entries are indexed")
+            AND_THEN ("The indexes are the same as when rebuilt")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(first_read == 1);
+            REQUIRE(appended == 1);
+            REQUIRE(unchanged == 0);
+            REQUIRE(rebuilt == 2);
+            REQUIRE(rows == 2);
+            REQUIRE(alpha == std::vector<size_t>{ 0 });
+            REQUIRE(bravo == std::vector<size_t>{ 1 });
+            REQUIRE(words == std::vector<string>{ "words" });
+            REQUIRE(trigrams_appended == trigrams_rebuilt);
+            REQUIRE(words_appended == words_rebuilt);
+        }
+    }
+
+    GIVEN ("A database whose entries were archived since the snapshot")
+    {
+        size_t first_read = 0;
+        size_t appended = 0;
+        std::uint64_t modifications_before = 1;
+        std::uint64_t modifications_after = 0;
+        std::vector<string> archive_uris;
+        std::vector<size_t> alpha;
+
+        try
+        {
+            const Database db;
+            std::mutex db_mutex;
+            const fs::path path = Snapshot::default_path(db);
+            Database::entry entry;
+            entry.uri = "https://example.com/alpha";
+            entry.datetime = system_clock::now() - hours(1);
+            entry.fulltext = "Alpha words.";
+            db.store(entry, true);
+            first_read = Snapshot::update(db, db_mutex, path);
+            modifications_before = db.current_revision().modifications;
+
+            db.archive_done({ { 1, "https://archive.example/alpha" } });
+            entry.uri = "https://example.com/bravo";
+            entry.datetime = system_clock::now();
+            entry.fulltext = "Bravo text.";
+            db.store(entry, true);
+            appended = Snapshot::update(db, db_mutex, path);
+            modifications_after = db.current_revision().modifications;
+
+            const Snapshot snapshot(path);
+            for (const EntryTable::row row : snapshot.entries())
+            {
+                archive_uris.emplace_back(row.archive_uri());
+            }
+            Bitmap all;
+            all.set(0, snapshot.entries().size());
+            alpha = snapshot.trigrams().narrow(all, "alpha").indices();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Setting an archive URI is not a modification")
+            AND_THEN ("Only the new entry is read")
+            AND_THEN ("The archive URIs are updated")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(first_read == 1);
+            REQUIRE(modifications_after == modifications_before);
+            REQUIRE(appended == 1);
+            REQUIRE(archive_uris
+                    == std::vector<string>{ "https://archive.example/alpha",
+                                            "" });
+            REQUIRE(alpha == std::vector<size_t>{ 0 });
+        }
+    }
+}
@@ -0,0 +1,349 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <chrono>
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include <Poco/Data/Session.h>
+#include <Poco/Data/SQLite/Connector.h>
+#include "compression.hpp"
+#include "entry_table.hpp"
+#include "hash.hpp"
+#include "sqlite.hpp"
+#include "tag_index.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+using std::chrono::system_clock;
+using std::chrono::hours;
+using namespace Poco::Data::Keywords;
+
+SCENARIO ("The database keeps track of row ids")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path() / "remwharead_test_sqlite";
+    fs::remove_all(home);
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    // The first 2 entries share a full text, so the content table has
+    // fewer rows than the entry table.
+    vector<Database::entry> entries(3);
+    entries[0].uri = "https://example.com/first.html";
+    entries[0].tags = { "tag1" };
+    entries[0].fulltext = "Same text.";
+    entries[1].uri = "https://example.com/second.html";
+    entries[1].tags = { "tag2" };
+    entries[1].fulltext = "Same text.";
+    entries[2].uri = "https://example.com/third.html";
+    entries[2].tags = { "tag3" };
+    entries[2].fulltext = "Other text.";
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i].datetime = system_clock::now() - hours(3 - i);
+    }
+
+    GIVEN ("A database with 3 tagged entries that are queued for archiving")
+    {
+        vector<string> tagged;
+        vector<vector<size_t>> rowids;
+        vector<Database::archive_job> jobs;
+
+        try
+        {
+            Database db;
+            for (const auto &entry : entries)
+            {
+                db.store(entry, true);
+            }
+
+            const TagIndex index = db.tag_index();
+            for (const string tag : { "tag1", "tag2", "tag3" })
+            {
+                const Bitmap *found = index.find(tag);
+                if (found == nullptr)
+                {
+                    rowids.emplace_back();
+                    tagged.emplace_back();
+                    continue;
+                }
+                rowids.push_back(found->indices());
+                const EntryTable table = db.retrieve_table(*found);
+                tagged.push_back(table.size() == 1
+                                 ? string(table[0].uri()) : string());
+            }
+            jobs = db.archive_queue();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Every tag points to its entry")
+            AND_THEN ("Every job points to its entry")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(rowids.size() == 3);
+            REQUIRE(jobs.size() == 3);
+            for (size_t i = 0; i < 3; ++i)
+            {
+                REQUIRE(rowids[i].size() == 1);
+                REQUIRE(tagged[i] == entries[i].uri);
+                REQUIRE(jobs[i].uri == entries[i].uri);
+                REQUIRE(jobs[i].rowid == rowids[i].front());
+            }
+        }
+    }
+}
+
+SCENARIO ("Databases of older versions are migrated")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path() / "remwharead_test_sqlite";
+    fs::remove_all(home);
+    fs::create_directories(home / "remwharead");
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    GIVEN ("A database without content table and with a deleted entry")
+    {
+        vector<size_t> tag1;
+        vector<size_t> tag2;
+        string uri;
+        bool has_id = false;
+
+        try
+        {
+            {
+                Poco::Data::SQLite::Connector::registerConnector();
+                Poco::Data::Session session(
+                    "SQLite", home / "remwharead" / "database.sqlite");
+                session << "CREATE TABLE remwharead(uri TEXT, "
+                    "archive_uri TEXT, datetime TEXT, tags TEXT, title TEXT, "
+                    "description TEXT, fulltext TEXT);", now;
+                session << "INSERT INTO remwharead VALUES"
+                    "('https://example.com/1', '', '2020-01-01T00:00:00', "
+                    "'tag1', '', '', 'Text 1.'),"
+                    "('https://example.com/2', '', '2020-01-02T00:00:00', "
+                    "'tag1', '', '', 'Text 2.'),"
+                    "('https://example.com/3', '', '2020-01-03T00:00:00', "
+                    "'tag2', '', '', 'Text 2.');", now;
+                session << "DELETE FROM remwharead WHERE rowid = 1;", now;
+            }
+
+            const Database db;
+            const TagIndex index = db.tag_index();
+            tag1 = index.find("tag1")->indices();
+            tag2 = index.find("tag2")->indices();
+            uri = db.retrieve_table(*index.find("tag2"))[0].uri();
+            Poco::Data::Session session(
+                "SQLite", home / "remwharead" / "database.sqlite");
+            size_t n = 0;
+            session << "SELECT count(*) FROM pragma_table_info('remwharead') "
+                "WHERE name = 'id' AND pk = 1;", into(n), now;
+            has_id = (n == 1);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The row ids are kept")
+            AND_THEN ("The row ids are declared")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(tag1 == vector<size_t>{ 2 });
+            REQUIRE(tag2 == vector<size_t>{ 3 });
+            REQUIRE(uri == "https://example.com/3");
+            REQUIRE(has_id);
+        }
+    }
+}
+
+SCENARIO ("Compressing the full texts keeps the row ids")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path() / "remwharead_test_sqlite";
+    fs::remove_all(home);
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    if (Compressor::available())
+    {
+        GIVEN ("A database with a deleted entry and a queued entry")
+        {
+            vector<size_t> tagged;
+            vector<Database::archive_job> jobs;
+            vector<string> fulltexts;
+
+            try
+            {
+                Database db;
+                Database::entry entry;
+                for (size_t i = 1; i <= 3; ++i)
+                {
+                    entry.uri = "https://example.com/" + std::to_string(i);
+                    entry.tags = { "tag" };
+                    entry.fulltext = "Text " + std::to_string(i) + '.';
+                    entry.datetime = system_clock::now() - hours(4 - i);
+                    db.store(entry, true);
+                }
+                db.remove("https://example.com/1");
+                db.compress_fulltexts();
+
+                const TagIndex index = db.tag_index();
+                tagged = index.find("tag")->indices();
+                jobs = db.archive_queue();
+                const EntryTable table = db.retrieve_table(*index.find("tag"));
+                for (size_t i = 0; i < table.size(); ++i)
+                {
+                    fulltexts.emplace_back(table[i].fulltext());
+                }
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+            fs::remove_all(home);
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The tag index and the queue are unchanged")
+                AND_THEN ("The texts are readable")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(tagged == vector<size_t>{ 2, 3 });
+                REQUIRE(jobs.size() == 2);
+                REQUIRE(jobs[0].rowid == 2);
+                REQUIRE(jobs[1].rowid == 3);
+                REQUIRE(fulltexts == vector<string>{ "Text 3.", "Text 2." });
+            }
+        }
+    }
+}
+
+SCENARIO ("Pages are stored for texts that were stored without one")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path() / "remwharead_test_sqlite";
+    fs::remove_all(home);
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    if (Compressor::available())
+    {
+        GIVEN ("3 entries with the same full text, the first without page")
+        {
+            vector<string> pages;
+
+            try
+            {
+                Database db;
+                Database::entry entry;
+                entry.fulltext = "Main content.";
+                for (size_t i = 1; i <= 3; ++i)
+                {
+                    entry.uri = "https://example.com/" + std::to_string(i);
+                    entry.datetime = system_clock::now() - hours(4 - i);
+                    db.store(entry, false,
+                             i == 1 ? string() : "Page " + std::to_string(i));
+                }
+                for (size_t i = 1; i <= 3; ++i)
+                {
+                    pages.push_back(db.page_text("https://example.com/"
+                                                 + std::to_string(i)));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+            fs::remove_all(home);
+
+            THEN ("No exception is thrown")
+                AND_THEN ("All entries share the first page that was stored")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(pages == vector<string>(3, "Page 2"));
+            }
+        }
+    }
+}
+
+SCENARIO ("Different texts with the same hash are kept apart")
+{
+    bool exception = false;
+    const fs::path home = fs::temp_directory_path() / "remwharead_test_sqlite";
+    fs::remove_all(home);
+    ::setenv("XDG_DATA_HOME", home.c_str(), 1);
+
+    GIVEN ("A stored text that has the hash of the next text")
+    {
+        vector<string> fulltexts;
+        size_t n_texts = 0;
+
+        try
+        {
+            Database db;
+            Database::entry entry;
+            for (const string text : { "Text A.", "Text B.", "Text B." })
+            {
+                entry.uri = "https://example.com/" + text;
+                entry.fulltext = text;
+                entry.datetime += hours(1);
+                db.store(entry);
+
+                if (text == "Text A.")
+                {   // Fake a collision.
+                    Poco::Data::Session session(
+                        "SQLite", home / "remwharead" / "database.sqlite");
+                    const string fake = content_hash("Text B.");
+                    session << "UPDATE remwharead_content SET hash = ?;",
+                        useRef(fake), now;
+                    session << "UPDATE remwharead SET content = ?;",
+                        useRef(fake), now;
+                }
+            }
+
+            for (const auto &stored : db.retrieve())
+            {
+                fulltexts.push_back(stored.fulltext);
+            }
+            Poco::Data::Session session(
+                "SQLite", home / "remwharead" / "database.sqlite");
+            session << "SELECT count(*) FROM remwharead_content;",
+                into(n_texts), now;
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+        fs::remove_all(home);
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Every entry has its own text")
+            AND_THEN ("Equal texts are still stored once")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(fulltexts
+                    == vector<string>{ "Text B.", "Text B.", "Text A." });
+            REQUIRE(n_texts == 2);
+        }
+    }
+}
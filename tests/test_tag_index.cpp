@@ -0,0 +1,133 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "tag_index.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("The tag index works correctly")
+{
+    bool exception = false;
+
+    GIVEN ("A bitmap with some bits set")
+    {
+        Bitmap bitmap;
+        Bitmap copy;
+        try
+        {
+            for (const size_t bit : { 3, 64, 200, 100000 })
+            {
+                bitmap.set(bit);
+            }
+            copy = Bitmap::deserialize(bitmap.serialize());
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The bits are set")
+            AND_THEN ("It survives serialization")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(bitmap.count() == 4);
+            REQUIRE(bitmap.test(64));
+            REQUIRE_FALSE(bitmap.test(65));
+            REQUIRE(bitmap.indices()
+                    == vector<size_t>{ 3, 64, 200, 100000 });
+            REQUIRE(copy == bitmap);
+        }
+    }
+
+    GIVEN ("A range of bits minus some bits")
+    {
+        Bitmap range;
+        try
+        {
+            Bitmap some;
+            some.set(63);
+            some.set(130);
+            range.set(60, 130);
+            range -= some;
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The right bits are set")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(range.count() == 69);
+            REQUIRE(range.test(60));
+            REQUIRE_FALSE(range.test(63));
+            REQUIRE(range.test(129));
+            REQUIRE_FALSE(range.test(59));
+        }
+    }
+
+    GIVEN ("An index with 3 tagged entries")
+    {
+        TagIndex index;
+        vector<size_t> result_and;
+        vector<size_t> result_re;
+        vector<size_t> result_removed;
+        bool tag3_matched = true;
+        size_t n_tags = 0;
+        try
+        {
+            index.add(0, "Tag1");
+            index.add(0, "tag2");
+            index.add(1, "tag2");
+            index.add(2, "tag1");
+            index.add(2, "tag3");
+            index.remove(2, "tag3");
+
+            result_and = index.match({ "tag1", "tag2" }, false).indices();
+            result_re = index.match({ "tag[12]" }, true).indices();
+            n_tags = index.tags().size();
+
+            tag3_matched = !index.match({ "tag3" }, false).none();
+            index.remove(0, "Tag1");
+            result_removed = index.match({ "tag1" }, false).indices();
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Tags are matched case-insensitively")
+            AND_THEN ("Removed tags are gone")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(result_and == vector<size_t>{ 0 });
+            REQUIRE(result_re == vector<size_t>{ 0, 1, 2 });
+            REQUIRE(index.find("tag3") == nullptr);
+            REQUIRE(n_tags == 3);
+            REQUIRE_FALSE(tag3_matched);
+            REQUIRE(result_removed == vector<size_t>{ 2 });
+        }
+    }
+}
@@ -0,0 +1,132 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "term_matcher.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("TermMatcher works correctly")
+{
+    bool exception = false;
+    vector<unsigned> counts;
+    vector<bool> found;
+
+    GIVEN ("Overlapping terms")
+    {
+        try
+        {
+            const TermMatcher matcher({ "he", "she", "his", "hers", "" });
+            matcher.count("ushers", counts);
+            matcher.find("ushers", found);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("All terms are found")
+            AND_THEN ("Empty terms are not found")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(counts == vector<unsigned>{ 1, 1, 0, 1, 0 });
+            REQUIRE(found == vector<bool>{ true, true, false, true, false });
+        }
+    }
+
+    GIVEN ("A term that overlaps itself")
+    {
+        try
+        {
+            const TermMatcher matcher({ "aa" });
+            matcher.count("aaaaa", counts);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Occurrences don't overlap")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(counts == vector<unsigned>{ 2 });
+        }
+    }
+
+    GIVEN ("Text in upper case and with umlauts")
+    {
+        try
+        {
+            const TermMatcher matcher({ "über", "straße", "ok" });
+            matcher.count("ÜBER die STRAßE, Über die Straße.", counts);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Case is ignored")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(counts == vector<unsigned>{ 2, 2, 0 });
+        }
+    }
+
+    GIVEN ("Text that was converted to lowercase already")
+    {
+        try
+        {
+            const TermMatcher matcher({ "über", "straße", "ok" });
+            matcher.count(fold_case("ÜBER die STRAßE, Über die Straße."),
+                          counts, true);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The same occurrences are counted")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(counts == vector<unsigned>{ 2, 2, 0 });
+        }
+    }
+}
+
+SCENARIO ("fold_case works correctly")
+{
+    WHEN ("Text is converted to lowercase")
+    {
+        THEN ("ASCII is converted")
+            AND_THEN ("Umlauts are converted")
+            AND_THEN ("Invalid UTF-8 is not changed")
+        {
+            REQUIRE(fold_case("Hello, WORLD!") == "hello, world!");
+            REQUIRE(fold_case("ÄÖÜ and Ä") == "äöü and ä");
+            REQUIRE(fold_case("A\xC3(B\xFF") == "a\xC3(b\xFF");
+            REQUIRE(fold_case("").empty());
+        }
+    }
+}
@@ -73,3 +73,66 @@ SCENARIO ("The time conversion works correctly")
         }
     }
 }
+
+SCENARIO ("The time conversion handles different formats")
+{
+    bool exception = false;
+    const string datetime = "2019-02-10T12:30:00";
+    system_clock::time_point tp;
+
+    GIVEN ("The date and time " + datetime + " as time_point")
+    {
+        try
+        {
+            tp = string_to_timepoint(datetime);
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        WHEN ("It is parsed from SQLite format or without seconds")
+        {
+            system_clock::time_point tp_sqlite;
+            system_clock::time_point tp_short;
+            try
+            {
+                tp_sqlite = string_to_timepoint("2019-02-10 12:30:00", true);
+                tp_short = string_to_timepoint("2019-02-10T12:30");
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The results are the same")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(tp_sqlite == tp);
+                REQUIRE(tp_short == tp);
+            }
+        }
+
+        WHEN ("Converted to SQLite format with timepoint_to_chars()")
+        {
+            timestring_buffer buffer;
+            string datetime2;
+            try
+            {
+                datetime2 = string(timepoint_to_chars(tp, buffer, true));
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("Date and time is in SQLite format")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(datetime2 == "2019-02-10 12:30:00");
+            }
+        }
+    }
+}
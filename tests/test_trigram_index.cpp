@@ -0,0 +1,127 @@
+/*  This file is part of remwharead.
+ *  Copyright © 2020 tastytea <tastytea@tastytea.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, version 3.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exception>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+#include "entry_table.hpp"
+#include "search.hpp"
+#include "sqlite.hpp"
+#include "trigram_index.hpp"
+
+using namespace remwharead;
+using std::string;
+using std::vector;
+
+SCENARIO ("The trigram index works correctly")
+{
+    bool exception = false;
+
+    Database::entry entry1;
+    entry1.uri = "https://example.com/page.html";
+    entry1.title = "The Colour of Freedom";
+    entry1.fulltext = "Linux kernel news.";
+
+    Database::entry entry2;
+    entry2.uri = "https://example.org/";
+    entry2.title = "Color Theory";
+    entry2.description = "BSD kernel news, Ärger.";
+
+    Database::entry entry3;
+    entry3.uri = "https://example.net/";
+    entry3.fulltext = "Nothing of interest.";
+
+    const EntryTable entries({ entry1, entry2, entry3 });
+
+    GIVEN ("A trigram index")
+    {
+        vector<vector<size_t>> narrowed;
+        size_t size = 0;
+        try
+        {
+            const TrigramIndex index(entries);
+            size = index.size();
+            Bitmap all;
+            all.set(0, entries.size());
+            for (const string regex :
+                     { "freedom", "colou?r", "colo(u)?r th", "fre+dom",
+                       "(linux|bsd) kernel", "(?:linux|xyz)", "ärger",
+                       "a.c", "[xyz]{3}", "(?i)xyz", "xyz|", "kernel\\ news",
+                       "zzz" })
+            {
+                narrowed.push_back(index.narrow(all, regex).indices());
+            }
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("Only rows with the needed trigrams are left")
+            AND_THEN ("Regular expressions without literal text keep all")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(size == 3);
+            REQUIRE(narrowed
+                    == vector<vector<size_t>>{
+                        { 0 }, { 0, 1 }, { 1 }, { 0 }, { 0, 1 }, { 0 },
+                        { 1 }, { 0, 1, 2 }, { 0, 1, 2 }, { 0, 1, 2 },
+                        { 0, 1, 2 }, { 0, 1 }, {} });
+        }
+    }
+
+    GIVEN ("A search with trigrams")
+    {
+        vector<size_t> with_trigrams;
+        vector<size_t> without_trigrams;
+        vector<size_t> ranked_with;
+        vector<size_t> ranked_without;
+        try
+        {
+            const Search search(entries, TrigramIndex(entries));
+            with_trigrams = search.find_all(".*colou?r.* OR .*kernel news.*",
+                                            true);
+            without_trigrams = Search(entries).find_all(
+                ".*colou?r.* OR .*kernel news.*", true);
+            for (const auto &result : search.rank_all(".*colou?r.*", true))
+            {
+                ranked_with.push_back(result.index);
+            }
+            for (const auto &result : Search(entries).rank_all(".*colou?r.*",
+                                                               true))
+            {
+                ranked_without.push_back(result.index);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            exception = true;
+        }
+
+        THEN ("No exception is thrown")
+            AND_THEN ("The results are the same as without trigrams")
+            AND_THEN ("Ranking skips the rows the trigrams exclude")
+        {
+            REQUIRE_FALSE(exception);
+            REQUIRE(with_trigrams == vector<size_t>{ 0, 1 });
+            REQUIRE(with_trigrams == without_trigrams);
+            REQUIRE(ranked_with.size() == 2);
+            REQUIRE(ranked_with == ranked_without);
+        }
+    }
+}
@@ -14,8 +14,12 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
 #include <exception>
+#include <locale>
 #include <string>
+#include <thread>
+#include <vector>
 #include <catch.hpp>
 #include "uri.hpp"
 
@@ -29,8 +33,13 @@ SCENARIO ("URI works correctly")
         class URITest : protected URI
         {
         public:
-            explicit URITest(const string &)
-                : URI("") {}
+            using URI::document_type;
+
+            explicit URITest(const string &document)
+                : URI("")
+            {
+                _document = document;
+            }
             URITest()
                 : URI("test.html")
             {
@@ -55,6 +64,67 @@ SCENARIO ("URI works correctly")
             {
                 return (strip_html() == "titleA short sentence.");
             }
+
+            bool test_whitespace()
+            {
+                return (strip_html() == "A \t line\nAnother line\n  Last");
+            }
+
+            string test_encoding(const string &headers)
+            {
+                detect_encoding(content_type(headers));
+                return _encoding;
+            }
+
+            string test_to_utf8()
+            {
+                return to_utf8(_document);
+            }
+
+            bool test_type(const string &content_type,
+                           const document_type expected) const
+            {
+                return (detect_type(content_type) == expected);
+            }
+
+            static string test_content_type(const string &headers)
+            {
+                return string(content_type(headers));
+            }
+
+            html_extract test_extract_xml() const
+            {
+                return extract_xml();
+            }
+
+            //! Returns the number of chunks written before the stop.
+            size_t test_download(const string &content_type,
+                                 const string &chunk, const size_t n)
+            {
+                download state{this, nullptr, content_type};
+                for (size_t i = 0; i < n; ++i)
+                {
+                    string data{chunk};
+                    if (write_document(data.data(), 1, data.size(), &state)
+                        != data.size())
+                    {
+                        return (state.stopped ? i : n + 1);
+                    }
+                }
+                return n;
+            }
+
+            [[nodiscard]] size_t document_size() const
+            {
+                return _document.size();
+            }
+
+            static bool test_cut_bytes()
+            {
+                string text{"K\xC3\xA4se"};
+                cut_bytes(text, 2);
+                return (text == "K");
+            }
         };
 
         WHEN ("extract_title() is called")
@@ -92,5 +162,272 @@ SCENARIO ("URI works correctly")
                 REQUIRE(testuri.test_fulltext());
             }
         }
+
+        WHEN ("extract_fulltext() is called on text with many empty lines")
+        {
+            URITest testuri("<p>A \t line \r\n\r\n \t\n"
+                            "<script>x\n</script>Another line\r\n"
+                            "\n\n  Last</p>");
+
+            THEN ("No exception is thrown")
+                AND_THEN ("Carriage returns, empty lines and spaces at the "
+                          "end of lines are removed")
+            {
+                REQUIRE_NOTHROW(testuri.test_whitespace());
+                REQUIRE(testuri.test_whitespace());
+            }
+        }
+
+        WHEN ("The encoding is detected")
+        {
+            const string latin1{"<html><head><meta http-equiv=\"Content-Type\" "
+                                "content=\"text/html; charset=ISO-8859-1\">"
+                                "<title>K\xE4se</title></head></html>"};
+            const string redirected{"HTTP/1.1 301 Moved Permanently\r\n"
+                                    "Content-Type: text/html; charset=utf-8"
+                                    "\r\n\r\nHTTP/1.1 200 OK\r\n"
+                                    "content-type: text/html;charset=\"koi8-r\""
+                                    "\r\n\r\n"};
+            string from_meta;
+            string converted;
+            string from_header;
+            string from_bom;
+            string without_bom;
+            string guessed;
+            string unknown_converted;
+            string utf16_header;
+            string utf16_meta;
+            bool exception = false;
+            try
+            {
+                URITest testuri(latin1);
+                from_meta = testuri.test_encoding("");
+                converted = testuri.test_to_utf8();
+                from_header = testuri.test_encoding(redirected);
+
+                URITest testuri_bom("\xEF\xBB\xBF<p>K\xC3\xA4se</p>");
+                from_bom = testuri_bom.test_encoding(redirected);
+                without_bom = testuri_bom.test_to_utf8();
+
+                guessed = URITest("<p>K\xE4se</p>").test_encoding("");
+
+                URITest testuri_unknown("<p>K\xE4se</p>");
+                testuri_unknown.test_encoding("HTTP/1.1 200 OK\r\n"
+                                              "Content-Type: text/html; "
+                                              "charset=none\r\n\r\n");
+                unknown_converted = testuri_unknown.test_to_utf8();
+
+                utf16_header = URITest(string("<\0p\0>\0", 6))
+                    .test_encoding("HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: text/html; "
+                                   "charset=UTF-16\r\n\r\n");
+                utf16_meta = URITest("<meta charset=\"utf-16\">")
+                    .test_encoding("");
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("<meta> tags are used if there is no header")
+                AND_THEN ("The header of the last response is used")
+                AND_THEN ("The byte order mark wins")
+                AND_THEN ("Invalid UTF-8 is assumed to be windows-1252")
+                AND_THEN ("Unknown encodings are guessed")
+                AND_THEN ("Only <meta> tags cannot be in UTF-16")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(from_meta == "windows-1252");
+                REQUIRE(converted.find("K\xC3\xA4se") != string::npos);
+                REQUIRE(from_header == "koi8-r");
+                REQUIRE(from_bom == "utf-8");
+                REQUIRE(without_bom == "<p>K\xC3\xA4se</p>");
+                REQUIRE(guessed == "windows-1252");
+                REQUIRE(unknown_converted == "<p>K\xC3\xA4se</p>");
+                REQUIRE(utf16_header == "utf-16le");
+                REQUIRE(utf16_meta == "utf-8");
+            }
+        }
+
+        WHEN ("URIs are used from several threads at once")
+        {
+            // The native messaging wrapper saves URIs on a pool of threads.
+            const string global_locale = std::locale().name();
+            std::atomic<size_t> wrong{0};
+            bool exception = false;
+            try
+            {
+                std::vector<std::thread> threads;
+                for (size_t t = 0; t < 8; ++t)
+                {
+                    threads.emplace_back([&wrong]
+                    {
+                        for (size_t i = 0; i < 50; ++i)
+                        {
+                            URITest testuri("<title>K\xE4se</title>");
+                            if (testuri.test_encoding(
+                                    "Content-Type: text/html; "
+                                    "charset=ISO-8859-1\r\n\r\n")
+                                != "windows-1252"
+                                || testuri.test_to_utf8()
+                                != "<title>K\xC3\xA4se</title>")
+                            {
+                                ++wrong;
+                            }
+                        }
+                    });
+                }
+                for (std::thread &thread : threads)
+                {
+                    thread.join();
+                }
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("Every result is right")
+                AND_THEN ("The global locale is not changed")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(wrong == 0);
+                REQUIRE(std::locale().name() == global_locale);
+            }
+        }
+
+        WHEN ("The type of documents is detected")
+        {
+            using type = URITest::document_type;
+            const string feed{"<?xml version=\"1.0\"?>\n<rss><channel>"};
+            bool types_correct = false;
+            bool exception = false;
+            try
+            {
+                const URITest empty("");
+                const URITest pdf("%PDF-1.5\n\x80\x81");
+                const URITest binary(string("GIF89a\0\0", 8));
+                const URITest xml(feed);
+                const URITest html("\n<!DOCTYPE html>\n<html>");
+                const URITest text("Just some text.");
+                types_correct =
+                    empty.test_type(empty.test_content_type(
+                                        "HTTP/2 200\r\nContent-Type:  "
+                                        "text/html; charset=utf-8\r\n"),
+                                    type::html)
+                    && empty.test_type("Application/RSS+XML", type::xml)
+                    && empty.test_type("application/pdf", type::pdf)
+                    && empty.test_type("text/plain", type::text)
+                    && empty.test_type("application/json", type::text)
+                    && empty.test_type("image/png", type::binary)
+                    && pdf.test_type("", type::pdf)
+                    && binary.test_type("application/octet-stream",
+                                        type::binary)
+                    && xml.test_type("", type::xml)
+                    && html.test_type("", type::html)
+                    && text.test_type("", type::text);
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("The Content-Type header is used")
+                AND_THEN ("Without it, the beginning of the document is used")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(types_correct);
+            }
+        }
+
+        WHEN ("Documents are downloaded")
+        {
+            size_t image = 0;
+            size_t unknown = 0;
+            size_t page = 0;
+            size_t large = 0;
+            size_t large_size = 0;
+            string large_encoding;
+            bool exception = false;
+            try
+            {
+                const string chunk(1024 * 1024, 'a');
+                image = URITest("").test_download("image/png", chunk, 2);
+                unknown = URITest("").test_download(
+                    "", string("GIF89a\0\0", 8), 2);
+                page = URITest("").test_download("text/html", chunk, 2);
+                URITest large_page("");
+                large = large_page.test_download("text/html", chunk, 100);
+                large_size = large_page.document_size();
+
+                // The cut falls into the second byte of a “€”.
+                string euros;
+                for (size_t i = 0; i < 1024 * 1024 / 3; ++i)
+                {
+                    euros += "\xE2\x82\xAC";
+                }
+                URITest large_utf8("");
+                large_utf8.test_download("text/plain", euros, 100);
+                large_encoding = large_utf8.test_encoding("");
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("Documents without text are stopped at once")
+                AND_THEN ("Large documents are stopped and cut")
+                AND_THEN ("UTF-8 sequences are not cut")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(image == 0);
+                REQUIRE(unknown == 0);
+                REQUIRE(page == 2);
+                REQUIRE(large == 64);
+                REQUIRE(large_size == 64 * 1024 * 1024);
+                REQUIRE(large_encoding == "utf-8");
+            }
+        }
+
+        WHEN ("Text is extracted from a feed")
+        {
+            html_extract page;
+            bool cut_correctly = false;
+            bool exception = false;
+            try
+            {
+                const URITest testuri(
+                    "<?xml version=\"1.0\"?><rss><channel>"
+                    "<title>News &amp; more</title>"
+                    "<description><![CDATA[All the <b>news</b>.]]>"
+                    "</description><item><title>First</title>"
+                    "<description>&lt;p&gt;Text &amp;amp; "
+                    "more.&lt;/p&gt;</description></item>"
+                    "</channel></rss>");
+                page = testuri.test_extract_xml();
+                cut_correctly = URITest::test_cut_bytes();
+            }
+            catch (const std::exception &e)
+            {
+                exception = true;
+            }
+
+            THEN ("No exception is thrown")
+                AND_THEN ("Title and description are those of the feed")
+                AND_THEN ("Tags are removed, also from escaped HTML")
+                AND_THEN ("UTF-8 characters are not cut")
+            {
+                REQUIRE_FALSE(exception);
+                REQUIRE(page.title == "News & more");
+                REQUIRE(page.description == "All the news.");
+                REQUIRE(page.fulltext
+                        == "News & more\nAll the news.\nFirst\nText & more.");
+                REQUIRE(cut_correctly);
+            }
+        }
     }
 }